@@ -1,81 +1,56 @@
 #pragma once
 
 #include <string>
-#include <utility>
+#include <string_view>
+#include <memory>
 #include <optional>
-#include <windows.h>
-#include <wininet.h>
 
-class InternetHandle
-{
-private:
-    HINTERNET m_handle = nullptr;
-
-public:
-    InternetHandle() = default;
-
-    ~InternetHandle()
-    {
-        if (m_handle)
-            InternetCloseHandle(m_handle);
-    }
-
-    InternetHandle(const InternetHandle&) = delete; // copy constructor
-    InternetHandle& operator=(const InternetHandle&) = delete; // assignment operator
-
-    InternetHandle(InternetHandle&& other) noexcept : // move constructor
-        m_handle(std::exchange(other.m_handle, nullptr))
-    {}
-
-    InternetHandle& operator=(InternetHandle&& other) noexcept // move assignment
-    {
-        std::swap(m_handle, other.m_handle);
-        return *this;
-    }
-
-    InternetHandle &operator=(HINTERNET handle)
-    {
-        if (m_handle)
-            InternetCloseHandle(m_handle);
-        m_handle = handle;
-        return *this;
-    }
-
-    operator HINTERNET() const
-    {
-        return m_handle;
-    }
-};
+// HTTP client interface. On Windows it is implemented using WinINet (HttpRequest-wininet.cpp). On other platforms
+// plain sockets are used (HttpRequest-socket.cpp) - that backend supports HTTP only and exists so code using
+// the client can be built and run against a local server (e.g. tools/mock_factionfiles) outside of Windows.
 
 class HttpSession
 {
-private:
-    InternetHandle m_inet;
-
 public:
+    struct Impl;
+
     HttpSession(const char* user_agent);
+    ~HttpSession();
 
     void set_connect_timeout(unsigned long timeout_ms);
     void set_send_timeout(unsigned long timeout_ms);
     void set_receive_timeout(unsigned long timeout_ms);
 
-    HINTERNET get_internet_handle()
+    Impl& get_impl()
     {
-        return m_inet;
+        return *m_impl;
     }
+
+private:
+    std::unique_ptr<Impl> m_impl;
 };
 
 class HttpRequest
 {
+public:
+    struct Impl;
+
 private:
-    InternetHandle m_conn;
-    InternetHandle m_req;
+    std::unique_ptr<Impl> m_impl;
     bool m_in_body = false;
+    unsigned long m_status_code = 0;
 
 public:
     HttpRequest(std::string_view url, const char* method, HttpSession& session);
+    ~HttpRequest();
+    HttpRequest(HttpRequest&& other) noexcept;
+    HttpRequest& operator=(HttpRequest&& other) noexcept;
+
     void add_header(std::string_view name, std::string_view value);
     void add_raw_headers(std::string_view headers);
+    // Requests bytes [begin, end) of the resource. If end is not specified everything starting from begin is
+    // requested. Server can ignore it and send the whole resource - check get_status_code() after send().
+    void set_range(size_t begin, std::optional<size_t> end = {});
 
     void set_content_type(std::string_view content_type)
     {
@@ -93,6 +68,15 @@ public:
     void send(std::string_view body = "");
     size_t read(void* buf, size_t buf_size);
     std::optional<std::string> get_header(std::string_view name);
+    std::optional<size_t> get_content_length();
+
+    [[nodiscard]] unsigned long get_status_code() const
+    {
+        return m_status_code;
+    }
+
+private:
+    void check_status_code() const;
 };
 
 std::string encode_uri_component(std::string_view value);
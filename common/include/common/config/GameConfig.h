@@ -78,6 +78,9 @@ struct GameConfig
     CfgVar<unsigned> update_rate = default_update_rate;
 
     CfgVar<unsigned> force_port{0, [](auto val) { return std::min<unsigned>(val, std::numeric_limits<uint16_t>::max()); }};
+    CfgVar<unsigned> level_download_connections{1, [](auto val) { return std::clamp(val, 1u, 8u); }};
+    CfgVar<unsigned> level_cache_size = 1024; // in MB
+    CfgVar<unsigned> rotation_prefetch_rate = 256; // in KB/s, 0 disables prefetching
 
     // Input
     CfgVar<bool> direct_input = false;
@@ -100,6 +103,7 @@ struct GameConfig
     CfgVar<bool> reduced_speed_in_background = false;
     CfgVar<bool> player_join_beep = false;
     CfgVar<bool> autosave = true;
+    CfgVar<bool> level_prefetch = false;
 
     // Internal
     CfgVar<std::string> dash_faction_version{""};
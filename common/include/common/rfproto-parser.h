@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+// Bounds-checked parsing of game packets described in rfproto.h. It does not copy packet data - returned views point
+// into the receive buffer. The code is platform independent so it can be tested and fuzzed outside of the game.
+
+// Side of the connection that has sent the packet. Some packet layouts differ depending on it (e.g. weapon_fire)
+enum class RfPacketSource
+{
+    client,
+    server,
+};
+
+enum class RfPacketError
+{
+    none,
+    truncated_header,  // buffer ends in the middle of a packet header
+    truncated_payload, // packet size from the header exceeds the buffer
+    malformed_payload, // packet payload does not match the packet type layout
+};
+
+// Sequential reader that never reads outside of the underlying buffer. After a failed read the reader stays at
+// the same position.
+class RfPacketReader
+{
+public:
+    RfPacketReader(std::span<const std::byte> data) : data_{data} {}
+
+    template<typename T>
+    bool read(T& out)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (remaining() < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&out, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool skip(size_t len)
+    {
+        if (remaining() < len) {
+            return false;
+        }
+        pos_ += len;
+        return true;
+    }
+
+    // Reads null-terminated string. Returned view does not include the terminator.
+    bool read_string(std::string_view& out)
+    {
+        if (remaining() == 0) {
+            return false;
+        }
+        auto begin = data_.data() + pos_;
+        auto end = static_cast<const std::byte*>(std::memchr(begin, 0, remaining()));
+        if (!end) {
+            return false;
+        }
+        out = {reinterpret_cast<const char*>(begin), static_cast<size_t>(end - begin)};
+        pos_ += out.size() + 1;
+        return true;
+    }
+
+    bool skip_string()
+    {
+        std::string_view unused;
+        return read_string(unused);
+    }
+
+    [[nodiscard]] size_t remaining() const
+    {
+        return data_.size() - pos_;
+    }
+
+    [[nodiscard]] size_t pos() const
+    {
+        return pos_;
+    }
+
+private:
+    std::span<const std::byte> data_;
+    size_t pos_ = 0;
+};
+
+struct RfGamePacketView
+{
+    uint8_t type;
+    std::span<const std::byte> payload; // data following RF_GamePacketHeader
+};
+
+// Splits a buffer passed to multi_io_process_packets into packets and validates every packet payload against its
+// layout. Iteration stops on the first error.
+class RfGamePacketParser
+{
+public:
+    RfGamePacketParser(std::span<const std::byte> buf, RfPacketSource source) : buf_{buf}, source_{source} {}
+
+    // Returns false if there are no more packets or an error occured
+    bool next(RfGamePacketView& packet);
+
+    [[nodiscard]] RfPacketError error() const
+    {
+        return error_;
+    }
+
+    // Offset of the last returned packet or the packet that caused an error
+    [[nodiscard]] size_t packet_offset() const
+    {
+        return packet_offset_;
+    }
+
+private:
+    std::span<const std::byte> buf_;
+    RfPacketSource source_;
+    size_t offset_ = 0;
+    size_t packet_offset_ = 0;
+    RfPacketError error_ = RfPacketError::none;
+};
+
+// Checks if packet payload is long enough for all fields of the packet type layout and if all strings are terminated.
+// Trailing data is allowed because Dash Faction and Pure Faction extend some packets. Packet types not described in
+// rfproto.h (e.g. Pure Faction packets) are always accepted.
+bool rf_validate_game_packet(uint8_t type, std::span<const std::byte> payload, RfPacketSource source);
+
+// Validates all packets in the buffer. On error the offset of the invalid packet is stored in error_offset.
+RfPacketError rf_validate_game_packets(std::span<const std::byte> buf, RfPacketSource source,
+                                       size_t* error_offset = nullptr);
+
+const char* rf_packet_error_str(RfPacketError error);
@@ -43,6 +43,12 @@ inline std::string string_to_lower(std::string_view str)
     return output;
 }
 
+// Lower-case conversion of ASCII letters only, independent of the C locale (unlike std::tolower)
+inline unsigned char ascii_to_lower(unsigned char ch)
+{
+    return ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch;
+}
+
 inline bool string_equals_ignore_case(std::string_view left, std::string_view right)
 {
     return left.size() == right.size() && std::equal(left.begin(), left.end(), right.begin(), [](unsigned char a, unsigned char b) {
@@ -137,6 +143,16 @@ public:
         return *this;
     }
 
+    [[nodiscard]] const std::string& get_prefix() const
+    {
+        return m_prefix;
+    }
+
+    [[nodiscard]] const std::string& get_suffix() const
+    {
+        return m_suffix;
+    }
+
     bool operator()(std::string_view input) const
     {
         if (m_case_sensitive) {
@@ -0,0 +1,376 @@
+#include <common/HttpRequest.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "HttpUrl.h"
+
+// Response header block bigger than that is treated as an error
+constexpr std::size_t max_response_headers_size = 64 * 1024;
+
+[[noreturn]] static void throw_socket_error(const char* msg)
+{
+    throw std::runtime_error(std::string{msg} + ": " + std::strerror(errno));
+}
+
+static bool equals_ignore_case(std::string_view left, std::string_view right)
+{
+    return std::equal(left.begin(), left.end(), right.begin(), right.end(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+}
+
+static std::string_view trim(std::string_view str)
+{
+    auto begin = str.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    auto end = str.find_last_not_of(" \t\r");
+    return str.substr(begin, end - begin + 1);
+}
+
+static timeval make_timeval(unsigned long timeout_ms)
+{
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout_ms / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout_ms % 1000) * 1000);
+    return tv;
+}
+
+struct HttpSession::Impl
+{
+    std::string user_agent;
+    // 0 means no timeout
+    unsigned long connect_timeout_ms = 0;
+    unsigned long send_timeout_ms = 0;
+    unsigned long receive_timeout_ms = 0;
+};
+
+struct HttpRequest::Impl
+{
+    HttpSession::Impl& session;
+    std::string method;
+    std::string host;
+    unsigned short port = 80;
+    std::string resource;
+    std::string request_headers;
+    // Body is sent together with the request in send()
+    std::string request_body;
+    int fd = -1;
+    std::vector<std::pair<std::string, std::string>> response_headers;
+    // Part of the response body received together with headers
+    std::string received_body;
+    std::size_t received_body_pos = 0;
+    // Number of body bytes not read yet if the response has Content-Length header, otherwise the body ends when the
+    // connection is closed
+    std::optional<std::size_t> body_remaining;
+
+    Impl(HttpSession::Impl& session) : session{session} {}
+
+    ~Impl()
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    void connect_to_host();
+    void send_all(std::string_view data);
+    unsigned long receive_headers();
+    unsigned long parse_headers(std::string_view headers);
+};
+
+void HttpRequest::Impl::connect_to_host()
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addrs = nullptr;
+    int err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addrs);
+    if (err != 0) {
+        throw std::runtime_error(std::string{"getaddrinfo failed: "} + gai_strerror(err));
+    }
+
+    int connect_errno = 0;
+    for (addrinfo* addr = addrs; addr && fd < 0; addr = addr->ai_next) {
+        fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0) {
+            connect_errno = errno;
+            continue;
+        }
+        // Connect in non-blocking mode so connect timeout can be applied
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        int result = connect(fd, addr->ai_addr, addr->ai_addrlen);
+        if (result != 0 && errno == EINPROGRESS) {
+            pollfd pfd{fd, POLLOUT, 0};
+            int timeout = session.connect_timeout_ms ? static_cast<int>(session.connect_timeout_ms) : -1;
+            result = poll(&pfd, 1, timeout);
+            if (result == 0) {
+                errno = ETIMEDOUT;
+                result = -1;
+            }
+            else if (result > 0) {
+                int so_error = 0;
+                socklen_t len = sizeof(so_error);
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+                errno = so_error;
+                result = so_error ? -1 : 0;
+            }
+        }
+        if (result != 0) {
+            connect_errno = errno;
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        fcntl(fd, F_SETFL, flags);
+    }
+    freeaddrinfo(addrs);
+    if (fd < 0) {
+        errno = connect_errno;
+        throw_socket_error("cannot connect");
+    }
+
+    if (session.send_timeout_ms) {
+        timeval tv = make_timeval(session.send_timeout_ms);
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+    if (session.receive_timeout_ms) {
+        timeval tv = make_timeval(session.receive_timeout_ms);
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+}
+
+void HttpRequest::Impl::send_all(std::string_view data)
+{
+    while (!data.empty()) {
+        ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_socket_error(errno == EAGAIN || errno == EWOULDBLOCK ? "send timed out" : "send failed");
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+}
+
+unsigned long HttpRequest::Impl::parse_headers(std::string_view headers)
+{
+    auto status_line_end = headers.find("\r\n");
+    std::string_view status_line = headers.substr(0, status_line_end);
+    if (!status_line.starts_with("HTTP/")) {
+        throw std::runtime_error("invalid HTTP response");
+    }
+    auto status_pos = status_line.find(' ');
+    if (status_pos == std::string_view::npos) {
+        throw std::runtime_error("invalid HTTP response");
+    }
+    unsigned long status_code = std::stoul(std::string{status_line.substr(status_pos + 1, 3)});
+
+    std::size_t pos = status_line_end == std::string_view::npos ? headers.size() : status_line_end + 2;
+    while (pos < headers.size()) {
+        auto line_end = headers.find("\r\n", pos);
+        if (line_end == std::string_view::npos) {
+            line_end = headers.size();
+        }
+        std::string_view line = headers.substr(pos, line_end - pos);
+        auto colon_pos = line.find(':');
+        if (colon_pos != std::string_view::npos) {
+            response_headers.emplace_back(trim(line.substr(0, colon_pos)), trim(line.substr(colon_pos + 1)));
+        }
+        pos = line_end + 2;
+    }
+    return status_code;
+}
+
+// Returns the status code
+unsigned long HttpRequest::Impl::receive_headers()
+{
+    std::string buf;
+    std::size_t headers_end;
+    char chunk[4096];
+    while ((headers_end = buf.find("\r\n\r\n")) == std::string::npos) {
+        if (buf.size() > max_response_headers_size) {
+            throw std::runtime_error("HTTP response headers are too big");
+        }
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_socket_error(errno == EAGAIN || errno == EWOULDBLOCK ? "receive timed out" : "recv failed");
+        }
+        if (received == 0) {
+            throw std::runtime_error("connection closed before the end of HTTP response headers");
+        }
+        buf.append(chunk, static_cast<std::size_t>(received));
+    }
+    received_body = buf.substr(headers_end + 4);
+    buf.resize(headers_end);
+    response_headers.clear();
+    return parse_headers(buf);
+}
+
+HttpSession::HttpSession(const char* user_agent) : m_impl{std::make_unique<Impl>()}
+{
+    m_impl->user_agent = user_agent;
+}
+
+HttpSession::~HttpSession() = default;
+
+void HttpSession::set_connect_timeout(unsigned long timeout_ms)
+{
+    m_impl->connect_timeout_ms = timeout_ms;
+}
+
+void HttpSession::set_send_timeout(unsigned long timeout_ms)
+{
+    m_impl->send_timeout_ms = timeout_ms;
+}
+
+void HttpSession::set_receive_timeout(unsigned long timeout_ms)
+{
+    m_impl->receive_timeout_ms = timeout_ms;
+}
+
+HttpRequest::HttpRequest(std::string_view url, const char* method, HttpSession& session) :
+    m_impl{std::make_unique<Impl>(session.get_impl())}
+{
+    ParsedUrl parsed_url = parse_http_url(url);
+    if (parsed_url.ssl) {
+        throw std::runtime_error("HTTPS is not supported by the socket HTTP backend");
+    }
+    m_impl->method = method;
+    m_impl->host = parsed_url.host;
+    m_impl->port = parsed_url.port.value_or(80);
+    m_impl->resource = parsed_url.resource.empty() ? "/" : parsed_url.resource;
+}
+
+HttpRequest::~HttpRequest() = default;
+HttpRequest::HttpRequest(HttpRequest&& other) noexcept = default;
+HttpRequest& HttpRequest::operator=(HttpRequest&& other) noexcept = default;
+
+void HttpRequest::add_raw_headers(std::string_view headers)
+{
+    m_impl->request_headers += headers;
+    if (!headers.ends_with("\r\n")) {
+        m_impl->request_headers += "\r\n";
+    }
+}
+
+void HttpRequest::begin_body(size_t total_body_size)
+{
+    m_impl->request_body.reserve(total_body_size);
+    m_in_body = true;
+}
+
+void HttpRequest::write(const void* data, size_t len)
+{
+    m_impl->request_body.append(static_cast<const char*>(data), len);
+}
+
+void HttpRequest::send(std::string_view body)
+{
+    m_impl->request_body += body;
+
+    // HTTP/1.0 is used like in the WinINet backend so the server does not use chunked encoding and closes the
+    // connection after the response
+    std::string request = m_impl->method + " " + m_impl->resource + " HTTP/1.0\r\n";
+    request += "Host: " + m_impl->host;
+    if (m_impl->port != 80) {
+        request += ":" + std::to_string(m_impl->port);
+    }
+    request += "\r\nUser-Agent: " + m_impl->session.user_agent + "\r\n";
+    request += m_impl->request_headers;
+    if (!m_impl->request_body.empty() || m_in_body) {
+        request += "Content-Length: " + std::to_string(m_impl->request_body.size()) + "\r\n";
+    }
+    request += "\r\n";
+
+    m_impl->connect_to_host();
+    m_impl->send_all(request);
+    m_impl->send_all(m_impl->request_body);
+    m_impl->request_body = {};
+    m_status_code = m_impl->receive_headers();
+    m_impl->body_remaining.reset();
+    if (m_impl->method == "HEAD" || m_status_code == 204 || m_status_code == 304) {
+        m_impl->body_remaining = 0;
+    }
+    else {
+        m_impl->body_remaining = get_content_length();
+    }
+    check_status_code();
+}
+
+size_t HttpRequest::read(void* buf, size_t buf_size)
+{
+    // Stop at the end of the body even if the server keeps the connection open or sends more data
+    auto& body_remaining = m_impl->body_remaining;
+    if (body_remaining) {
+        buf_size = std::min(buf_size, body_remaining.value());
+        if (buf_size == 0) {
+            return 0;
+        }
+    }
+    if (m_impl->received_body_pos < m_impl->received_body.size()) {
+        std::size_t len = std::min(buf_size, m_impl->received_body.size() - m_impl->received_body_pos);
+        std::memcpy(buf, m_impl->received_body.data() + m_impl->received_body_pos, len);
+        m_impl->received_body_pos += len;
+        if (body_remaining) {
+            body_remaining.value() -= len;
+        }
+        return len;
+    }
+    while (true) {
+        ssize_t received = recv(m_impl->fd, buf, buf_size, 0);
+        if (received >= 0) {
+            if (body_remaining) {
+                body_remaining.value() -= static_cast<std::size_t>(received);
+            }
+            return static_cast<std::size_t>(received);
+        }
+        if (errno != EINTR) {
+            throw_socket_error(errno == EAGAIN || errno == EWOULDBLOCK ? "receive timed out" : "recv failed");
+        }
+    }
+}
+
+std::optional<std::string> HttpRequest::get_header(std::string_view name)
+{
+    for (const auto& [header_name, value] : m_impl->response_headers) {
+        if (equals_ignore_case(header_name, name)) {
+            return {value};
+        }
+    }
+    return {};
+}
+
+std::optional<size_t> HttpRequest::get_content_length()
+{
+    auto value = get_header("Content-Length");
+    if (!value) {
+        return {};
+    }
+    try {
+        return {static_cast<size_t>(std::stoull(value.value()))};
+    }
+    catch (const std::exception&) {
+        return {};
+    }
+}
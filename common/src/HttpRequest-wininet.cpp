@@ -0,0 +1,207 @@
+#include <windows.h>
+#include <wininet.h>
+#include <common/HttpRequest.h>
+#include <common/error/Win32Error.h>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <format>
+#include <utility>
+#include "HttpUrl.h"
+
+class InternetHandle
+{
+private:
+    HINTERNET m_handle = nullptr;
+
+public:
+    InternetHandle() = default;
+
+    ~InternetHandle()
+    {
+        if (m_handle)
+            InternetCloseHandle(m_handle);
+    }
+
+    InternetHandle(const InternetHandle&) = delete; // copy constructor
+    InternetHandle& operator=(const InternetHandle&) = delete; // assignment operator
+
+    InternetHandle(InternetHandle&& other) noexcept : // move constructor
+        m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+
+    InternetHandle& operator=(InternetHandle&& other) noexcept // move assignment
+    {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+
+    InternetHandle &operator=(HINTERNET handle)
+    {
+        if (m_handle)
+            InternetCloseHandle(m_handle);
+        m_handle = handle;
+        return *this;
+    }
+
+    operator HINTERNET() const
+    {
+        return m_handle;
+    }
+};
+
+struct HttpSession::Impl
+{
+    InternetHandle inet;
+};
+
+struct HttpRequest::Impl
+{
+    InternetHandle conn;
+    InternetHandle req;
+};
+
+HttpSession::HttpSession(const char* user_agent) : m_impl{std::make_unique<Impl>()}
+{
+    m_impl->inet = InternetOpenA(user_agent, INTERNET_OPEN_TYPE_PRECONFIG, nullptr, nullptr, 0);
+    if (!m_impl->inet)
+        THROW_WIN32_ERROR();
+}
+
+HttpSession::~HttpSession() = default;
+
+void HttpSession::set_connect_timeout(unsigned long timeout_ms)
+{
+    if (!InternetSetOptionA(m_impl->inet, INTERNET_OPTION_CONNECT_TIMEOUT, const_cast<unsigned long*>(&timeout_ms),
+                            sizeof(timeout_ms)))
+        THROW_WIN32_ERROR();
+}
+
+void HttpSession::set_send_timeout(unsigned long timeout_ms)
+{
+    if (!InternetSetOptionA(m_impl->inet, INTERNET_OPTION_SEND_TIMEOUT, const_cast<unsigned long*>(&timeout_ms),
+                       sizeof(timeout_ms)))
+        THROW_WIN32_ERROR();
+}
+
+void HttpSession::set_receive_timeout(unsigned long timeout_ms)
+{
+    if (!InternetSetOptionA(m_impl->inet, INTERNET_OPTION_RECEIVE_TIMEOUT, const_cast<unsigned long*>(&timeout_ms),
+                       sizeof(timeout_ms)))
+        THROW_WIN32_ERROR();
+}
+
+HttpRequest::HttpRequest(std::string_view url, const char* method, HttpSession& session) :
+    m_impl{std::make_unique<Impl>()}
+{
+    ParsedUrl parsed_url = parse_http_url(url);
+
+    HINTERNET inet = session.get_impl().inet;
+    int default_port = parsed_url.ssl ? INTERNET_DEFAULT_HTTPS_PORT : INTERNET_DEFAULT_HTTP_PORT;
+    int port = parsed_url.port.value_or(default_port);
+    m_impl->conn = InternetConnectA(inet, parsed_url.host.c_str(), port, nullptr, nullptr, INTERNET_SERVICE_HTTP, 0, 0);
+    if (!m_impl->conn) {
+        THROW_WIN32_ERROR();
+    }
+
+    DWORD flags = INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE;
+    if (parsed_url.ssl)
+        flags |= INTERNET_FLAG_SECURE;
+
+    m_impl->req = HttpOpenRequestA(m_impl->conn, method, parsed_url.resource.c_str(), "HTTP/1.0", nullptr, nullptr,
+                                   flags, 0);
+    if (!m_impl->req) {
+        THROW_WIN32_ERROR();
+    }
+}
+
+HttpRequest::~HttpRequest() = default;
+HttpRequest::HttpRequest(HttpRequest&& other) noexcept = default;
+HttpRequest& HttpRequest::operator=(HttpRequest&& other) noexcept = default;
+
+void HttpRequest::add_raw_headers(std::string_view headers)
+{
+    HttpAddRequestHeadersA(m_impl->req, headers.data(), headers.size(), 0);
+}
+
+void HttpRequest::begin_body(size_t total_body_size)
+{
+    INTERNET_BUFFERS inet_buffers;
+    ZeroMemory(&inet_buffers, sizeof(inet_buffers));
+    inet_buffers.dwStructSize = sizeof(inet_buffers);
+    inet_buffers.dwBufferTotal = total_body_size;
+    if (!HttpSendRequestExA(m_impl->req, &inet_buffers, nullptr, 0, 0))
+        THROW_WIN32_ERROR();
+    m_in_body = true;
+}
+
+void HttpRequest::write(const void* data, size_t len)
+{
+    DWORD written;
+    while (len > 0) {
+        if (!InternetWriteFile(m_impl->req, data, len, &written))
+            THROW_WIN32_ERROR();
+        if (!written)
+            THROW_EXCEPTION("Unable to write {} request body bytes", len);
+        data = static_cast<const std::byte*>(data) + written;
+        len -= written;
+    }
+}
+
+void HttpRequest::send(std::string_view body)
+{
+    if (m_in_body) {
+        write(body);
+        if (!HttpEndRequestA(m_impl->req, nullptr, 0, 0))
+            THROW_WIN32_ERROR();
+    }
+    else {
+        if (!HttpSendRequestA(m_impl->req, nullptr, 0, const_cast<char*>(body.data()), body.size()))
+            THROW_WIN32_ERROR();
+    }
+
+    DWORD dw_size = sizeof(DWORD);
+    DWORD status_code;
+    if (!HttpQueryInfoA(m_impl->req, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, &status_code, &dw_size,
+                        nullptr)) {
+        THROW_WIN32_ERROR();
+    }
+    m_status_code = status_code;
+    check_status_code();
+}
+
+size_t HttpRequest::read(void* buf, size_t buf_size)
+{
+    DWORD read;
+    if (!InternetReadFile(m_impl->req, buf, buf_size, &read))
+        THROW_WIN32_ERROR();
+    return read;
+}
+
+std::optional<std::string> HttpRequest::get_header(std::string_view name)
+{
+    DWORD index = 0;
+    std::string buf{name};
+    buf.resize(1024);
+
+    DWORD buf_len = buf.size();
+    if (!HttpQueryInfoA(m_impl->req, HTTP_QUERY_CUSTOM, buf.data(), &buf_len, &index)) {
+        if (GetLastError() == ERROR_HTTP_HEADER_NOT_FOUND) {
+            return {};
+        }
+        THROW_WIN32_ERROR();
+    }
+    buf.resize(buf_len);
+    return {buf};
+}
+
+std::optional<size_t> HttpRequest::get_content_length()
+{
+    DWORD content_length;
+    DWORD dw_size = sizeof(content_length);
+    if (!HttpQueryInfoA(m_impl->req, HTTP_QUERY_CONTENT_LENGTH | HTTP_QUERY_FLAG_NUMBER, &content_length, &dw_size,
+                        nullptr)) {
+        return {};
+    }
+    return {content_length};
+}
@@ -1,19 +1,13 @@
 #include <common/HttpRequest.h>
-#include <common/error/Win32Error.h>
 #include <string>
 #include <string_view>
 #include <format>
+#include <stdexcept>
 #include <cassert>
 #include <cctype>
+#include "HttpUrl.h"
 
-struct ParsedUrl
-{
-    bool ssl;
-    std::string host;
-    std::string resource;
-};
-
-static ParsedUrl parse_http_url(std::string_view url)
+ParsedUrl parse_http_url(std::string_view url)
 {
     ParsedUrl result;
     std::string_view http = "http://";
@@ -41,56 +35,13 @@ static ParsedUrl parse_http_url(std::string_view url)
         result.host = url.substr(host_pos);
         result.resource = "";
     }
-    return result;
-}
-
-HttpSession::HttpSession(const char* user_agent)
-{
-    m_inet = InternetOpenA(user_agent, INTERNET_OPEN_TYPE_PRECONFIG, nullptr, nullptr, 0);
-    if (!m_inet)
-        THROW_WIN32_ERROR();
-}
-
-void HttpSession::set_connect_timeout(unsigned long timeout_ms)
-{
-    if (!InternetSetOptionA(m_inet, INTERNET_OPTION_CONNECT_TIMEOUT, const_cast<unsigned long*>(&timeout_ms),
-                            sizeof(timeout_ms)))
-        THROW_WIN32_ERROR();
-}
-
-void HttpSession::set_send_timeout(unsigned long timeout_ms)
-{
-    if (!InternetSetOptionA(m_inet, INTERNET_OPTION_SEND_TIMEOUT, const_cast<unsigned long*>(&timeout_ms),
-                       sizeof(timeout_ms)))
-        THROW_WIN32_ERROR();
-}
-
-void HttpSession::set_receive_timeout(unsigned long timeout_ms)
-{
-    if (!InternetSetOptionA(m_inet, INTERNET_OPTION_RECEIVE_TIMEOUT, const_cast<unsigned long*>(&timeout_ms),
-                       sizeof(timeout_ms)))
-        THROW_WIN32_ERROR();
-}
-
-HttpRequest::HttpRequest(std::string_view url, const char* method, HttpSession& session)
-{
-    ParsedUrl parsed_url = parse_http_url(url);
-
-    HINTERNET inet = session.get_internet_handle();
-    int port = parsed_url.ssl ? INTERNET_DEFAULT_HTTPS_PORT : INTERNET_DEFAULT_HTTP_PORT;
-    m_conn = InternetConnectA(inet, parsed_url.host.c_str(), port, nullptr, nullptr, INTERNET_SERVICE_HTTP, 0, 0);
-    if (!m_conn) {
-        THROW_WIN32_ERROR();
-    }
-
-    DWORD flags = INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE;
-    if (parsed_url.ssl)
-        flags |= INTERNET_FLAG_SECURE;
 
-    m_req = HttpOpenRequestA(m_conn, method, parsed_url.resource.c_str(), "HTTP/1.0", nullptr, nullptr, flags, 0);
-    if (!m_req) {
-        THROW_WIN32_ERROR();
+    size_t port_pos = result.host.rfind(':');
+    if (port_pos != std::string::npos) {
+        result.port = static_cast<unsigned short>(std::stoul(result.host.substr(port_pos + 1)));
+        result.host.resize(port_pos);
     }
+    return result;
 }
 
 void HttpRequest::add_header(std::string_view name, std::string_view value)
@@ -99,82 +50,22 @@ void HttpRequest::add_header(std::string_view name, std::string_view value)
     add_raw_headers(str);
 }
 
-void HttpRequest::add_raw_headers(std::string_view headers)
-{
-    HttpAddRequestHeadersA(m_req, headers.data(), headers.size(), 0);
-}
-
-void HttpRequest::begin_body(size_t total_body_size)
-{
-    INTERNET_BUFFERS inet_buffers;
-    ZeroMemory(&inet_buffers, sizeof(inet_buffers));
-    inet_buffers.dwStructSize = sizeof(inet_buffers);
-    inet_buffers.dwBufferTotal = total_body_size;
-    if (!HttpSendRequestExA(m_req, &inet_buffers, nullptr, 0, 0))
-        THROW_WIN32_ERROR();
-    m_in_body = true;
-}
-
-void HttpRequest::write(const void* data, size_t len)
-{
-    DWORD written;
-    while (len > 0) {
-        if (!InternetWriteFile(m_req, data, len, &written))
-            THROW_WIN32_ERROR();
-        if (!written)
-            THROW_EXCEPTION("Unable to write {} request body bytes", len);
-        data = static_cast<const std::byte*>(data) + written;
-        len -= written;
-    }
-}
-
-void HttpRequest::send(std::string_view body)
+void HttpRequest::set_range(size_t begin, std::optional<size_t> end)
 {
-    if (m_in_body) {
-        write(body);
-        if (!HttpEndRequestA(m_req, nullptr, 0, 0))
-            THROW_WIN32_ERROR();
+    if (end) {
+        add_header("Range", std::format("bytes={}-{}", begin, end.value() - 1));
     }
     else {
-        if (!HttpSendRequestA(m_req, nullptr, 0, const_cast<char*>(body.data()), body.size()))
-            THROW_WIN32_ERROR();
-    }
-
-    DWORD dw_size = sizeof(DWORD);
-    DWORD status_code;
-    if (!HttpQueryInfoA(m_req, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, &status_code, &dw_size,
-                        nullptr)) {
-        THROW_WIN32_ERROR();
-    }
-
-    if (status_code != 200) {
-        throw std::runtime_error(std::format("Invalid HTTP status code: {}", status_code));
+        add_header("Range", std::format("bytes={}-", begin));
     }
 }
 
-size_t HttpRequest::read(void* buf, size_t buf_size)
+void HttpRequest::check_status_code() const
 {
-    DWORD read;
-    if (!InternetReadFile(m_req, buf, buf_size, &read))
-        THROW_WIN32_ERROR();
-    return read;
-}
-
-std::optional<std::string> HttpRequest::get_header(std::string_view name)
-{
-    DWORD index = 0;
-    std::string buf{name};
-    buf.resize(1024);
-
-    DWORD buf_len = buf.size();
-    if (!HttpQueryInfoA(m_req, HTTP_QUERY_CUSTOM, buf.data(), &buf_len, &index)) {
-        if (GetLastError() == ERROR_HTTP_HEADER_NOT_FOUND) {
-            return {};
-        }
-        THROW_WIN32_ERROR();
+    // 206 Partial Content is a response to a range request
+    if (m_status_code != 200 && m_status_code != 206) {
+        throw std::runtime_error(std::format("Invalid HTTP status code: {}", m_status_code));
     }
-    buf.resize(buf_len);
-    return {buf};
 }
 
 static bool is_uri_reserved_char(char c)
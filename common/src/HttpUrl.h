@@ -0,0 +1,17 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Used by HTTP client backends
+struct ParsedUrl
+{
+    bool ssl;
+    std::string host;
+    // default port for the scheme is used if not specified in the URL
+    std::optional<unsigned short> port;
+    std::string resource;
+};
+
+ParsedUrl parse_http_url(std::string_view url);
@@ -183,6 +183,10 @@ bool GameConfig::visit_vars(T&& visitor, bool is_save)
     result &= visitor(dash_faction_key, "Mesh Static Lighting", mesh_static_lighting);
     result &= visitor(dash_faction_key, "Player Join Beep", player_join_beep);
     result &= visitor(dash_faction_key, "Autosave", autosave);
+    result &= visitor(dash_faction_key, "Level Download Connections", level_download_connections);
+    result &= visitor(dash_faction_key, "Level Cache Size", level_cache_size);
+    result &= visitor(dash_faction_key, "Rotation Prefetch Rate", rotation_prefetch_rate);
+    result &= visitor(dash_faction_key, "Level Asset Prefetch", level_prefetch);
 
     return result;
 }
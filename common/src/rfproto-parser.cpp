@@ -0,0 +1,311 @@
+#include <common/rfproto-parser.h>
+#include <common/rfproto.h>
+#include <array>
+
+namespace
+{
+    using PacketValidator = bool(RfPacketReader& reader, RfPacketSource source);
+
+    struct PacketLayout
+    {
+        // Size of the fixed part of the payload. It is checked before calling the validator.
+        uint16_t min_size = 0;
+        // Validates the variable part of the payload (optional)
+        PacketValidator* validator = nullptr;
+    };
+
+    template<typename T>
+    constexpr PacketLayout fixed_layout()
+    {
+        return {static_cast<uint16_t>(sizeof(T) - sizeof(RF_GamePacketHeader)), nullptr};
+    }
+
+    template<typename T>
+    constexpr PacketLayout variable_layout(PacketValidator* validator)
+    {
+        return {static_cast<uint16_t>(sizeof(T) - sizeof(RF_GamePacketHeader)), validator};
+    }
+
+    constexpr PacketLayout unknown_layout()
+    {
+        return {};
+    }
+
+    constexpr size_t vector_size = sizeof(RF_Vector);
+    constexpr size_t matrix_size = sizeof(RF_Matrix);
+
+    bool validate_game_info(RfPacketReader& reader, RfPacketSource)
+    {
+        return reader.skip(1)        // version
+            && reader.skip_string()  // name
+            && reader.skip(3)        // game type, player count, max player count
+            && reader.skip_string()  // level
+            && reader.skip_string()  // mod
+            && reader.skip(1);       // flags
+    }
+
+    bool validate_join_request(RfPacketReader& reader, RfPacketSource)
+    {
+        uint8_t version = 0;
+        if (!reader.read(version)
+            || !reader.skip_string() // name
+            || !reader.skip(4)       // entity type
+            || !reader.skip_string() // password
+            || !reader.skip(4)) {    // rate
+            return false;
+        }
+        if (version == RF_VER_10_11 && !reader.skip(16)) { // meshes.vpp and motions.vpp checksums and sizes
+            return false;
+        }
+        return reader.skip(16); // tables.vpp and mod checksums and sizes
+    }
+
+    bool validate_join_accept(RfPacketReader& reader, RfPacketSource)
+    {
+        return reader.skip_string() && reader.skip(sizeof(RF_JoinAcceptRest));
+    }
+
+    bool validate_string(RfPacketReader& reader, RfPacketSource)
+    {
+        return reader.skip_string();
+    }
+
+    // String following the fixed part of the packet
+    template<typename T>
+    bool validate_trailing_string(RfPacketReader& reader, RfPacketSource)
+    {
+        return reader.skip(sizeof(T) - sizeof(RF_GamePacketHeader)) && reader.skip_string();
+    }
+
+    bool validate_leave_limbo(RfPacketReader& reader, RfPacketSource)
+    {
+        return reader.skip_string() && reader.skip(4); // level name, level checksum
+    }
+
+    bool validate_netgame_update(RfPacketReader& reader, RfPacketSource)
+    {
+        uint8_t player_count = 0;
+        return reader.skip(1)
+            && reader.read(player_count)
+            && reader.skip(player_count * sizeof(RF_PlayerStats))
+            && reader.skip(8); // level time, time limit
+    }
+
+    bool validate_ctf_flag_update(RfPacketReader& reader, RfPacketSource)
+    {
+        for (int team = 0; team < 2; ++team) {
+            uint8_t player_id = 0;
+            if (!reader.read(player_id)) {
+                return false;
+            }
+            if (player_id == 0xFF) {
+                uint8_t in_base = 0;
+                if (!reader.read(in_base)) {
+                    return false;
+                }
+                if (!in_base && !reader.skip(vector_size + matrix_size)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool validate_obj_update(RfPacketReader& reader, RfPacketSource)
+    {
+        while (true) {
+            uint32_t handle = 0;
+            uint8_t flags = 0;
+            if (!reader.read(handle)) {
+                return false;
+            }
+            if (handle == 0xFFFFFFFF) {
+                return true;
+            }
+            if (!reader.read(flags)) {
+                return false;
+            }
+            if ((flags & RF_OUF_POS_ROT_ANIM) && !reader.skip(2 + vector_size + 2 + 2 + 4)) {
+                return false;
+            }
+            if ((flags & RF_OUF_AMP_FLAGS) && !reader.skip(1)) {
+                return false;
+            }
+            if ((flags & RF_OUF_WEAPON_TYPE) && !reader.skip(1)) {
+                return false;
+            }
+            if ((flags & RF_OUF_HEATH_ARMOR) && !reader.skip(3)) {
+                return false;
+            }
+            if (flags & RF_OUF_UNKNOWN3) {
+                uint8_t count = 0;
+                if (!reader.read(count) || !reader.skip(count * 3)) {
+                    return false;
+                }
+            }
+            if ((flags & RF_OUF_UNKNOWN4) && !reader.skip(2)) {
+                return false;
+            }
+        }
+    }
+
+    bool validate_entity_create(RfPacketReader& reader, RfPacketSource)
+    {
+        return reader.skip_string() && reader.skip(sizeof(RF_EntityCreatePacketRest));
+    }
+
+    bool validate_item_create(RfPacketReader& reader, RfPacketSource)
+    {
+        // unknown, item type, respawn time, count, handle, item bit, unknown2, position, orientation
+        return reader.skip_string() && reader.skip(1 + 4 + 4 + 4 + 4 + 2 + 1 + vector_size + matrix_size);
+    }
+
+    bool validate_weapon_fire(RfPacketReader& reader, RfPacketSource source)
+    {
+        uint8_t flags = 0;
+        if (!reader.skip(1) || !reader.read(flags)) {
+            return false;
+        }
+        if (source == RfPacketSource::server && !reader.skip(1)) { // player ID
+            return false;
+        }
+        if (!(flags & RF_WFF_NO_POS_ROT) && !reader.skip(vector_size + 3 * sizeof(int16_t))) {
+            return false;
+        }
+        if ((flags & RF_WFF_UNKNOWN) && !reader.skip(1)) {
+            return false;
+        }
+        return true;
+    }
+
+    // Layouts of packets sent by the game indexed by packet type. Layouts that are not fully known are described only
+    // by the size of the part that is known (zero if nothing is known). Note: obj_kill packet is validated only up to
+    // the flags field because the item part has not been fully reverse engineered (the game reads an item name from
+    // it). String copies in handlers are additionally protected by BufferOverflowPatch.
+    constexpr std::array packet_layouts{
+        unknown_layout(),                                                                       // game_info_request
+        variable_layout<RF_GameInfoPacket>(validate_game_info),                                 // game_info
+        variable_layout<RF_JoinRequestPacket>(validate_join_request),                           // join_request
+        variable_layout<RF_JoinAcceptPacket>(validate_join_accept),                             // join_accept
+        fixed_layout<RF_JoinDenyPacket>(),                                                      // join_deny
+        variable_layout<RF_NewPlayerPacket>(validate_trailing_string<RF_NewPlayerPacket>),      // new_player
+        unknown_layout(),                                                                       // players
+        fixed_layout<RF_LeftGamePacket>(),                                                      // left_game
+        unknown_layout(),                                                                       // end_game
+        variable_layout<RF_StateInfoRequestPacket>(validate_string),                            // state_info_request
+        unknown_layout(),                                                                       // state_info_done
+        unknown_layout(),                                                                       // client_in_game
+        variable_layout<RF_ChatLinePacket>(validate_trailing_string<RF_ChatLinePacket>),        // chat_line
+        variable_layout<RF_NameChangePacket>(validate_trailing_string<RF_NameChangePacket>),    // name_change
+        fixed_layout<RF_RespawnRequestPacket>(),                                                // respawn_request
+        fixed_layout<RF_TriggerActivatePacket>(),                                               // trigger_activate
+        unknown_layout(),                                                                       // use_key_pressed
+        unknown_layout(),                                                                       // pregame_boolean
+        fixed_layout<RF_PregameGlassPacket>(),                                                  // pregame_glass
+        unknown_layout(),                                                                       // pregame_remote_charge
+        unknown_layout(),                                                                       // suicide
+        unknown_layout(),                                                                       // enter_limbo
+        variable_layout<RF_LeaveLimboPacket>(validate_leave_limbo),                             // leave_limbo
+        fixed_layout<RF_TeamChangePacket>(),                                                    // team_change
+        unknown_layout(),                                                                       // ping
+        unknown_layout(),                                                                       // pong
+        variable_layout<RF_NetgameUpdatePacket>(validate_netgame_update),                       // netgame_update
+        fixed_layout<RF_RateChangePacket>(),                                                    // rate_change
+        unknown_layout(),                                                                       // select_weapon
+        fixed_layout<RF_PregameClutterPacket>(),                                                // clutter_update
+        fixed_layout<RF_ClutterKillPacket>(),                                                   // clutter_kill
+        fixed_layout<RF_CtfFlagPickedUpPacket>(),                                               // ctf_flag_picked_up
+        fixed_layout<RF_CtfFlagCapturedPacket>(),                                               // ctf_flag_captured
+        variable_layout<RF_CtfFlagUpdatePacket>(validate_ctf_flag_update),                      // ctf_flag_update
+        fixed_layout<RF_CtfFlagReturnedPacket>(),                                               // ctf_flag_returned
+        fixed_layout<RF_CtfFlagDropedPacket>(),                                                 // ctf_flag_droped
+        fixed_layout<RF_RemoteChargeKillPacket>(),                                              // remote_charge_kill
+        fixed_layout<RF_ItemUpdatePacket>(),                                                    // item_update
+        variable_layout<RF_ObjectUpdatePacket>(validate_obj_update),                            // obj_update
+        fixed_layout<RF_ObjectKillPacket>(),                                                    // obj_kill
+        fixed_layout<RF_ItemApplyPacket>(),                                                     // item_apply
+        unknown_layout(),                                                                       // boolean
+        unknown_layout(),                                                                       // mover_update
+        unknown_layout(),                                                                       // respawn
+        variable_layout<RF_EntityCreatePacket>(validate_entity_create),                         // entity_create
+        variable_layout<RF_ItemCreatePacket>(validate_item_create),                             // item_create
+        fixed_layout<RF_ReloadPacket>(),                                                        // reload
+        fixed_layout<RF_ReloadRequestPacket>(),                                                 // reload_request
+        variable_layout<RF_WeaponFirePacket>(validate_weapon_fire),                             // weapon_fire
+        fixed_layout<RF_FallDamagePacket>(),                                                    // fall_damage
+        PacketLayout{0, validate_string},                                                       // rcon_request
+        PacketLayout{0, validate_string},                                                       // rcon
+        fixed_layout<RF_SoundPacket>(),                                                         // sound
+        fixed_layout<RF_TeamsScoresPacket>(),                                                   // team_scores
+        fixed_layout<RF_GlassKillPacket>(),                                                     // glass_kill
+    };
+    static_assert(packet_layouts.size() == RF_GPT_GLASS_KILL + 1);
+}
+
+bool rf_validate_game_packet(uint8_t type, std::span<const std::byte> payload, RfPacketSource source)
+{
+    if (type >= packet_layouts.size()) {
+        return true;
+    }
+    const auto& layout = packet_layouts[type];
+    if (payload.size() < layout.min_size) {
+        return false;
+    }
+    if (!layout.validator) {
+        return true;
+    }
+    RfPacketReader reader{payload};
+    return layout.validator(reader, source);
+}
+
+bool RfGamePacketParser::next(RfGamePacketView& packet)
+{
+    if (error_ != RfPacketError::none || offset_ == buf_.size()) {
+        return false;
+    }
+    packet_offset_ = offset_;
+    RF_GamePacketHeader header;
+    if (buf_.size() - offset_ < sizeof(header)) {
+        error_ = RfPacketError::truncated_header;
+        return false;
+    }
+    std::memcpy(&header, buf_.data() + offset_, sizeof(header));
+    size_t payload_offset = offset_ + sizeof(header);
+    if (buf_.size() - payload_offset < header.size) {
+        error_ = RfPacketError::truncated_payload;
+        return false;
+    }
+    auto payload = buf_.subspan(payload_offset, header.size);
+    if (!rf_validate_game_packet(header.type, payload, source_)) {
+        error_ = RfPacketError::malformed_payload;
+        return false;
+    }
+    packet.type = header.type;
+    packet.payload = payload;
+    offset_ = payload_offset + header.size;
+    return true;
+}
+
+RfPacketError rf_validate_game_packets(std::span<const std::byte> buf, RfPacketSource source, size_t* error_offset)
+{
+    RfGamePacketParser parser{buf, source};
+    RfGamePacketView packet;
+    while (parser.next(packet)) {
+        // only validate
+    }
+    if (parser.error() != RfPacketError::none && error_offset) {
+        *error_offset = parser.packet_offset();
+    }
+    return parser.error();
+}
+
+const char* rf_packet_error_str(RfPacketError error)
+{
+    switch (error) {
+        case RfPacketError::none: return "none";
+        case RfPacketError::truncated_header: return "truncated header";
+        case RfPacketError::truncated_payload: return "truncated payload";
+        case RfPacketError::malformed_payload: return "malformed payload";
+    }
+    return "unknown";
+}
@@ -1,11 +1,32 @@
+#include <vector>
 #include <xlog/xlog.h>
 #include "gr_d3d11_shader.h"
 #include "gr_d3d11.h"
+#include "../../misc/vpackfile.h"
 #include "../../rf/file/file.h"
 #include "gr_d3d11_context.h"
 
 namespace df::gr::d3d11
 {
+    // Shaders stored in packfiles are used directly from the packfile mapping. Other files (e.g. loose files in the
+    // game directory) are read into buf by rf::File.
+    static std::optional<std::span<const std::byte>> load_shader_file(const char* filename, std::vector<std::byte>& buf)
+    {
+        if (auto view = vpackfile_get_file_view(filename)) {
+            return view;
+        }
+        rf::File file;
+        if (file.open(filename) != 0) {
+            return {};
+        }
+        buf.resize(file.size());
+        int bytes_read = file.read(buf.data(), static_cast<int>(buf.size()));
+        if (bytes_read != static_cast<int>(buf.size())) {
+            return {};
+        }
+        return {buf};
+    }
+
     ShaderManager::ShaderManager(ComPtr<ID3D11Device> device) : device_{device}
     {
     }
@@ -20,20 +41,19 @@ namespace df::gr::d3d11
     VertexShaderAndLayout
     ShaderManager::load_vertex_shader(const char* filename, const D3D11_INPUT_ELEMENT_DESC input_elements[], std::size_t num_input_elements)
     {
-        rf::File file;
-        if (file.open(filename) != 0) {
+        std::vector<std::byte> buf;
+        auto shader_data_opt = load_shader_file(filename, buf);
+        if (!shader_data_opt) {
             xlog::error("Cannot open vertex shader file {}", filename);
             return {{}, {}};
         }
-        int size = file.size();
-        auto shader_data = std::make_unique<std::byte[]>(size);
-        [[maybe_unused]] int bytes_read = file.read(shader_data.get(), size);
-        assert(bytes_read == size);
+        const std::byte* shader_data = shader_data_opt.value().data();
+        std::size_t size = shader_data_opt.value().size();
 
         xlog::debug("Loading vertex shader {} size {}", filename, size);
         ComPtr<ID3D11VertexShader> vertex_shader;
         DF_GR_D3D11_CHECK_HR(
-            device_->CreateVertexShader(shader_data.get(), size, nullptr, &vertex_shader)
+            device_->CreateVertexShader(shader_data, size, nullptr, &vertex_shader)
         );
 
         ComPtr<ID3D11InputLayout> input_layout;
@@ -41,7 +61,7 @@ namespace df::gr::d3d11
             device_->CreateInputLayout(
                 input_elements,
                 num_input_elements,
-                shader_data.get(),
+                shader_data,
                 size,
                 &input_layout
             )
@@ -52,20 +72,19 @@ namespace df::gr::d3d11
 
     ComPtr<ID3D11PixelShader> ShaderManager::load_pixel_shader(const char* filename)
     {
-        rf::File file;
-        if (file.open(filename) != 0) {
+        std::vector<std::byte> buf;
+        auto shader_data_opt = load_shader_file(filename, buf);
+        if (!shader_data_opt) {
             xlog::error("Cannot open pixel shader file");
             return {};
         }
-        int size = file.size();
-        auto shader_data = std::make_unique<std::byte[]>(size);
-        [[maybe_unused]] int bytes_read = file.read(shader_data.get(), size);
-        assert(bytes_read == size);
+        const std::byte* shader_data = shader_data_opt.value().data();
+        std::size_t size = shader_data_opt.value().size();
 
         xlog::debug("Loading pixel shader {} size {}", filename, size);
         ComPtr<ID3D11PixelShader> pixel_shader;
         DF_GR_D3D11_CHECK_HR(
-            device_->CreatePixelShader(shader_data.get(), size, nullptr, &pixel_shader)
+            device_->CreatePixelShader(shader_data, size, nullptr, &pixel_shader)
         );
         return pixel_shader;
     }
@@ -25,9 +25,11 @@
 #include "../hud/multi_spectate.h"
 #include "../object/object.h"
 #include "../multi/multi.h"
+#include "../multi/obj_interest.h"
 #include "../multi/server.h"
 #include "../misc/misc.h"
 #include "../misc/vpackfile.h"
+#include "../misc/level_prefetch.h"
 #include "../misc/high_fps.h"
 #include "../input/input.h"
 #include "../rf/gr/gr.h"
@@ -104,9 +106,11 @@ FunHook<int()> rf_do_frame_hook{
         high_fps_update();
         server_do_frame();
         int result = rf_do_frame_hook.call_target();
+        server_do_frame_post();
         maybe_autosave();
         debug_do_frame_post();
         multi_level_download_update();
+        vpackfile_do_frame();
         return result;
     },
 };
@@ -142,11 +146,14 @@ FunHook<int(rf::String&, rf::String&, char*)> level_load_hook{
         xlog::info("Loading level: {}", level_filename);
         if (!save_filename.empty())
             xlog::info("Restoring game from save file: {}", save_filename);
+        level_prefetch_level_load_begin(level_filename);
         int ret = level_load_hook.call_target(level_filename, save_filename, error);
+        level_prefetch_level_load_end();
         if (ret != 0)
             xlog::warn("Loading failed: {}", error);
         else {
             multi_spectate_level_init();
+            obj_interest_level_init();
         }
         return ret;
     },
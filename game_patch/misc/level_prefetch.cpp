@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <xlog/xlog.h>
+#include <vpp/format.h>
+#include <common/config/GameConfig.h>
+#include "level_prefetch.h"
+#include "vpackfile.h"
+#include "../os/console.h"
+#include "../rf/file/packfile.h"
+
+struct PrefetchedEntryState
+{
+    bool read = false;
+    // time spent by the background thread on reading the entry
+    unsigned read_time_us = 0;
+};
+
+static std::future<void> g_prefetch_future;
+static std::atomic<bool> g_prefetch_abort{false};
+static std::atomic<std::size_t> g_prefetch_num_bytes{0};
+static std::atomic<unsigned> g_prefetch_time_ms{0};
+static std::string g_prefetch_level_filename;
+// Shared with the background thread
+static std::mutex g_prefetch_mutex;
+static std::unordered_map<const rf::VPackfileEntry*, PrefetchedEntryState> g_prefetched_entries;
+
+static bool g_level_loading = false;
+static std::chrono::steady_clock::time_point g_level_load_start;
+static unsigned g_num_lookups = 0;
+static unsigned g_num_hits = 0;
+static unsigned g_num_pending_hits = 0;
+static unsigned g_hits_read_time_us = 0;
+
+static bool looks_like_file_name(std::string_view str)
+{
+    auto dot_pos = str.rfind('.');
+    if (dot_pos == std::string_view::npos || dot_pos == 0 || str.size() - dot_pos - 1 < 2 ||
+        str.size() - dot_pos - 1 > 4) {
+        return false;
+    }
+    return std::all_of(str.begin(), str.end(), [](unsigned char ch) {
+        return ch >= ' ' && ch < 0x7F && ch != '\\' && ch != '/';
+    });
+}
+
+// RFL stores strings as 16-bit length followed by characters. Instead of parsing all level sections (their layout
+// depends on the level version) look for anything that looks like a file name. Names that do not exist in
+// packfiles are filtered out later.
+static std::vector<std::string_view> find_asset_names(const std::vector<char>& level_data)
+{
+    std::vector<std::string_view> names;
+    for (std::size_t i = 0; i + 2 < level_data.size(); ++i) {
+        std::size_t len = static_cast<unsigned char>(level_data[i]) |
+            (static_cast<unsigned char>(level_data[i + 1]) << 8);
+        if (len < 4 || len >= vpp::max_name_len || len > level_data.size() - i - 2) {
+            continue;
+        }
+        std::string_view str{&level_data[i + 2], len};
+        if (looks_like_file_name(str)) {
+            names.push_back(str);
+            i += 1 + len;
+        }
+    }
+    return names;
+}
+
+static std::FILE* open_entry(const rf::VPackfileEntry* entry)
+{
+    std::FILE* file = std::fopen(entry->parent->path, "rb");
+    if (file && std::fseek(file, static_cast<long>(vpp::block_offset(entry->block)), SEEK_SET) != 0) {
+        std::fclose(file);
+        return nullptr;
+    }
+    return file;
+}
+
+// Note: called from a worker thread
+static void prefetch_worker(std::string level_filename)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Packfiles are not modified while the worker is running so the lookup table can be accessed without locking
+    const rf::VPackfileEntry* level_entry = vpackfile_lookup(level_filename.c_str());
+    if (!level_entry) {
+        xlog::trace("Level {} is not stored in a packfile - skipping prefetch", level_filename);
+        return;
+    }
+    std::vector<char> level_data(level_entry->size);
+    std::FILE* level_file = open_entry(level_entry);
+    if (!level_file) {
+        return;
+    }
+    bool level_read = std::fread(level_data.data(), 1, level_data.size(), level_file) == level_data.size();
+    std::fclose(level_file);
+    if (!level_read) {
+        xlog::warn("Failed to read level {} for prefetch", level_filename);
+        return;
+    }
+
+    std::vector<const rf::VPackfileEntry*> entries;
+    for (auto name : find_asset_names(level_data)) {
+        std::string name_str{name};
+        const rf::VPackfileEntry* entry = vpackfile_lookup(name_str.c_str());
+        if (entry) {
+            entries.push_back(entry);
+        }
+    }
+    // Read files in the order of their location in packfiles to avoid seeking back and forth
+    std::sort(entries.begin(), entries.end(), [](auto* a, auto* b) {
+        int path_cmp = std::strcmp(a->parent->path, b->parent->path);
+        return path_cmp < 0 || (path_cmp == 0 && a->block < b->block);
+    });
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    {
+        std::lock_guard lock{g_prefetch_mutex};
+        for (auto* entry : entries) {
+            g_prefetched_entries.emplace(entry, PrefetchedEntryState{});
+        }
+    }
+    xlog::trace("Prefetching {} files referenced by level {}", entries.size(), level_filename);
+
+    // Read data is not used - it only has to end up in the OS file cache because the game opens files by itself
+    std::vector<char> buf(256 * 1024);
+    std::FILE* file = nullptr;
+    const rf::VPackfile* file_packfile = nullptr;
+    for (auto* entry : entries) {
+        if (g_prefetch_abort) {
+            break;
+        }
+        auto entry_start = std::chrono::steady_clock::now();
+        if (entry->parent != file_packfile) {
+            if (file) {
+                std::fclose(file);
+            }
+            file = std::fopen(entry->parent->path, "rb");
+            file_packfile = entry->parent;
+        }
+        if (!file || std::fseek(file, static_cast<long>(vpp::block_offset(entry->block)), SEEK_SET) != 0) {
+            continue;
+        }
+        std::size_t bytes_left = entry->size;
+        while (bytes_left > 0 && !g_prefetch_abort) {
+            std::size_t len = std::fread(buf.data(), 1, std::min(bytes_left, buf.size()), file);
+            if (len == 0) {
+                break;
+            }
+            bytes_left -= len;
+        }
+        g_prefetch_num_bytes += entry->size - bytes_left;
+        auto entry_time = std::chrono::steady_clock::now() - entry_start;
+        std::lock_guard lock{g_prefetch_mutex};
+        auto& state = g_prefetched_entries[entry];
+        state.read = bytes_left == 0;
+        state.read_time_us = static_cast<unsigned>(
+            std::chrono::duration_cast<std::chrono::microseconds>(entry_time).count());
+    }
+    if (file) {
+        std::fclose(file);
+    }
+    g_prefetch_time_ms = static_cast<unsigned>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+void level_prefetch_abort()
+{
+    if (g_prefetch_future.valid()) {
+        g_prefetch_abort = true;
+        g_prefetch_future.get();
+    }
+    g_prefetch_level_filename.clear();
+    // Entries will be invalid if packfiles are released
+    std::lock_guard lock{g_prefetch_mutex};
+    g_prefetched_entries.clear();
+}
+
+void level_prefetch_start(const char* level_filename)
+{
+    level_prefetch_abort();
+    if (!g_game_config.level_prefetch) {
+        return;
+    }
+    g_prefetch_abort = false;
+    g_prefetch_num_bytes = 0;
+    g_prefetch_time_ms = 0;
+    g_prefetch_level_filename = level_filename;
+    g_prefetch_future = std::async(std::launch::async, prefetch_worker, g_prefetch_level_filename);
+}
+
+void level_prefetch_level_load_begin(const char* level_filename)
+{
+    // Prefetch could have been started earlier, e.g. when leaving limbo in multiplayer
+    if (stricmp(g_prefetch_level_filename.c_str(), level_filename) != 0) {
+        level_prefetch_start(level_filename);
+    }
+    g_level_loading = true;
+    g_level_load_start = std::chrono::steady_clock::now();
+    g_num_lookups = 0;
+    g_num_hits = 0;
+    g_num_pending_hits = 0;
+    g_hits_read_time_us = 0;
+}
+
+void level_prefetch_on_file_lookup(const rf::VPackfileEntry* entry)
+{
+    if (!g_level_loading) {
+        return;
+    }
+    ++g_num_lookups;
+    std::lock_guard lock{g_prefetch_mutex};
+    auto it = g_prefetched_entries.find(entry);
+    if (it != g_prefetched_entries.end()) {
+        if (it->second.read) {
+            ++g_num_hits;
+            g_hits_read_time_us += it->second.read_time_us;
+        }
+        else {
+            ++g_num_pending_hits;
+        }
+    }
+}
+
+void level_prefetch_level_load_end()
+{
+    if (!g_level_loading) {
+        return;
+    }
+    g_level_loading = false;
+    auto load_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - g_level_load_start).count();
+    if (g_prefetch_level_filename.empty()) {
+        xlog::info("Level loaded in {} ms (prefetch disabled)", load_time_ms);
+        return;
+    }
+    unsigned hit_rate = g_num_lookups ? g_num_hits * 100 / g_num_lookups : 0;
+    xlog::info("Level loaded in {} ms. Prefetch hits: {}/{} packfile lookups ({}%), {} not read yet, "
+        "read time moved off the main thread: {} ms", load_time_ms, g_num_hits, g_num_lookups, hit_rate,
+        g_num_pending_hits, g_hits_read_time_us / 1000);
+    using namespace std::chrono_literals;
+    if (g_prefetch_future.valid() && g_prefetch_future.wait_for(0ms) != std::future_status::ready) {
+        xlog::info("Prefetch is still running, {} KB read so far", g_prefetch_num_bytes / 1024);
+    }
+    else {
+        xlog::info("Prefetched {} KB in {} ms", g_prefetch_num_bytes / 1024, g_prefetch_time_ms.load());
+    }
+}
+
+ConsoleCommand2 level_prefetch_cmd{
+    "level_prefetch",
+    []() {
+        g_game_config.level_prefetch = !g_game_config.level_prefetch;
+        g_game_config.save();
+        rf::console::print("Level asset prefetch is {}", g_game_config.level_prefetch ? "enabled" : "disabled");
+    },
+    "Toggles reading level assets in a background thread during level loading",
+};
+
+void level_prefetch_init()
+{
+    level_prefetch_cmd.register_cmd();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace rf
+{
+    struct VPackfileEntry;
+}
+
+// Starts reading assets referenced by the level in a background thread so they are in the OS file cache when
+// the level loader opens them. Disabled by default: reads compete with the level loader for the disk (seeking on
+// HDDs) and the gain has not been measured yet - level load time is logged either way for comparison.
+void level_prefetch_start(const char* level_filename);
+// Stops the background thread. Must be called before packfiles are added or released.
+void level_prefetch_abort();
+void level_prefetch_level_load_begin(const char* level_filename);
+void level_prefetch_level_load_end();
+void level_prefetch_on_file_lookup(const rf::VPackfileEntry* entry);
+void level_prefetch_init();
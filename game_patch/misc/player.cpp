@@ -11,6 +11,10 @@
 #include "../os/console.h"
 #include "../main/main.h"
 #include "../multi/multi.h"
+#include "../multi/obj_update_delta.h"
+#include "../multi/obj_interest.h"
+#include "../multi/send_scheduler.h"
+#include "../multi/net_stats.h"
 #include "../hud/multi_spectate.h"
 #include <common/utils/list-utils.h>
 #include <common/config/GameConfig.h>
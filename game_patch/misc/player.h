@@ -1,5 +1,6 @@
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <common/utils/string-utils.h>
 #include "../rf/math/vector.h"
@@ -12,6 +13,11 @@ namespace rf
     struct Player;
 }
 
+class ObjUpdateDeltaEncoder;
+class ObjInterestState;
+struct SendQueue;
+struct NetClientStats;
+
 struct PlayerNetGameSaveData
 {
     rf::Vector3 pos;
@@ -26,6 +32,14 @@ struct PlayerAdditionalData
     std::map<std::string, PlayerNetGameSaveData> saves;
     rf::Vector3 last_teleport_pos;
     rf::TimestampRealtime last_teleport_timestamp;
+    // delta compression state, created when the client acknowledges the first object update
+    std::unique_ptr<ObjUpdateDeltaEncoder> obj_update_delta;
+    // area of interest filtering state
+    std::unique_ptr<ObjInterestState> interest;
+    // unreliable messages waiting for the end of the frame
+    std::unique_ptr<SendQueue> send_queue;
+    // network statistics
+    std::unique_ptr<NetClientStats> net_stats;
 };
 
 void find_player(const StringMatcher& query, std::function<void(rf::Player*)> consumer);
@@ -1,5 +1,4 @@
 #include <windows.h>
-#include <common/utils/iterable-utils.h>
 #include <common/utils/os-utils.h>
 #include <xxhash.h>
 #include <common/config/BuildConfig.h>
@@ -7,14 +6,26 @@
 #include <patch_common/AsmWriter.h>
 #include <patch_common/CodeInjection.h>
 #include <xlog/xlog.h>
-#include <fstream>
 #include <format>
+#include <algorithm>
 #include <array>
-#include <cctype>
+#include <map>
+#include <chrono>
 #include <cstring>
-#include <unordered_map>
+#include <optional>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <stdexcept>
 #include <shlwapi.h>
+#include <vpp/ArchiveView.h>
+#include <vpp/MappedFile.h>
 #include "vpackfile.h"
+#include "vpackfile_directory_parser.h"
+#include "vpackfile_index_cache.h"
+#include "vpackfile_lookup_table.h"
+#include "vpackfile_name_index.h"
+#include "level_prefetch.h"
 #include "../main/main.h"
 #include "../rf/file/file.h"
 #include "../rf/file/packfile.h"
@@ -22,26 +33,34 @@
 #include "../rf/multi.h"
 #include "../os/console.h"
 
-#define CHECK_PACKFILE_CHECKSUM 0 // slow (1 second on SSD on first load after boot)
-
-#if CHECK_PACKFILE_CHECKSUM
-
 const std::map<std::string, unsigned> GameFileChecksums = {
     // Note: Multiplayer level checksum is checked when loading level
     //{ "levelsm.vpp", 0x17D0D38A },
-    // Note: maps are big and slow downs startup
+    // Note: maps are big so checksums are calculated in background threads (1 second on SSD on first load after boot)
     {"maps1.vpp", 0x52EE4F99},  {"maps2.vpp", 0xB053486F},   {"maps3.vpp", 0xA5ED6271},  {"maps4.vpp", 0xE0AB4397},
     {"meshes.vpp", 0xEBA19172}, {"motions.vpp", 0x17132D8E}, {"tables.vpp", 0x549DAABF},
 };
 
-#endif // CHECK_PACKFILE_CHECKSUM
+struct PackfileChecksumJob
+{
+    std::string filename;
+    std::string full_path;
+    unsigned expected_checksum;
+    std::optional<unsigned> checksum;
+};
 
 static unsigned g_num_files_in_packfiles = 0;
 static unsigned g_num_name_collisions = 0;
+static std::size_t g_num_name_bytes = 0;
 static std::vector<std::unique_ptr<rf::VPackfile>> g_packfiles;
-static std::unordered_map<std::string, rf::VPackfileEntry*> g_loopup_table;
+static VPackfileLookupTable g_loopup_table;
+static VPackfileNameIndex g_name_index;
 static bool g_is_modded_game = false;
 static bool g_is_overriding_disabled = false;
+static VPackfileIndexCache g_index_cache;
+static std::vector<PackfileChecksumJob> g_checksum_jobs;
+static std::vector<std::future<void>> g_checksum_futures;
+static std::atomic<bool> g_checksum_abort{false};
 
 #ifdef MOD_FILE_WHITELIST
 
@@ -61,30 +80,37 @@ static bool is_mod_file_in_whitelist(const char* Filename)
 
 #endif // MOD_FILE_WHITELIST
 
-#if CHECK_PACKFILE_CHECKSUM
-
-static unsigned hash_file(const char* Filename)
+// Note: called from worker threads
+static std::optional<unsigned> hash_file(const char* filename)
 {
-    FILE* File = fopen(Filename, "rb");
-    if (!File)
-        return 0;
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+        return {};
 
     XXH32_state_t* state = XXH32_createState();
     XXH32_reset(state, 0);
 
-    char Buffer[4096];
+    // Use big reads so hashing is not slowed down by the number of read calls
+    std::vector<char> buffer(1024 * 1024);
+    bool aborted = false;
     while (true) {
-        size_t len = fread(Buffer, 1, sizeof(Buffer), File);
+        if (g_checksum_abort) {
+            aborted = true;
+            break;
+        }
+        size_t len = fread(buffer.data(), 1, buffer.size(), file);
         if (!len)
             break;
-        XXH32_update(state, Buffer, len);
+        XXH32_update(state, buffer.data(), len);
     }
-    fclose(File);
+    bool failed = ferror(file);
+    fclose(file);
     XXH32_hash_t hash = XXH32_digest(state);
     XXH32_freeState(state);
-    return hash;
+    if (aborted || failed)
+        return {};
+    return {hash};
 }
-#endif // CHECK_PACKFILE_CHECKSUM
 
 static GameLang detect_installed_game_lang()
 {
@@ -124,59 +150,26 @@ bool is_modded_game()
     return g_is_modded_game;
 }
 
-static uint32_t vpackfile_process_header(rf::VPackfile* packfile, const void* raw_header)
+static std::string vpackfile_get_full_path(const char* filename, const char* dir)
 {
-    struct VppHeader
-    {
-        uint32_t sig;
-        uint32_t unk;
-        uint32_t num_files;
-        uint32_t total_size;
-    };
-    constexpr unsigned VPP_SIG = 0x51890ACE;
-    const auto& hdr = *static_cast<const VppHeader*>(raw_header);
-    packfile->num_files = hdr.num_files;
-    packfile->file_size = hdr.total_size;
-    if (hdr.sig != VPP_SIG || hdr.unk < 1u)
-        return 0;
-    return hdr.num_files;
+    if (dir && !PathIsRelativeA(dir))
+        return std::format("{}{}", dir, filename); // absolute path
+    return std::format("{}{}{}", rf::root_path, dir ? dir : "", filename);
 }
 
-static int vpackfile_add_new(const char* filename, const char* dir)
+static bool vpackfile_is_loaded(const std::string& full_path)
 {
-    xlog::trace("Load packfile {} {}", dir, filename);
-
-    std::string full_path;
-    if (dir && !PathIsRelativeA(dir))
-        full_path = std::format("{}{}", dir, filename); // absolute path
-    else
-        full_path = std::format("{}{}{}", rf::root_path, dir ? dir : "", filename);
-
-    if (!filename || strlen(filename) > 0x1F || full_path.size() > 0x7F) {
-        xlog::error("Packfile name or path too long: {}", full_path);
-        return 0;
-    }
-
     for (auto& packfile : g_packfiles)
         if (!stricmp(packfile->path, full_path.c_str()))
-            return 1;
-
-#if CHECK_PACKFILE_CHECKSUM
-    if (!Dir) {
-        auto it = GameFileChecksums.find(Filename);
-        if (it != GameFileChecksums.end()) {
-            unsigned Checksum = hash_file(FullPath);
-            if (Checksum != it->second) {
-                xlog::info("VPackfile {} has invalid checksum 0x{:x}", Filename, Checksum);
-                g_is_modded_game = true;
-            }
-        }
-    }
-#endif // CHECK_PACKFILE_CHECKSUM
+            return true;
+    return false;
+}
 
-    std::ifstream file(full_path, std::ios_base::in | std::ios_base::binary);
-    if (!file) {
-        xlog::error("Failed to open packfile {}", full_path);
+static int vpackfile_register(const char* filename, const std::string& full_path,
+    const VPackfileIndexCache::Index& index)
+{
+    // Note: empty packfile is not always a true error but it is not added anyway
+    if (index.file_infos.empty()) {
         return 0;
     }
 
@@ -186,41 +179,24 @@ static int vpackfile_add_new(const char* filename, const char* dir)
     std::strncpy(packfile->path, full_path.c_str(), sizeof(packfile->path) - 1);
     packfile->path[sizeof(packfile->path) - 1] = '\0';
     packfile->field_a0 = 0;
-    packfile->num_files = 0;
+    packfile->num_files = index.file_infos.size();
+    packfile->file_size = index.total_size;
     // this is set to true for user_maps
     packfile->is_user_maps = rf::vpackfile_loading_user_maps;
 
-    // Process file header
-    char buf[0x800];
-    if (!file.read(buf, sizeof(buf))) {
-        xlog::error("Failed to read VPP header: {}", filename);
-        return 0;
-    }
-    // Note: VPackfileProcessHeader returns number of files in packfile - result 0 is not always a true error
-    if (!vpackfile_process_header(packfile.get(), buf)) {
-        return 0;
-    }
-
     // Load all entries
-    unsigned current_block = 1;
     packfile->files.resize(packfile->num_files);
     unsigned num_added = 0;
-    for (unsigned i = 0; i < packfile->num_files; i += 32) {
-        if (!file.read(buf, sizeof(buf))) {
-            xlog::error("Failed to read vpp {}", full_path);
-            return 0;
-        }
-
-        unsigned num_files_in_block = std::min(packfile->num_files - i, 32u);
-        rf::vpackfile_add_entries(packfile.get(), buf, num_files_in_block, &num_added);
-        ++current_block;
-    }
+    rf::vpackfile_add_entries(packfile.get(), index.file_infos.data(), packfile->num_files, &num_added);
     packfile->files.resize(num_added);
 
-    // Set block in all entries
-    for (auto& entry : packfile->files) {
+    // Set block in all entries and build extension index
+    unsigned current_block = vpp::first_data_block(packfile->num_files);
+    for (std::size_t i = 0; i < packfile->files.size(); ++i) {
+        auto& entry = packfile->files[i];
         entry.block = current_block;
-        current_block += (entry.size + 2047) / 2048;
+        current_block += vpp::num_blocks(entry.size);
+        packfile->entries_by_ext[string_to_lower(get_ext_from_filename(entry.name))].push_back(static_cast<uint32_t>(i));
     }
 
     g_packfiles.push_back(std::move(packfile));
@@ -228,6 +204,101 @@ static int vpackfile_add_new(const char* filename, const char* dir)
     return 1;
 }
 
+struct VPackfileLoadItem
+{
+    const char* filename;
+    const char* dir;
+    std::string full_path;
+    const VPackfileIndexCache::Index* index = nullptr;
+    std::optional<VPackfileIndexCache::Index> parsed_index;
+    std::string error;
+    bool skip = false;
+};
+
+// Loads packfiles in the provided order. Directories of packfiles missing in the index cache are parsed in parallel,
+// but entries are added to the lookup table on the calling thread one packfile after another so the result is
+// the same as when packfiles are loaded one by one.
+static unsigned vpackfile_add_batch(std::vector<VPackfileLoadItem>& items)
+{
+    // Prefetch thread uses the lookup table
+    level_prefetch_abort();
+    std::vector<VPackfileLoadItem*> items_to_parse;
+    for (auto& item : items) {
+        xlog::trace("Load packfile {} {}", item.dir, item.filename);
+        item.full_path = vpackfile_get_full_path(item.filename, item.dir);
+        if (strlen(item.filename) > 0x1F || item.full_path.size() > 0x7F) {
+            xlog::error("Packfile name or path too long: {}", item.full_path);
+            item.skip = true;
+        }
+        else if (!vpackfile_is_loaded(item.full_path)) {
+            item.index = g_index_cache.find(item.full_path);
+            if (!item.index) {
+                items_to_parse.push_back(&item);
+            }
+        }
+    }
+
+    std::vector<std::string> paths_to_parse;
+    for (auto* item : items_to_parse) {
+        paths_to_parse.push_back(item->full_path);
+    }
+    // Use a few threads only - the work is mostly I/O bound
+    std::size_t max_workers = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, 4);
+    auto parse_results = vpackfile_parse_directories(paths_to_parse, max_workers);
+    for (std::size_t i = 0; i < items_to_parse.size(); ++i) {
+        items_to_parse[i]->parsed_index = std::move(parse_results[i].index);
+        items_to_parse[i]->error = std::move(parse_results[i].error);
+    }
+
+    unsigned num_loaded = 0;
+    for (auto& item : items) {
+        if (item.skip) {
+            continue;
+        }
+        if (vpackfile_is_loaded(item.full_path)) {
+            ++num_loaded;
+            continue;
+        }
+        if (!item.index && item.parsed_index) {
+            item.index = &g_index_cache.add(item.full_path, std::move(item.parsed_index.value()));
+        }
+        if (!item.index) {
+            xlog::error("Failed to load packfile {}: {}", item.full_path, item.error);
+        }
+        else if (vpackfile_register(item.filename, item.full_path, *item.index)) {
+            ++num_loaded;
+        }
+    }
+    return num_loaded;
+}
+
+static int vpackfile_add_new(const char* filename, const char* dir)
+{
+    if (!filename) {
+        return 0;
+    }
+
+    std::vector<VPackfileLoadItem> items(1);
+    items[0].filename = filename;
+    items[0].dir = dir;
+    return vpackfile_add_batch(items);
+}
+
+unsigned vpackfile_add_multiple(const std::vector<std::string>& filenames, const char* dir)
+{
+    std::vector<VPackfileLoadItem> items(filenames.size());
+    for (std::size_t i = 0; i < filenames.size(); ++i) {
+        items[i].filename = filenames[i].c_str();
+        items[i].dir = dir;
+    }
+    return vpackfile_add_batch(items);
+}
+
+void vpackfile_add_to_index_cache(const char* filename, const char* dir, VPackfileIndexCache::Index index)
+{
+    g_index_cache.add(vpackfile_get_full_path(filename, dir), std::move(index));
+}
+
 static rf::VPackfile* vpackfile_find_packfile(const char* filename)
 {
     for (auto& packfile : g_packfiles) {
@@ -245,18 +316,26 @@ static void for_each_packfile_entry(const std::vector<std::string_view>& ext_fil
     std::vector<std::string> ext_filter_lower;
     ext_filter_lower.reserve(ext_filter.size());
     std::transform(ext_filter.begin(), ext_filter.end(), std::back_inserter(ext_filter_lower), string_to_lower);
+    std::sort(ext_filter_lower.begin(), ext_filter_lower.end());
+    ext_filter_lower.erase(std::unique(ext_filter_lower.begin(), ext_filter_lower.end()), ext_filter_lower.end());
+
+    std::vector<uint32_t> entry_indices;
     for (auto& packfile : g_packfiles) {
         if (!packfile_filter || !stricmp(packfile_filter, packfile->filename)) {
-            for (auto& entry : packfile->files) {
-                const char* ext_ptr = rf::file_get_ext(entry.name);
-                if (ext_ptr[0]) {
-                    ++ext_ptr;
-                }
-                std::string ext_lower = string_to_lower(ext_ptr);
-                if (iterable_contains(ext_filter_lower, ext_lower)) {
-                    fun(entry);
+            entry_indices.clear();
+            for (auto& ext : ext_filter_lower) {
+                auto it = packfile->entries_by_ext.find(ext);
+                if (it != packfile->entries_by_ext.end()) {
+                    entry_indices.insert(entry_indices.end(), it->second.begin(), it->second.end());
                 }
             }
+            // Keep the order of entries in the packfile
+            if (ext_filter_lower.size() > 1) {
+                std::sort(entry_indices.begin(), entry_indices.end());
+            }
+            for (auto idx : entry_indices) {
+                fun(packfile->files[idx]);
+            }
         }
     }
 }
@@ -266,9 +345,12 @@ static int vpackfile_build_file_list_new(const char* ext_filter, char*& filename
 {
     xlog::trace("PackfileBuildFileList begin");
     auto ext_filter_splitted = string_split(ext_filter, ',');
-    // Calculate number of bytes needed by result (zero terminated file names + buffer terminating zero)
+    // Collect matching entries and calculate number of bytes needed by result (zero terminated file names + buffer
+    // terminating zero)
+    std::vector<const char*> matching_names;
     unsigned num_bytes = 1;
     for_each_packfile_entry(ext_filter_splitted, packfile_filter, [&](auto& entry) {
+        matching_names.push_back(entry.name);
         num_bytes += std::strlen(entry.name) + 1;
     });
     // Allocate result buffer
@@ -278,11 +360,12 @@ static int vpackfile_build_file_list_new(const char* ext_filter, char*& filename
     // Fill result buffer and count matching files
     num_files = 0;
     char* buf_ptr = filenames;
-    for_each_packfile_entry(ext_filter_splitted, packfile_filter, [&](auto& entry) {
-        strcpy(buf_ptr, entry.name);
-        buf_ptr += std::strlen(entry.name) + 1;
+    for (const char* name : matching_names) {
+        std::size_t name_size = std::strlen(name) + 1;
+        std::memcpy(buf_ptr, name, name_size);
+        buf_ptr += name_size;
         ++num_files;
-    });
+    }
     // Add terminating zero to the buffer
     buf_ptr[0] = 0;
     xlog::trace("PackfileBuildFileList end");
@@ -318,40 +401,41 @@ static bool is_lookup_table_entry_override_allowed(rf::VPackfileEntry* old_entry
 
 static void vpackfile_add_to_lookup_table(rf::VPackfileEntry* entry)
 {
-    std::string filename_str = string_to_lower(entry->name);
-    auto [it, inserted] = g_loopup_table.insert({filename_str, entry});
+    bool inserted = g_loopup_table.insert_or_override(entry, [](auto* stored_entry, auto* new_entry) {
+        bool allowed = is_lookup_table_entry_override_allowed(stored_entry, new_entry);
+        xlog::trace("{} overriding packfile file {} (old packfile {}, new packfile {})",
+            allowed ? "Allowed" : "Denied", new_entry->name, stored_entry->parent->filename,
+            new_entry->parent->filename);
+        return allowed;
+    });
+    g_name_index.invalidate();
     if (!inserted) {
         ++g_num_name_collisions;
-        if (is_lookup_table_entry_override_allowed(it->second, entry)) {
-            xlog::trace("Allowed overriding packfile file {} (old packfile {}, new packfile {})", entry->name,
-                it->second->parent->filename, entry->parent->filename);
-            it->second = entry;
-        }
-        else {
-            xlog::trace("Denied overriding packfile file {} (old packfile {}, new packfile {})", entry->name,
-                it->second->parent->filename, entry->parent->filename);
-        }
     }
 }
 
 static int vpackfile_add_entries_new(rf::VPackfile* packfile, const void* block, unsigned num_files,
                                      unsigned& num_added_files)
 {
-    struct VppFileInfo
-    {
-        char name[60];
-        uint32_t size;
-    };
-    const auto* record = static_cast<const VppFileInfo*>(block);
+    const auto* record = static_cast<const vpp::FileInfo*>(block);
 
+    // Note: we can't use string pool from RF because it's too small
+    // Names of all entries are stored in a single buffer owned by the packfile
+    std::size_t names_size = 0;
     for (unsigned i = 0; i < num_files; ++i) {
-        const char* file_name = record->name;
+        names_size += vpp::ArchiveView::entry_name(record[i]).size() + 1;
+    }
+    char* names_ptr = packfile->name_buffers.emplace_back(std::make_unique<char[]>(names_size)).get();
+    g_num_name_bytes += names_size;
+
+    for (unsigned i = 0; i < num_files; ++i) {
+        auto file_name = vpp::ArchiveView::entry_name(*record);
         rf::VPackfileEntry& entry = packfile->files[num_added_files];
 
-        // Note: we can't use string pool from RF because it's too small
-        char* file_name_buf = new char[strlen(file_name) + 1];
-        std::strcpy(file_name_buf, file_name);
-        entry.name = file_name_buf;
+        file_name.copy(names_ptr, file_name.size());
+        names_ptr[file_name.size()] = '\0';
+        entry.name = names_ptr;
+        names_ptr += file_name.size() + 1;
         entry.name_checksum = rf::vpackfile_calc_file_name_checksum(entry.name);
         entry.size = record->size;
         entry.parent = packfile;
@@ -368,16 +452,40 @@ static int vpackfile_add_entries_new(rf::VPackfile* packfile, const void* block,
 
 static rf::VPackfileEntry* vpackfile_find_new(const char* filename)
 {
-    std::string filename_str{filename};
-    std::transform(filename_str.begin(), filename_str.end(), filename_str.begin(), [](unsigned char ch) {
-        return std::tolower(ch);
-    });
-    auto it = g_loopup_table.find(filename_str);
-    if (it != g_loopup_table.end()) {
-        return it->second;
+    rf::VPackfileEntry* entry = g_loopup_table.find(filename);
+    if (!entry) {
+        xlog::trace("Cannot find file {}", filename);
     }
-    xlog::trace("Cannot find file {}", filename_str);
-    return nullptr;
+    else {
+        level_prefetch_on_file_lookup(entry);
+    }
+    return entry;
+}
+
+std::optional<std::span<const std::byte>> vpackfile_get_file_view(const char* filename)
+{
+    rf::VPackfileEntry* entry = vpackfile_find_new(filename);
+    if (!entry) {
+        return {};
+    }
+    rf::VPackfile* packfile = entry->parent;
+    if (!packfile->mapped_file) {
+        // Map packfile once and keep it mapped until it is released
+        try {
+            packfile->mapped_file = std::make_unique<vpp::MappedFile>(packfile->path);
+        }
+        catch (const std::exception& e) {
+            xlog::error("Failed to map packfile {}: {}", packfile->path, e.what());
+            return {};
+        }
+    }
+    std::span<const std::byte> bytes = packfile->mapped_file->bytes();
+    std::size_t offset = vpp::block_offset(entry->block);
+    if (offset > bytes.size() || entry->size > bytes.size() - offset) {
+        xlog::error("File {} is out of packfile {} bounds", entry->name, packfile->path);
+        return {};
+    }
+    return {bytes.subspan(offset, entry->size)};
 }
 
 CodeInjection vpackfile_open_check_seek_result_injection{
@@ -389,11 +497,9 @@ CodeInjection vpackfile_open_check_seek_result_injection{
     },
 };
 
-static void load_dashfaction_vpp()
+static std::string get_dashfaction_vpp_dir(const char* df_vpp_base_name)
 {
-    // Load DashFaction specific packfile
     std::string df_vpp_dir = get_module_dir(g_hmodule);
-    const char* df_vpp_base_name = "dashfaction.vpp";
     if (!PathFileExistsA((df_vpp_dir + df_vpp_base_name).c_str())) {
         // Remove trailing slash
         if (df_vpp_dir.back() == '\\') {
@@ -407,9 +513,7 @@ static void load_dashfaction_vpp()
         }
     }
     xlog::info("Loading {} from directory: {}", df_vpp_base_name, df_vpp_dir);
-    if (!rf::vpackfile_add(df_vpp_base_name, df_vpp_dir.c_str())) {
-        xlog::error("Failed to load {}", df_vpp_base_name);
-    }
+    return df_vpp_dir;
 }
 
 ConsoleCommand2 which_packfile_cmd{
@@ -438,56 +542,167 @@ void force_file_from_packfile(const char* name, const char* packfile_name)
     }
 }
 
+static void check_game_file_checksum(const std::string& filename, unsigned checksum, unsigned expected_checksum)
+{
+    if (checksum != expected_checksum) {
+        xlog::info("VPackfile {} has invalid checksum 0x{:x}", filename, checksum);
+        g_is_modded_game = true;
+    }
+}
+
+static void start_game_files_verification(const std::vector<VPackfileLoadItem>& items)
+{
+    for (auto& item : items) {
+        auto it = GameFileChecksums.find(item.filename);
+        if (item.dir || it == GameFileChecksums.end() || !vpackfile_is_loaded(item.full_path)) {
+            continue;
+        }
+        auto cached_checksum = g_index_cache.get_checksum(item.full_path);
+        if (cached_checksum) {
+            check_game_file_checksum(item.filename, cached_checksum.value(), it->second);
+        }
+        else {
+            g_checksum_jobs.push_back({item.filename, item.full_path, it->second, {}});
+        }
+    }
+    if (g_checksum_jobs.empty()) {
+        return;
+    }
+
+    xlog::info("Verifying {} packfiles in background", g_checksum_jobs.size());
+    auto next_job_idx = std::make_shared<std::atomic<std::size_t>>(0);
+    auto worker = [next_job_idx]() {
+        std::size_t idx;
+        while ((idx = (*next_job_idx)++) < g_checksum_jobs.size()) {
+            auto& job = g_checksum_jobs[idx];
+            job.checksum = hash_file(job.full_path.c_str());
+        }
+    };
+    // Two threads are enough to saturate most disks
+    std::size_t num_workers = std::min<std::size_t>(2, g_checksum_jobs.size());
+    for (std::size_t i = 0; i < num_workers; ++i) {
+        g_checksum_futures.push_back(std::async(std::launch::async, worker));
+    }
+}
+
+void vpackfile_do_frame()
+{
+    if (g_checksum_futures.empty()) {
+        return;
+    }
+    using namespace std::chrono_literals;
+    for (auto& future : g_checksum_futures) {
+        if (future.wait_for(0ms) != std::future_status::ready) {
+            return;
+        }
+    }
+    g_checksum_futures.clear();
+
+    bool was_modded = g_is_modded_game;
+    for (auto& job : g_checksum_jobs) {
+        if (!job.checksum) {
+            xlog::warn("Failed to calculate checksum of {}", job.full_path);
+            continue;
+        }
+        g_index_cache.set_checksum(job.full_path, job.checksum.value());
+        check_game_file_checksum(job.filename, job.checksum.value(), job.expected_checksum);
+    }
+    g_checksum_jobs.clear();
+    xlog::info("Packfiles verification finished");
+    if (g_is_modded_game && !was_modded) {
+        rf::console::print("Modded game detected!");
+    }
+}
+
+static void abort_game_files_verification()
+{
+    g_checksum_abort = true;
+    g_checksum_futures.clear();
+    g_checksum_jobs.clear();
+}
+
+static std::string get_index_cache_path()
+{
+    return std::format("{}dashfaction_vpp_index.bin", rf::root_path);
+}
+
+static void save_index_cache()
+{
+    if (g_index_cache.is_dirty()) {
+        xlog::info("Saving packfile index cache");
+        g_index_cache.save(get_index_cache_path().c_str());
+    }
+}
+
 static void vpackfile_init_new()
 {
     unsigned start_ticks = GetTickCount();
 
+    g_index_cache.load(get_index_cache_path().c_str());
+
     g_loopup_table.reserve(10000);
 
+    const char* df_vpp_base_name = "dashfaction.vpp";
+    std::string df_vpp_dir;
+    if (!rf::is_dedicated_server) {
+        df_vpp_dir = get_dashfaction_vpp_dir(df_vpp_base_name);
+    }
+
+    // Packfiles are loaded in a single batch so their directories can be parsed in parallel
+    std::vector<VPackfileLoadItem> items;
+    auto add = [&](const char* filename, const char* dir = nullptr) {
+        auto& item = items.emplace_back();
+        item.filename = filename;
+        item.dir = dir;
+    };
+
     if (get_installed_game_lang() == LANG_GR) {
         if (!rf::is_dedicated_server) {
-            rf::vpackfile_add("audiog.vpp", nullptr);
-            rf::vpackfile_add("maps_gr.vpp", nullptr);
-            rf::vpackfile_add("levels1g.vpp", nullptr);
-            rf::vpackfile_add("levels2g.vpp", nullptr);
-            rf::vpackfile_add("levels3g.vpp", nullptr);
+            add("audiog.vpp");
+            add("maps_gr.vpp");
+            add("levels1g.vpp");
+            add("levels2g.vpp");
+            add("levels3g.vpp");
         }
-        rf::vpackfile_add("ltables.vpp", nullptr);
+        add("ltables.vpp");
     }
     else if (get_installed_game_lang() == LANG_FR) {
         if (!rf::is_dedicated_server) {
-            rf::vpackfile_add("audiof.vpp", nullptr);
-            rf::vpackfile_add("maps_fr.vpp", nullptr);
-            rf::vpackfile_add("levels1f.vpp", nullptr);
-            rf::vpackfile_add("levels2f.vpp", nullptr);
-            rf::vpackfile_add("levels3f.vpp", nullptr);
+            add("audiof.vpp");
+            add("maps_fr.vpp");
+            add("levels1f.vpp");
+            add("levels2f.vpp");
+            add("levels3f.vpp");
         }
-        rf::vpackfile_add("ltables.vpp", nullptr);
+        add("ltables.vpp");
     }
     else if (!rf::is_dedicated_server) {
-        rf::vpackfile_add("audio.vpp", nullptr);
-        rf::vpackfile_add("maps_en.vpp", nullptr);
-        rf::vpackfile_add("levels1.vpp", nullptr);
-        rf::vpackfile_add("levels2.vpp", nullptr);
-        rf::vpackfile_add("levels3.vpp", nullptr);
-    }
-    rf::vpackfile_add("levelsm.vpp", nullptr);
-    // rf::vpackfile_add("levelseb.vpp", nullptr);
-    // rf::vpackfile_add("levelsbg.vpp", nullptr);
+        add("audio.vpp");
+        add("maps_en.vpp");
+        add("levels1.vpp");
+        add("levels2.vpp");
+        add("levels3.vpp");
+    }
+    add("levelsm.vpp");
+    // add("levelseb.vpp");
+    // add("levelsbg.vpp");
     if (!rf::is_dedicated_server) {
-        rf::vpackfile_add("maps1.vpp", nullptr);
-        rf::vpackfile_add("maps2.vpp", nullptr);
-        rf::vpackfile_add("maps3.vpp", nullptr);
-        rf::vpackfile_add("maps4.vpp", nullptr);
+        add("maps1.vpp");
+        add("maps2.vpp");
+        add("maps3.vpp");
+        add("maps4.vpp");
     }
-    rf::vpackfile_add("meshes.vpp", nullptr);
-    rf::vpackfile_add("motions.vpp", nullptr);
+    add("meshes.vpp");
+    add("motions.vpp");
     if (!rf::is_dedicated_server) {
-        rf::vpackfile_add("music.vpp", nullptr);
-        rf::vpackfile_add("ui.vpp", nullptr);
-        load_dashfaction_vpp();
-    }
-    rf::vpackfile_add("tables.vpp", nullptr);
+        add("music.vpp");
+        add("ui.vpp");
+        // Load DashFaction specific packfile
+        add(df_vpp_base_name, df_vpp_dir.c_str());
+    }
+    add("tables.vpp");
+    vpackfile_add_batch(items);
+    start_game_files_verification(items);
     addr_as_ref<int>(0x01BDB218) = 1;          // VPackfilesLoaded
     addr_as_ref<uint32_t>(0x01BDB210) = 10000; // NumFilesInVfs
     addr_as_ref<uint32_t>(0x01BDB214) = 100;   // NumPackfiles
@@ -514,19 +729,33 @@ static void vpackfile_init_new()
         force_file_from_packfile("strings.tbl", "ui.vpp");
     }
 
-    xlog::info("Packfiles initialization took {}ms", GetTickCount() - start_ticks);
+    xlog::info("Packfiles initialization took {}ms (index cache hits {}, misses {})", GetTickCount() - start_ticks,
+        g_index_cache.num_hits(), g_index_cache.num_misses());
+    save_index_cache();
     xlog::info("Packfile name collisions: {}", g_num_name_collisions);
+    xlog::info("Packfile entry names: {} files, {} KB in {} buffers", g_num_files_in_packfiles,
+        g_num_name_bytes / 1024, g_packfiles.size());
 
     if (g_is_modded_game)
         xlog::info("Modded game detected!");
 
     // Commands
     which_packfile_cmd.register_cmd();
+    level_prefetch_init();
 }
 
 static void vpackfile_cleanup_new()
 {
+    abort_game_files_verification();
+    level_prefetch_abort();
+    // Packfiles loaded after initialization (user_maps, downloaded levels) are cached on exit
+    save_index_cache();
+    // Lookup table points to entries and names owned by packfiles
+    g_loopup_table.clear();
+    g_name_index.clear();
     g_packfiles.clear();
+    g_num_files_in_packfiles = 0;
+    g_num_name_bytes = 0;
 }
 
 void vpackfile_apply_patches()
@@ -556,11 +785,31 @@ void vpackfile_apply_patches()
 
 void vpackfile_find_matching_files(const StringMatcher& query, std::function<void(const char*)> result_consumer)
 {
-    for (auto& p : g_loopup_table) {
-        if (query(p.first.c_str())) {
-            result_consumer(p.first.c_str());
+    g_name_index.update(g_loopup_table);
+    auto check_entry = [&](const rf::VPackfileEntry* entry) {
+        if (query(entry->name)) {
+            result_consumer(entry->name);
         }
+    };
+    // Use the narrowest index applicable to the query
+    const std::string& prefix = query.get_prefix();
+    const std::string& suffix = query.get_suffix();
+    auto suffix_dot_pos = suffix.rfind('.');
+    if (!prefix.empty()) {
+        g_name_index.for_each_with_prefix(prefix, check_entry);
+    }
+    else if (suffix_dot_pos != std::string::npos) {
+        // All names ending with the suffix have the same extension as the suffix
+        g_name_index.for_each_with_ext(string_to_lower(suffix.substr(suffix_dot_pos + 1)), check_entry);
     }
+    else {
+        g_name_index.for_each(check_entry);
+    }
+}
+
+const rf::VPackfileEntry* vpackfile_lookup(const char* filename)
+{
+    return g_loopup_table.find(filename);
 }
 
 void vpackfile_disable_overriding()
@@ -1,7 +1,18 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <vector>
+#include <optional>
+#include <span>
+#include <cstddef>
 #include <common/utils/string-utils.h>
+#include "vpackfile_index_cache.h"
+
+namespace rf
+{
+    struct VPackfileEntry;
+}
 
 enum GameLang
 {
@@ -11,7 +22,18 @@ enum GameLang
 };
 
 void vpackfile_apply_patches();
+void vpackfile_do_frame();
 GameLang get_installed_game_lang();
 bool is_modded_game();
 void vpackfile_find_matching_files(const StringMatcher& query, std::function<void(const char*)> result_consumer);
 void vpackfile_disable_overriding();
+// Loads packfiles from the same directory parsing them in parallel, returns number of loaded packfiles
+unsigned vpackfile_add_multiple(const std::vector<std::string>& filenames, const char* dir);
+// Stores directory of a packfile parsed by the caller (e.g. when it was extracted) so the packfile is not opened
+// and parsed again when it is loaded
+void vpackfile_add_to_index_cache(const char* filename, const char* dir, VPackfileIndexCache::Index index);
+// Returns contents of a file stored in a packfile without copying (valid until packfiles are released)
+std::optional<std::span<const std::byte>> vpackfile_get_file_view(const char* filename);
+// Finds a file in loaded packfiles. Can be called from worker threads as long as packfiles are not being added or
+// released at the same time (see level_prefetch_abort).
+const rf::VPackfileEntry* vpackfile_lookup(const char* filename);
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <vector>
+#include <vpp/ArchiveView.h>
+#include "vpackfile_directory_parser.h"
+
+VPackfileIndexCache::Index vpackfile_parse_directory(const std::string& full_path)
+{
+    // Read only the header and the directory - several packfiles are parsed at once and mapping whole packfiles
+    // could exhaust the address space of the game process
+    std::ifstream file{full_path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate};
+    if (!file) {
+        throw std::runtime_error{"cannot open file " + full_path};
+    }
+    auto file_size = static_cast<std::size_t>(file.tellg());
+    std::vector<std::byte> buf(std::min(file_size, vpp::block_size));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+    if (buf.size() == vpp::block_size) {
+        // Header is validated by ArchiveView, number of files is only used to limit the read size
+        const auto& hdr = *reinterpret_cast<const vpp::Header*>(buf.data());
+        std::size_t directory_end = hdr.num_files > file_size / sizeof(vpp::FileInfo)
+            ? file_size
+            : vpp::block_offset(vpp::first_data_block(hdr.num_files));
+        buf.resize(std::min(file_size, directory_end));
+        file.read(reinterpret_cast<char*>(buf.data()) + vpp::block_size,
+            static_cast<std::streamsize>(buf.size() - vpp::block_size));
+    }
+    if (!file) {
+        throw std::runtime_error{"cannot read file " + full_path};
+    }
+    vpp::ArchiveView archive{buf};
+    const vpp::FileInfo* file_infos = archive.file_infos();
+    return {archive.header().total_size, {file_infos, file_infos + archive.num_files()}};
+}
+
+std::vector<VPackfileParseResult> vpackfile_parse_directories(const std::vector<std::string>& full_paths,
+    std::size_t max_workers)
+{
+    std::vector<VPackfileParseResult> results(full_paths.size());
+    std::atomic<std::size_t> next_idx{0};
+    auto worker = [&]() {
+        std::size_t idx;
+        while ((idx = next_idx++) < full_paths.size()) {
+            try {
+                results[idx].index = vpackfile_parse_directory(full_paths[idx]);
+            }
+            catch (const std::exception& e) {
+                results[idx].error = e.what();
+            }
+        }
+    };
+    std::size_t num_workers = std::min(max_workers, full_paths.size());
+    std::vector<std::future<void>> futures;
+    for (std::size_t i = 1; i < num_workers; ++i) {
+        futures.push_back(std::async(std::launch::async, worker));
+    }
+    worker();
+    for (auto& future : futures) {
+        future.get();
+    }
+    return results;
+}
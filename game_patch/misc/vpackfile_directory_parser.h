@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+#include "vpackfile_index_cache.h"
+
+struct VPackfileParseResult
+{
+    std::optional<VPackfileIndexCache::Index> index;
+    std::string error;
+};
+
+// Parses directory of a packfile. Throws std::exception on error.
+// Note: can be called from worker threads
+VPackfileIndexCache::Index vpackfile_parse_directory(const std::string& full_path);
+
+// Parses directories of multiple packfiles using up to max_workers threads (the calling thread is one of them).
+// Results are returned in the order of paths no matter which worker parsed a packfile.
+std::vector<VPackfileParseResult> vpackfile_parse_directories(const std::vector<std::string>& full_paths,
+    std::size_t max_workers);
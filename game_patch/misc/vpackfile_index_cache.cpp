@@ -0,0 +1,221 @@
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <xlog/xlog.h>
+#include "vpackfile_index_cache.h"
+
+// File layout:
+//   CacheHeader
+//   for each packfile:
+//     uint32_t path_len, char path[path_len]
+//     uint64_t size, uint64_t mtime, uint32_t has_checksum, uint32_t checksum, uint32_t total_size, uint32_t num_files
+//     vpp::FileInfo file_infos[num_files]
+struct CacheHeader
+{
+    std::uint32_t sig;
+    std::uint32_t version;
+    std::uint32_t num_packfiles;
+};
+
+constexpr std::uint32_t index_cache_sig = 0x49565044; // DPVI
+// Bump the version when file layout changes
+constexpr std::uint32_t index_cache_version = 2;
+
+class CacheReader
+{
+    const char* ptr_;
+    const char* end_;
+
+public:
+    CacheReader(const std::vector<char>& buf) : ptr_(buf.data()), end_(buf.data() + buf.size()) {}
+
+    bool read(void* out, std::size_t len)
+    {
+        if (static_cast<std::size_t>(end_ - ptr_) < len) {
+            return false;
+        }
+        std::memcpy(out, ptr_, len);
+        ptr_ += len;
+        return true;
+    }
+
+    template<typename T>
+    bool read(T& out)
+    {
+        return read(&out, sizeof(out));
+    }
+};
+
+bool VPackfileIndexCache::get_file_stamp(const char* path, FileStamp& stamp)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    stamp.size = size;
+    stamp.mtime = static_cast<std::uint64_t>(mtime.time_since_epoch().count());
+    return true;
+}
+
+bool VPackfileIndexCache::load(const char* filename)
+{
+    // Read the whole file at once
+    std::ifstream file(filename, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+    if (!file) {
+        xlog::debug("Packfile index cache not found");
+        return false;
+    }
+    std::vector<char> buf(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(buf.data(), buf.size())) {
+        xlog::warn("Failed to read packfile index cache");
+        return false;
+    }
+
+    CacheReader reader{buf};
+    CacheHeader hdr;
+    if (!reader.read(hdr) || hdr.sig != index_cache_sig || hdr.version != index_cache_version) {
+        xlog::info("Ignoring packfile index cache with unsupported version");
+        return false;
+    }
+
+    std::unordered_map<std::string, Record> records;
+    for (std::uint32_t i = 0; i < hdr.num_packfiles; ++i) {
+        std::uint32_t path_len, num_files, has_checksum, checksum;
+        std::string path;
+        Record record;
+        bool ok = reader.read(path_len) && path_len < vpp::block_size;
+        if (ok) {
+            path.resize(path_len);
+            ok = reader.read(path.data(), path_len)
+                && reader.read(record.stamp.size)
+                && reader.read(record.stamp.mtime)
+                && reader.read(has_checksum)
+                && reader.read(checksum)
+                && reader.read(record.index.total_size)
+                && reader.read(num_files)
+                && num_files <= buf.size() / sizeof(vpp::FileInfo);
+        }
+        if (ok) {
+            record.index.file_infos.resize(num_files);
+            ok = reader.read(record.index.file_infos.data(), num_files * sizeof(vpp::FileInfo));
+        }
+        if (!ok) {
+            xlog::warn("Packfile index cache is corrupted");
+            return false;
+        }
+        if (has_checksum) {
+            record.checksum = checksum;
+        }
+        records.emplace(std::move(path), std::move(record));
+    }
+
+    records_ = std::move(records);
+    xlog::debug("Loaded packfile index cache: {} packfiles", records_.size());
+    return true;
+}
+
+bool VPackfileIndexCache::save(const char* filename)
+{
+    // Write to a temporary file and replace the cache at the end so it is never left half-written
+    std::string temp_filename = std::string{filename} + ".tmp";
+    std::ofstream file(temp_filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!file) {
+        xlog::warn("Failed to open packfile index cache for writing");
+        return false;
+    }
+
+    // Only store packfiles that were used in this session so removed packfiles do not stay in the cache forever
+    CacheHeader hdr{index_cache_sig, index_cache_version, 0};
+    for (auto& [path, record] : records_) {
+        if (record.used) {
+            ++hdr.num_packfiles;
+        }
+    }
+    file.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    for (auto& [path, record] : records_) {
+        if (!record.used) {
+            continue;
+        }
+        auto path_len = static_cast<std::uint32_t>(path.size());
+        auto num_files = static_cast<std::uint32_t>(record.index.file_infos.size());
+        std::uint32_t has_checksum = record.checksum.has_value();
+        std::uint32_t checksum = record.checksum.value_or(0);
+        file.write(reinterpret_cast<const char*>(&path_len), sizeof(path_len));
+        file.write(path.data(), path_len);
+        file.write(reinterpret_cast<const char*>(&record.stamp.size), sizeof(record.stamp.size));
+        file.write(reinterpret_cast<const char*>(&record.stamp.mtime), sizeof(record.stamp.mtime));
+        file.write(reinterpret_cast<const char*>(&has_checksum), sizeof(has_checksum));
+        file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        file.write(reinterpret_cast<const char*>(&record.index.total_size), sizeof(record.index.total_size));
+        file.write(reinterpret_cast<const char*>(&num_files), sizeof(num_files));
+        file.write(reinterpret_cast<const char*>(record.index.file_infos.data()),
+            num_files * sizeof(vpp::FileInfo));
+    }
+
+    file.close();
+    std::error_code ec;
+    if (!file) {
+        xlog::warn("Failed to write packfile index cache");
+        std::filesystem::remove(temp_filename, ec);
+        return false;
+    }
+    std::filesystem::rename(temp_filename, filename, ec);
+    if (ec) {
+        xlog::warn("Failed to replace packfile index cache: {}", ec.message());
+        std::filesystem::remove(temp_filename, ec);
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+const VPackfileIndexCache::Index* VPackfileIndexCache::find(const std::string& packfile_path)
+{
+    auto it = records_.find(packfile_path);
+    FileStamp stamp;
+    if (it == records_.end() || !get_file_stamp(packfile_path.c_str(), stamp) || it->second.stamp != stamp) {
+        ++num_misses_;
+        return nullptr;
+    }
+    ++num_hits_;
+    it->second.used = true;
+    return &it->second.index;
+}
+
+const VPackfileIndexCache::Index& VPackfileIndexCache::add(const std::string& packfile_path, Index index)
+{
+    Record& record = records_[packfile_path];
+    if (!get_file_stamp(packfile_path.c_str(), record.stamp)) {
+        // Make sure the record is never matched
+        record.stamp = {};
+    }
+    record.index = std::move(index);
+    record.checksum.reset();
+    record.used = true;
+    dirty_ = true;
+    return record.index;
+}
+
+std::optional<std::uint32_t> VPackfileIndexCache::get_checksum(const std::string& packfile_path) const
+{
+    auto it = records_.find(packfile_path);
+    if (it == records_.end()) {
+        return {};
+    }
+    return it->second.checksum;
+}
+
+void VPackfileIndexCache::set_checksum(const std::string& packfile_path, std::uint32_t checksum)
+{
+    auto it = records_.find(packfile_path);
+    if (it != records_.end()) {
+        it->second.checksum = checksum;
+        dirty_ = true;
+    }
+}
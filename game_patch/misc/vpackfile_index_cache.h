@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vpp/format.h>
+
+// Persistent cache of packfile directories so unchanged packfiles do not have to be opened and parsed on startup
+class VPackfileIndexCache
+{
+public:
+    struct Index
+    {
+        std::uint32_t total_size = 0;
+        std::vector<vpp::FileInfo> file_infos;
+    };
+
+    bool load(const char* filename);
+    bool save(const char* filename);
+    // Returns nullptr if packfile is not in the cache or it has been modified
+    const Index* find(const std::string& packfile_path);
+    const Index& add(const std::string& packfile_path, Index index);
+    // Whole file checksum is cached together with the directory so unchanged packfiles are not hashed again
+    std::optional<std::uint32_t> get_checksum(const std::string& packfile_path) const;
+    void set_checksum(const std::string& packfile_path, std::uint32_t checksum);
+
+    [[nodiscard]] bool is_dirty() const
+    {
+        return dirty_;
+    }
+
+    [[nodiscard]] unsigned num_hits() const
+    {
+        return num_hits_;
+    }
+
+    [[nodiscard]] unsigned num_misses() const
+    {
+        return num_misses_;
+    }
+
+private:
+    struct FileStamp
+    {
+        std::uint64_t size = 0;
+        std::uint64_t mtime = 0;
+
+        bool operator==(const FileStamp& other) const = default;
+    };
+
+    struct Record
+    {
+        FileStamp stamp;
+        Index index;
+        std::optional<std::uint32_t> checksum;
+        bool used = false;
+    };
+
+    std::unordered_map<std::string, Record> records_;
+    bool dirty_ = false;
+    unsigned num_hits_ = 0;
+    unsigned num_misses_ = 0;
+
+    static bool get_file_stamp(const char* path, FileStamp& stamp);
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <common/utils/string-utils.h>
+#include "../rf/file/packfile.h"
+
+// Case-insensitive hash table mapping file names to packfile entries
+// Keys are not copied - names owned by entries are used instead so lookups and insertions do not allocate memory
+// (except when the table grows). Open addressing with linear probing is used.
+class VPackfileLookupTable
+{
+    struct Slot
+    {
+        std::uint32_t hash;
+        rf::VPackfileEntry* entry;
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t size_ = 0;
+
+public:
+    VPackfileLookupTable()
+    {
+        slots_.resize(16);
+    }
+
+    void reserve(std::size_t num_entries)
+    {
+        // Keep load factor below 0.5
+        std::size_t capacity = slots_.size();
+        while (capacity < num_entries * 2) {
+            capacity *= 2;
+        }
+        if (capacity != slots_.size()) {
+            rehash(capacity);
+        }
+    }
+
+    [[nodiscard]] rf::VPackfileEntry* find(const char* name) const
+    {
+        std::uint32_t hash = hash_name(name);
+        std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots_[i];
+            if (!slot.entry) {
+                return nullptr;
+            }
+            if (slot.hash == hash && names_equal(slot.entry->name, name)) {
+                return slot.entry;
+            }
+        }
+    }
+
+    // Returns reference to the stored entry pointer and true if entry has been inserted or false if an entry with
+    // the same name already exists
+    std::pair<rf::VPackfileEntry*&, bool> insert(rf::VPackfileEntry* entry)
+    {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            rehash(slots_.size() * 2);
+        }
+        std::uint32_t hash = hash_name(entry->name);
+        std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots_[i];
+            if (!slot.entry) {
+                slot = {hash, entry};
+                ++size_;
+                return {slot.entry, true};
+            }
+            if (slot.hash == hash && names_equal(slot.entry->name, entry->name)) {
+                return {slot.entry, false};
+            }
+        }
+    }
+
+    // Inserts entry or replaces an entry with the same name if is_override_allowed(stored_entry, entry) returns
+    // true. Returns false on name collision.
+    template<typename F>
+    bool insert_or_override(rf::VPackfileEntry* entry, F is_override_allowed)
+    {
+        auto [stored_entry, inserted] = insert(entry);
+        if (!inserted && is_override_allowed(stored_entry, entry)) {
+            stored_entry = entry;
+        }
+        return inserted;
+    }
+
+    void clear()
+    {
+        std::fill(slots_.begin(), slots_.end(), Slot{0, nullptr});
+        size_ = 0;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        return size_;
+    }
+
+    template<typename F>
+    void for_each(F fun) const
+    {
+        for (const Slot& slot : slots_) {
+            if (slot.entry) {
+                fun(slot.entry);
+            }
+        }
+    }
+
+private:
+    // FNV-1a of lower-case name
+    static std::uint32_t hash_name(const char* name)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (const char* p = name; *p; ++p) {
+            hash ^= ascii_to_lower(static_cast<unsigned char>(*p));
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static bool names_equal(const char* a, const char* b)
+    {
+        while (ascii_to_lower(static_cast<unsigned char>(*a)) ==
+            ascii_to_lower(static_cast<unsigned char>(*b))) {
+            if (!*a) {
+                return true;
+            }
+            ++a;
+            ++b;
+        }
+        return false;
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<Slot> old_slots = std::exchange(slots_, std::vector<Slot>(capacity, Slot{0, nullptr}));
+        std::size_t mask = capacity - 1;
+        for (const Slot& old_slot : old_slots) {
+            if (old_slot.entry) {
+                std::size_t i = old_slot.hash & mask;
+                while (slots_[i].entry) {
+                    i = (i + 1) & mask;
+                }
+                slots_[i] = old_slot;
+            }
+        }
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <common/utils/string-utils.h>
+#include "vpackfile_lookup_table.h"
+
+// Secondary indexes of files visible through the lookup table used by file search (e.g. console autocompletion)
+// Names are sorted case-insensitively so prefix queries are resolved by a binary search and files are grouped by
+// lower-case extension. Index is rebuilt lazily after the lookup table changes.
+class VPackfileNameIndex
+{
+    std::vector<rf::VPackfileEntry*> sorted_entries_;
+    std::unordered_map<std::string, std::vector<rf::VPackfileEntry*>> entries_by_ext_;
+    bool valid_ = false;
+
+public:
+    void invalidate()
+    {
+        valid_ = false;
+    }
+
+    void update(const VPackfileLookupTable& lookup_table)
+    {
+        if (valid_) {
+            return;
+        }
+        sorted_entries_.clear();
+        sorted_entries_.reserve(lookup_table.size());
+        entries_by_ext_.clear();
+        lookup_table.for_each([&](rf::VPackfileEntry* entry) {
+            sorted_entries_.push_back(entry);
+        });
+        std::sort(sorted_entries_.begin(), sorted_entries_.end(), [](const auto* a, const auto* b) {
+            return compare_names(a->name, b->name) < 0;
+        });
+        // Build extension index from sorted entries so each group is sorted too
+        for (auto* entry : sorted_entries_) {
+            entries_by_ext_[string_to_lower(get_ext_from_filename(entry->name))].push_back(entry);
+        }
+        valid_ = true;
+    }
+
+    void clear()
+    {
+        sorted_entries_.clear();
+        entries_by_ext_.clear();
+        valid_ = false;
+    }
+
+    template<typename F>
+    void for_each_with_prefix(std::string_view prefix, F fun) const
+    {
+        auto it = std::lower_bound(sorted_entries_.begin(), sorted_entries_.end(), prefix,
+            [](const auto* entry, std::string_view prefix) {
+                return compare_names(entry->name, prefix) < 0;
+            });
+        for (; it != sorted_entries_.end() && string_starts_with_ignore_case((*it)->name, prefix); ++it) {
+            fun(*it);
+        }
+    }
+
+    // Extension is expected to be in lower-case and without the dot
+    template<typename F>
+    void for_each_with_ext(const std::string& ext, F fun) const
+    {
+        auto it = entries_by_ext_.find(ext);
+        if (it != entries_by_ext_.end()) {
+            std::for_each(it->second.begin(), it->second.end(), fun);
+        }
+    }
+
+    template<typename F>
+    void for_each(F fun) const
+    {
+        std::for_each(sorted_entries_.begin(), sorted_entries_.end(), fun);
+    }
+
+private:
+    static int compare_names(std::string_view a, std::string_view b)
+    {
+        std::size_t len = std::min(a.size(), b.size());
+        for (std::size_t i = 0; i < len; ++i) {
+            int diff = ascii_to_lower(static_cast<unsigned char>(a[i])) -
+                ascii_to_lower(static_cast<unsigned char>(b[i]));
+            if (diff != 0) {
+                return diff;
+            }
+        }
+        return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+    }
+};
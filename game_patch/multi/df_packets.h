@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <common/rfproto.h>
+
+#pragma pack(push, 1)
+
+// Packets supported only by Dash Faction. Types must not collide with game and Pure Faction packets.
+enum class df_packet_type : uint8_t
+{
+    obj_update_delta = 0x50,
+    obj_update_ack = 0x51,
+};
+
+enum df_obj_update_delta_encoding : uint8_t
+{
+    obj_update_delta_baseline_age_mask = 0x1F, // seq - baseline seq, 0 if object is not delta-encoded
+    obj_update_delta_quantized_pos = 0x80,
+};
+
+// Sent by the server instead of obj_update to clients that acknowledge them (see obj_update_delta.h)
+struct df_obj_update_delta_packet
+{
+    RF_GamePacketHeader header; // obj_update_delta
+    uint16_t seq;               // sequence number of this update
+    uint8_t object_count;
+#ifdef PSEUDOCODE
+    struct
+    {
+        uint32_t handle;
+        uint8_t flags;          // RF_ObjectUpdateFlags
+        uint8_t encoding;       // see df_obj_update_delta_encoding
+        if (encoding & obj_update_delta_baseline_age_mask) {
+            uint8_t sent_fields[]; // bitmap of fields present in flags that follow, other fields are copied
+                                   // from the baseline, (field count + 7) / 8 bytes
+        }
+        uint8_t fields[];       // fields in the same format as in obj_update, if encoding has
+                                // obj_update_delta_quantized_pos flag position is stored as bit-packed integers
+                                // (see PositionQuantizer)
+    } objects[object_count];
+#endif
+};
+
+// Client -> server. Acknowledges received obj_update_delta packets.
+struct df_obj_update_ack_packet
+{
+    RF_GamePacketHeader header; // obj_update_ack
+    uint16_t seq;               // the most recent received seq
+    uint32_t received_bits;     // bit N is set if packet with sequence number seq - N was received, 0 if no
+                                // packet was received yet (client asks for delta compression)
+};
+
+#pragma pack(pop)
@@ -4,15 +4,38 @@
 #include <sstream>
 #include <chrono>
 #include <functional>
+#include <vector>
 #include <stdexcept>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <filesystem>
+#include <random>
+#include <memory>
+#include <format>
 #include <xlog/xlog.h>
 #include "faction_files.h"
 
 static const char level_download_agent_name[] = "Dash Faction";
 static const char level_download_base_url[] = "https://autodl.factionfiles.com";
+static constexpr int max_download_retries = 5;
+// Total size of parts downloaded by additional connections kept in memory - the rest goes to temporary files
+static constexpr std::size_t max_buffered_parts_size = 8 * 1024 * 1024;
 
-FactionFilesClient::FactionFilesClient() : session_{level_download_agent_name}
+FactionFilesClient::FactionFilesClient(std::string base_url) :
+    session_{level_download_agent_name}, base_url_{std::move(base_url)}
 {
+    if (base_url_.empty()) {
+        base_url_ = level_download_base_url;
+        // Allows testing against a local server (see tools/mock_factionfiles.py)
+        const char* base_url_override = std::getenv("DF_FACTIONFILES_URL");
+        if (base_url_override && base_url_override[0]) {
+            base_url_ = base_url_override;
+        }
+    }
     session_.set_connect_timeout(2000);
     session_.set_receive_timeout(3000);
 }
@@ -54,7 +77,7 @@ std::optional<FactionFilesClient::LevelInfo> FactionFilesClient::parse_level_inf
 
 std::optional<FactionFilesClient::LevelInfo> FactionFilesClient::find_map(const char* file_name)
 {
-    auto url = std::format("{}/findmap.php?rflName={}", level_download_base_url, encode_uri_component(file_name));
+    auto url = std::format("{}/findmap.php?rflName={}", base_url_, encode_uri_component(file_name));
 
     xlog::trace("Fetching level info: {}", file_name);
     HttpRequest req{url, "GET", session_};
@@ -72,39 +95,217 @@ std::optional<FactionFilesClient::LevelInfo> FactionFilesClient::find_map(const
     return parse_level_info(buf);
 }
 
-void FactionFilesClient::download_map(const char* tmp_filename, int ticket_id,
+// Thrown when download is aborted by the caller so it is not retried
+struct DownloadAbortedError : std::runtime_error
+{
+    DownloadAbortedError() : std::runtime_error("download aborted") {}
+};
+
+struct RangeDownloadContext
+{
+    HttpSession& session;
+    const std::string& url;
+    std::atomic<bool>& abort_flag;
+    std::atomic<unsigned>& bytes_received;
+};
+
+// Reads bytes [begin, end) of the resource and passes them to data_consumer in order. If connection fails
+// download is resumed by sending a request for the remaining part of the range.
+// If req is provided it must be an already sent request for data starting at begin.
+static void download_range(RangeDownloadContext& ctx, std::size_t begin, std::optional<std::size_t> end,
+    std::optional<HttpRequest> req, const std::function<void(const char* data, std::size_t len)>& data_consumer)
+{
+    std::vector<char> buf(64 * 1024);
+    std::size_t pos = begin;
+    int num_failures = 0;
+    while (!end || pos < end.value()) {
+        try {
+            if (!req) {
+                req.emplace(ctx.url, "GET", ctx.session);
+                req.value().set_range(pos, end);
+                req.value().send();
+            }
+            // Server that does not support ranges sends the whole resource - skip data that has been already read
+            std::size_t skip = req.value().get_status_code() == 206 ? 0 : pos;
+            while (!end || pos < end.value()) {
+                if (ctx.abort_flag) {
+                    throw DownloadAbortedError{};
+                }
+                std::size_t max_len = end ? std::min(buf.size(), end.value() - pos + skip) : buf.size();
+                std::size_t num_bytes_read = req.value().read(buf.data(), max_len);
+                if (num_bytes_read == 0) {
+                    break;
+                }
+                std::size_t num_skipped = std::min(skip, num_bytes_read);
+                skip -= num_skipped;
+                if (num_bytes_read > num_skipped) {
+                    data_consumer(buf.data() + num_skipped, num_bytes_read - num_skipped);
+                    pos += num_bytes_read - num_skipped;
+                    ctx.bytes_received += static_cast<unsigned>(num_bytes_read - num_skipped);
+                }
+            }
+            if (!end) {
+                // Length is unknown - end of data cannot be distinguished from a closed connection
+                return;
+            }
+            if (pos < end.value()) {
+                throw std::runtime_error("connection closed before the end of data");
+            }
+        }
+        catch (const DownloadAbortedError&) {
+            throw;
+        }
+        catch (const std::exception& e) {
+            req.reset();
+            if (ctx.abort_flag || ++num_failures > max_download_retries) {
+                throw;
+            }
+            xlog::warn("Download interrupted at byte {} ({}), retrying", pos, e.what());
+            std::this_thread::sleep_for(std::chrono::milliseconds{500 * num_failures});
+        }
+    }
+}
+
+// Part of the archive downloaded by an additional connection before it can be passed to the consumer. Data over
+// max_memory_size is written to a temporary file so big archives do not use up address space of the game process.
+class DownloadPartBuffer
+{
+public:
+    explicit DownloadPartBuffer(std::size_t max_memory_size) : max_memory_size_{max_memory_size} {}
+
+    ~DownloadPartBuffer()
+    {
+        if (file_.is_open()) {
+            file_.close();
+            std::error_code ec;
+            std::filesystem::remove(file_path_, ec);
+        }
+    }
+
+    DownloadPartBuffer(const DownloadPartBuffer&) = delete;
+    DownloadPartBuffer& operator=(const DownloadPartBuffer&) = delete;
+
+    void append(const char* data, std::size_t len)
+    {
+        std::size_t memory_len = std::min(len, max_memory_size_ - memory_.size());
+        memory_.insert(memory_.end(), data, data + memory_len);
+        if (memory_len < len) {
+            if (!file_.is_open()) {
+                open_file();
+            }
+            if (!file_.write(data + memory_len, static_cast<std::streamsize>(len - memory_len))) {
+                throw std::runtime_error("cannot write temporary download file");
+            }
+        }
+    }
+
+    void consume(const std::function<void(const char* data, std::size_t len)>& data_consumer)
+    {
+        data_consumer(memory_.data(), memory_.size());
+        memory_ = {};
+        if (!file_.is_open()) {
+            return;
+        }
+        file_.seekg(0);
+        std::vector<char> buf(64 * 1024);
+        while (file_.read(buf.data(), static_cast<std::streamsize>(buf.size())) || file_.gcount() > 0) {
+            data_consumer(buf.data(), static_cast<std::size_t>(file_.gcount()));
+        }
+        if (!file_.eof()) {
+            throw std::runtime_error("cannot read temporary download file");
+        }
+    }
+
+private:
+    std::size_t max_memory_size_;
+    std::vector<char> memory_;
+    std::string file_path_;
+    std::fstream file_;
+
+    void open_file()
+    {
+        std::random_device rd;
+        auto dir = std::filesystem::temp_directory_path();
+        file_path_ = (dir / std::format("df_download_{:08x}{:08x}.tmp", rd(), rd())).string();
+        file_.open(file_path_, std::ios_base::in | std::ios_base::out | std::ios_base::binary |
+            std::ios_base::trunc);
+        if (!file_) {
+            throw std::runtime_error("cannot create temporary download file");
+        }
+    }
+};
+
+void FactionFilesClient::download_map(int ticket_id, unsigned num_connections,
+    std::function<void(const char* data, std::size_t len)> data_consumer,
     std::function<bool(unsigned bytes_received, std::chrono::milliseconds duration)> callback)
 {
-    auto url = std::format("{}/downloadmap.php?ticketid={}", level_download_base_url, ticket_id);
+    auto url = std::format("{}/downloadmap.php?ticketid={}", base_url_, ticket_id);
     HttpRequest req{url, "GET", session_};
     req.send();
-
-    std::ofstream tmp_file(tmp_filename, std::ios_base::out | std::ios_base::binary);
-    if (!tmp_file) {
-        xlog::error("Cannot open file: {}", tmp_filename);
-        throw std::runtime_error("cannot open file");
-    }
+    std::optional<std::size_t> total_size = req.get_content_length();
+    bool ranges_supported = req.get_header("Accept-Ranges") == "bytes";
 
     // Note: we are connected here - don't include it in duration so speed calculation can be more precise
-    tmp_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     auto download_start = std::chrono::steady_clock::now();
-    unsigned total_bytes_read = 0;
+    std::atomic<bool> abort_flag{false};
+    std::atomic<unsigned> bytes_received{0};
+    RangeDownloadContext ctx{session_, url, abort_flag, bytes_received};
 
-    char buf[4096];
-    while (true) {
-        auto num_bytes_read = req.read(buf, sizeof(buf));
-        if (num_bytes_read <= 0)
-            break;
-
-        tmp_file.write(buf, num_bytes_read);
-
-        total_bytes_read += num_bytes_read;
+    auto report_progress = [&]() {
         auto time_diff = std::chrono::steady_clock::now() - download_start;
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(time_diff);
-
-        if (callback && !callback(total_bytes_read, duration)) {
+        if (callback && !callback(bytes_received, duration)) {
             xlog::debug("Download aborted");
-            throw std::runtime_error("download aborted");
+            abort_flag = true;
+            throw DownloadAbortedError{};
+        }
+    };
+    auto consume_and_report_progress = [&](const char* data, std::size_t len) {
+        data_consumer(data, len);
+        report_progress();
+    };
+
+    if (num_connections <= 1 || !ranges_supported || !total_size || total_size.value() < num_connections * 1024 * 1024) {
+        download_range(ctx, 0, total_size, std::move(req), consume_and_report_progress);
+        return;
+    }
+
+    // First part is read from the already sent request and passed to the consumer as it arrives. Other parts are
+    // downloaded in parallel and passed to the consumer in order when previous parts are done.
+    xlog::debug("Downloading {} bytes using {} connections", total_size.value(), num_connections);
+    std::size_t part_size = total_size.value() / num_connections;
+    std::vector<std::unique_ptr<DownloadPartBuffer>> part_buffers(num_connections);
+    std::vector<std::future<void>> part_futures;
+    for (unsigned i = 1; i < num_connections; ++i) {
+        std::size_t part_begin = i * part_size;
+        std::size_t part_end = i + 1 < num_connections ? part_begin + part_size : total_size.value();
+        part_buffers[i] = std::make_unique<DownloadPartBuffer>(max_buffered_parts_size / (num_connections - 1));
+        part_futures.push_back(std::async(std::launch::async, [&, i, part_begin, part_end]() {
+            download_range(ctx, part_begin, part_end, {}, [&](const char* data, std::size_t len) {
+                part_buffers[i]->append(data, len);
+            });
+        }));
+    }
+    try {
+        download_range(ctx, 0, part_size, std::move(req), consume_and_report_progress);
+        for (unsigned i = 1; i < num_connections; ++i) {
+            auto& future = part_futures[i - 1];
+            while (future.wait_for(std::chrono::milliseconds{100}) != std::future_status::ready) {
+                report_progress();
+            }
+            future.get();
+            part_buffers[i]->consume(data_consumer);
+            part_buffers[i].reset();
+        }
+    }
+    catch (...) {
+        // Stop other connections before buffers are destroyed
+        abort_flag = true;
+        for (auto& future : part_futures) {
+            if (future.valid()) {
+                future.wait();
+            }
         }
+        throw;
     }
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <optional>
 #include <string>
 #include <common/HttpRequest.h>
 
@@ -15,13 +18,20 @@ public:
         int ticket_id;
     };
 
-    FactionFilesClient();
+    // If base_url is empty FactionFiles autodl service is used. Other servers implementing the same API can be used
+    // too (e.g. a game server with level transfer enabled).
+    explicit FactionFilesClient(std::string base_url = {});
     std::optional<LevelInfo> find_map(const char* file_name);
-    void download_map(const char* tmp_filename, int ticket_id,
+    // Passes archive data to data_consumer in order as it arrives. Interrupted connections are resumed and if
+    // num_connections is greater than 1 and the server supports ranges parts of the archive are downloaded
+    // in parallel.
+    void download_map(int ticket_id, unsigned num_connections,
+        std::function<void(const char* data, std::size_t len)> data_consumer,
         std::function<bool(unsigned bytes_received, std::chrono::milliseconds duration)> callback);
 
 private:
     HttpSession session_;
+    std::string base_url_;
 
     static std::optional<LevelInfo> parse_level_info(const char* buf);
 };
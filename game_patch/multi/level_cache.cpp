@@ -0,0 +1,197 @@
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <unordered_set>
+#include <windows.h>
+#include <xxhash.h>
+#include <xlog/xlog.h>
+#include "../rf/file/file.h"
+#include "../rf/file/packfile.h"
+#include "../misc/vpackfile.h"
+#include "../main/main.h"
+#include "../os/console.h"
+#include "level_cache.h"
+#include "level_cache_manifest.h"
+
+class LevelCache
+{
+    std::optional<LevelCacheManifest> manifest_;
+    // Loaded packfiles cannot be removed until the game exits
+    std::unordered_set<std::string> mounted_;
+
+    LevelCacheManifest& manifest()
+    {
+        if (!manifest_) {
+            manifest_.emplace(level_cache_get_path());
+            manifest_->load();
+            xlog::info("Level cache: {} packfiles, {} MB", manifest_->entries().size(),
+                manifest_->get_total_size() / 1024 / 1024);
+        }
+        return manifest_.value();
+    }
+
+    void evict()
+    {
+        manifest().evict(static_cast<std::uint64_t>(g_game_config.level_cache_size) * 1024 * 1024, mounted_);
+    }
+
+public:
+    bool mount_level(const char* level_filename)
+    {
+        LevelCacheEntry* entry = manifest().find_level(level_filename);
+        if (!entry) {
+            manifest().record_miss();
+            return false;
+        }
+        xlog::info("Loading level {} from cached packfile {}", level_filename, entry->filename);
+        rf::vpackfile_set_loading_user_maps(true);
+        unsigned num_loaded = vpackfile_add_multiple({entry->filename}, level_cache_dir);
+        rf::vpackfile_set_loading_user_maps(false);
+        if (!num_loaded) {
+            // Packfile has been removed by the user or it is corrupted
+            std::string filename = entry->filename;
+            xlog::warn("Failed to load cached packfile {}", filename);
+            manifest().remove(filename);
+            manifest().record_miss();
+            manifest().save();
+            return false;
+        }
+        mounted_.insert(entry->filename);
+        manifest().record_hit(*entry, std::time(nullptr));
+        manifest().save();
+        return true;
+    }
+
+    bool contains_level(const char* level_filename)
+    {
+        return manifest().find_level(level_filename) != nullptr;
+    }
+
+    void add(const std::string& filename, std::uint64_t download_size, std::vector<std::string> level_filenames,
+        bool mounted)
+    {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(manifest().get_packfile_path(filename), ec);
+        if (ec) {
+            xlog::error("Cannot get size of cached packfile {}: {}", filename, ec.message());
+            return;
+        }
+        manifest().add({filename, size, download_size, std::time(nullptr), std::move(level_filenames)});
+        if (mounted) {
+            mounted_.insert(filename);
+        }
+        evict();
+        manifest().save();
+    }
+
+    void set_max_size(unsigned size_mb)
+    {
+        g_game_config.level_cache_size = size_mb;
+        g_game_config.save();
+        evict();
+        manifest().save();
+    }
+
+    void print_stats()
+    {
+        auto& m = manifest();
+        rf::console::print("Level cache: {} packfiles, {:.1f} MB / {} MB", m.entries().size(),
+            m.get_total_size() / 1024.0f / 1024.0f, g_game_config.level_cache_size.value());
+        rf::console::print("Hits: {}, misses: {}, downloads saved: {:.2f} MB", m.num_hits(), m.num_misses(),
+            m.bytes_saved() / 1000000.0f);
+    }
+
+    static LevelCache& instance()
+    {
+        static LevelCache inst;
+        return inst;
+    }
+};
+
+ConsoleCommand2 level_cache_cmd{
+    "level_cache",
+    [](std::optional<unsigned> size_mb_opt) {
+        if (size_mb_opt) {
+            LevelCache::instance().set_max_size(size_mb_opt.value());
+        }
+        LevelCache::instance().print_stats();
+    },
+    "Sets size limit (in MB) of the cache of downloaded levels and prints cache statistics",
+    "level_cache [size_mb]",
+};
+
+std::string level_cache_get_path()
+{
+    auto path = std::format("{}user_maps\\cache", rf::root_path);
+    CreateDirectoryA(path.c_str(), nullptr);
+    return path;
+}
+
+// Note: called from worker threads
+static std::uint64_t hash_file(const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error{"cannot open extracted packfile"};
+    }
+    XXH64_state_t* state = XXH64_createState();
+    XXH64_reset(state, 0);
+    std::vector<char> buffer(1024 * 1024);
+    std::size_t len;
+    while ((len = std::fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+        XXH64_update(state, buffer.data(), len);
+    }
+    bool failed = std::ferror(file);
+    std::fclose(file);
+    XXH64_hash_t hash = XXH64_digest(state);
+    XXH64_freeState(state);
+    if (failed) {
+        throw std::runtime_error{"cannot read extracted packfile"};
+    }
+    return hash;
+}
+
+std::string level_cache_store_packfile(const std::string& filename)
+{
+    auto dir = level_cache_get_path();
+    auto path = dir + "\\" + filename;
+    auto hashed_filename = std::format("{:016x}.vpp", hash_file(path));
+    auto hashed_path = dir + "\\" + hashed_filename;
+    std::error_code ec;
+    if (std::filesystem::exists(hashed_path, ec)) {
+        // The same content is already cached
+        std::remove(path.c_str());
+    }
+    else {
+        std::filesystem::rename(path, hashed_path, ec);
+        if (ec) {
+            xlog::error("Cannot rename {} to {}: {}", path, hashed_path, ec.message());
+            throw std::runtime_error{"cannot rename extracted packfile"};
+        }
+    }
+    return hashed_filename;
+}
+
+bool level_cache_mount_level(const char* level_filename)
+{
+    return LevelCache::instance().mount_level(level_filename);
+}
+
+bool level_cache_contains_level(const char* level_filename)
+{
+    return LevelCache::instance().contains_level(level_filename);
+}
+
+void level_cache_add(const std::string& filename, std::uint64_t download_size,
+    std::vector<std::string> level_filenames, bool mounted)
+{
+    LevelCache::instance().add(filename, download_size, std::move(level_filenames), mounted);
+}
+
+void level_cache_init()
+{
+    level_cache_cmd.register_cmd();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Automatically downloaded packfiles are stored in user_maps\cache under names based on their content hash. They are
+// not loaded on startup - a cached packfile is loaded when a server switches to a level it contains. Least recently
+// used packfiles are removed when the cache grows over the configured size.
+
+// Relative to the game root directory
+constexpr const char* level_cache_dir = "user_maps\\cache\\";
+
+void level_cache_init();
+// Loads a cached packfile containing the level. Returns false if the level is not cached.
+bool level_cache_mount_level(const char* level_filename);
+// Checks if the level is cached without loading it (does not affect statistics)
+bool level_cache_contains_level(const char* level_filename);
+// Returns absolute path of the cache directory (without a trailing separator) and creates it if needed
+std::string level_cache_get_path();
+// Renames a packfile extracted into the cache directory so its name is based on its content. Returns the new name.
+// Note: called from worker threads
+std::string level_cache_store_packfile(const std::string& filename);
+// Registers a packfile stored by level_cache_store_packfile and removes old packfiles if the cache is full.
+// Loaded packfiles (mounted is true) are never removed.
+void level_cache_add(const std::string& filename, std::uint64_t download_size,
+    std::vector<std::string> level_filenames, bool mounted);
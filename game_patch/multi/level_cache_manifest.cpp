@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <xlog/xlog.h>
+#include <common/utils/string-utils.h>
+#include "../misc/vpackfile_directory_parser.h"
+#include "level_cache_manifest.h"
+
+bool is_level_cache_packfile_name(std::string_view filename)
+{
+    // 64-bit hash as 16 hex digits and extension
+    return filename.size() == 20 && string_ends_with(filename, ".vpp") &&
+        std::all_of(filename.begin(), filename.begin() + 16, [](char ch) {
+            return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f');
+        });
+}
+
+std::string LevelCacheManifest::get_manifest_path() const
+{
+    return (std::filesystem::path{dir_} / "manifest.txt").string();
+}
+
+std::string LevelCacheManifest::get_packfile_path(const std::string& filename) const
+{
+    return (std::filesystem::path{dir_} / filename).string();
+}
+
+void LevelCacheManifest::load()
+{
+    entries_.clear();
+    // One packfile per line: name, size, download size, last use time and levels separated by tabs
+    std::ifstream file{get_manifest_path()};
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream line_stream{line};
+        LevelCacheEntry entry;
+        std::string field;
+        std::vector<std::string> fields;
+        while (std::getline(line_stream, field, '\t')) {
+            fields.push_back(std::move(field));
+        }
+        if (fields.size() < 5) {
+            continue;
+        }
+        try {
+            entry.filename = fields[0];
+            entry.size = std::stoull(fields[1]);
+            entry.download_size = std::stoull(fields[2]);
+            entry.last_used = std::stoll(fields[3]);
+        }
+        catch (const std::exception&) {
+            xlog::warn("Invalid level cache manifest line: {}", line);
+            continue;
+        }
+        entry.level_filenames.assign(fields.begin() + 4, fields.end());
+        entries_.push_back(std::move(entry));
+    }
+    adopt_unlisted_packfiles();
+}
+
+void LevelCacheManifest::adopt_unlisted_packfiles()
+{
+    std::error_code ec;
+    for (const auto& dir_entry : std::filesystem::directory_iterator{dir_, ec}) {
+        auto filename = dir_entry.path().filename().string();
+        if (!is_level_cache_packfile_name(filename) || !dir_entry.is_regular_file(ec) ||
+            std::any_of(entries_.begin(), entries_.end(), [&](const auto& e) { return e.filename == filename; })) {
+            continue;
+        }
+        LevelCacheEntry entry;
+        entry.filename = filename;
+        entry.size = dir_entry.file_size(ec);
+        if (ec) {
+            continue;
+        }
+        try {
+            auto index = vpackfile_parse_directory(dir_entry.path().string());
+            for (const auto& file_info : index.file_infos) {
+                std::string_view name{file_info.name, strnlen(file_info.name, std::size(file_info.name))};
+                if (string_ends_with_ignore_case(name, ".rfl")) {
+                    entry.level_filenames.emplace_back(name);
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            // Keep the entry anyway so the file is removed by eviction
+            xlog::warn("Cannot parse cached packfile {}: {}", filename, e.what());
+        }
+        xlog::info("Adding packfile {} missing from level cache manifest", filename);
+        entries_.push_back(std::move(entry));
+    }
+}
+
+bool LevelCacheManifest::save() const
+{
+    auto manifest_path = get_manifest_path();
+    auto temp_path = manifest_path + ".tmp";
+    std::ofstream file{temp_path, std::ios_base::out | std::ios_base::trunc};
+    for (const auto& entry : entries_) {
+        file << entry.filename << '\t' << entry.size << '\t' << entry.download_size << '\t' << entry.last_used;
+        for (const auto& level_filename : entry.level_filenames) {
+            file << '\t' << level_filename;
+        }
+        file << '\n';
+    }
+    file.close();
+    std::error_code ec;
+    if (!file) {
+        xlog::error("Failed to save level cache manifest");
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+    std::filesystem::rename(temp_path, manifest_path, ec);
+    if (ec) {
+        xlog::error("Failed to replace level cache manifest: {}", ec.message());
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+LevelCacheEntry* LevelCacheManifest::find_level(std::string_view level_filename)
+{
+    for (auto& entry : entries_) {
+        for (const auto& entry_level_filename : entry.level_filenames) {
+            if (string_equals_ignore_case(entry_level_filename, level_filename)) {
+                return &entry;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void LevelCacheManifest::add(LevelCacheEntry entry)
+{
+    // Packfile may already be in the cache if it has been downloaded again for a level with a different name
+    remove(entry.filename);
+    entries_.push_back(std::move(entry));
+}
+
+void LevelCacheManifest::remove(const std::string& filename)
+{
+    std::erase_if(entries_, [&](const auto& entry) { return entry.filename == filename; });
+}
+
+void LevelCacheManifest::record_hit(LevelCacheEntry& entry, std::int64_t now)
+{
+    entry.last_used = now;
+    ++num_hits_;
+    bytes_saved_ += entry.download_size;
+}
+
+void LevelCacheManifest::record_miss()
+{
+    ++num_misses_;
+}
+
+void LevelCacheManifest::evict(std::uint64_t max_size, const std::unordered_set<std::string>& in_use_filenames)
+{
+    std::uint64_t total_size = get_total_size();
+    if (total_size <= max_size) {
+        return;
+    }
+    std::sort(entries_.begin(), entries_.end(), [](const auto& a, const auto& b) {
+        return a.last_used < b.last_used;
+    });
+    std::vector<LevelCacheEntry> kept_entries;
+    for (auto& entry : entries_) {
+        if (total_size > max_size && !in_use_filenames.contains(entry.filename)) {
+            xlog::info("Removing least recently used packfile {} from level cache", entry.filename);
+            std::error_code ec;
+            if (std::filesystem::remove(get_packfile_path(entry.filename), ec) || !ec) {
+                total_size -= entry.size;
+                continue;
+            }
+            xlog::warn("Failed to remove cached packfile {}", entry.filename);
+        }
+        kept_entries.push_back(std::move(entry));
+    }
+    entries_ = std::move(kept_entries);
+}
+
+std::uint64_t LevelCacheManifest::get_total_size() const
+{
+    std::uint64_t total_size = 0;
+    for (const auto& entry : entries_) {
+        total_size += entry.size;
+    }
+    return total_size;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+struct LevelCacheEntry
+{
+    // name of the packfile in the cache directory (content hash)
+    std::string filename;
+    std::uint64_t size = 0;
+    // size of the downloaded archive attributed to this packfile
+    std::uint64_t download_size = 0;
+    std::int64_t last_used = 0;
+    std::vector<std::string> level_filenames;
+};
+
+// Returns true if the name has the form used for packfiles stored in the cache (content hash)
+bool is_level_cache_packfile_name(std::string_view filename);
+
+// List of packfiles stored in the level cache directory (manifest.txt) with usage statistics and LRU eviction
+class LevelCacheManifest
+{
+public:
+    explicit LevelCacheManifest(std::string dir) : dir_{std::move(dir)} {}
+
+    // Reads the manifest. Packfiles found in the directory but missing from the manifest (e.g. the game crashed
+    // before saving it) are added as least recently used so they can be found and evicted.
+    void load();
+    // Writes to a temporary file and replaces the manifest so it is never left half-written
+    bool save() const;
+    LevelCacheEntry* find_level(std::string_view level_filename);
+    // Replaces an entry with the same filename
+    void add(LevelCacheEntry entry);
+    void remove(const std::string& filename);
+    void record_hit(LevelCacheEntry& entry, std::int64_t now);
+    void record_miss();
+    // Removes least recently used packfiles until total size is not greater than max_size. Packfiles in
+    // in_use_filenames are never removed.
+    void evict(std::uint64_t max_size, const std::unordered_set<std::string>& in_use_filenames);
+
+    [[nodiscard]] std::string get_packfile_path(const std::string& filename) const;
+    [[nodiscard]] std::uint64_t get_total_size() const;
+
+    [[nodiscard]] const std::vector<LevelCacheEntry>& entries() const
+    {
+        return entries_;
+    }
+
+    [[nodiscard]] unsigned num_hits() const
+    {
+        return num_hits_;
+    }
+
+    [[nodiscard]] unsigned num_misses() const
+    {
+        return num_misses_;
+    }
+
+    [[nodiscard]] std::uint64_t bytes_saved() const
+    {
+        return bytes_saved_;
+    }
+
+private:
+    std::string dir_;
+    std::vector<LevelCacheEntry> entries_;
+    unsigned num_hits_ = 0;
+    unsigned num_misses_ = 0;
+    std::uint64_t bytes_saved_ = 0;
+
+    [[nodiscard]] std::string get_manifest_path() const;
+    void adopt_unlisted_packfiles();
+};
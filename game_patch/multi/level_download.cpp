@@ -3,8 +3,16 @@
 #include <fstream>
 #include <format>
 #include <windows.h>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_set>
 #include <unrar/dll.hpp>
 #include <unzip.h>
+#include <vpp/ArchiveView.h>
+#include <vpp/MappedFile.h>
 #include <xlog/xlog.h>
 #include <patch_common/CodeInjection.h>
 #include <patch_common/AsmWriter.h>
@@ -24,16 +32,98 @@
 #include "../rf/gameseq.h"
 #include "../rf/misc.h"
 #include "../misc/misc.h"
+#include "../misc/vpackfile.h"
+#include "../misc/level_prefetch.h"
+#include "../main/main.h"
 #include "../os/console.h"
 #include "../hud/hud.h"
 #include "multi.h"
 #include "faction_files.h"
+#include "zip_stream_extractor.h"
+#include "level_cache.h"
 
 static bool is_vpp_filename(const char* filename)
 {
     return string_ends_with_ignore_case(filename, ".vpp");
 }
 
+// Size of buffers used for writing extracted files (minizip decompresses directly into them)
+constexpr std::size_t unzip_buf_size = 1024 * 1024;
+
+struct ZipEntry
+{
+    std::string name;
+    // sanitized name of the extracted file (see get_archive_entry_output_name)
+    std::string output_name;
+    unz_file_pos pos;
+    unsigned long uncompressed_size;
+};
+
+// Writes the current file of the archive to disk. Output file is preallocated so it is not extended by every write.
+static bool unzip_current_file(unzFile archive, const std::string& output_path, unsigned long size, char* buf)
+{
+    HANDLE file = CreateFileA(output_path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        xlog::error("Cannot open file: {}", output_path);
+        return false;
+    }
+    LARGE_INTEGER file_pos;
+    file_pos.QuadPart = size;
+    if (SetFilePointerEx(file, file_pos, nullptr, FILE_BEGIN)) {
+        SetEndOfFile(file);
+    }
+    file_pos.QuadPart = 0;
+    SetFilePointerEx(file, file_pos, nullptr, FILE_BEGIN);
+
+    bool success = true;
+    int code;
+    while ((code = unzReadCurrentFile(archive, buf, unzip_buf_size)) > 0) {
+        DWORD written;
+        if (!WriteFile(file, buf, code, &written, nullptr) || written != static_cast<DWORD>(code)) {
+            xlog::error("Cannot write file: {}", output_path);
+            success = false;
+            break;
+        }
+    }
+    if (code < 0) {
+        xlog::error("unzReadCurrentFile failed - error {}, file {}", code, output_path);
+        success = false;
+    }
+    // Size from the zip header may be wrong
+    SetEndOfFile(file);
+    CloseHandle(file);
+    return success;
+}
+
+static bool unzip_entry(unzFile archive, const ZipEntry& entry, const char* output_dir, char* buf)
+{
+    xlog::trace("Unpacking {}", entry.name);
+    unz_file_pos pos = entry.pos;
+    int code = unzGoToFilePos(archive, &pos);
+    if (code != UNZ_OK) {
+        xlog::error("unzGoToFilePos failed - error {}, file {}", code, entry.name);
+        return false;
+    }
+    code = unzOpenCurrentFile(archive);
+    if (code != UNZ_OK) {
+        xlog::error("unzOpenCurrentFile failed - error {}, file {}", code, entry.name);
+        return false;
+    }
+    auto output_path = std::format("{}\\{}", output_dir, entry.output_name);
+    bool success = unzip_current_file(archive, output_path, entry.uncompressed_size, buf);
+    // Note: CRC is checked when closing the file
+    code = unzCloseCurrentFile(archive);
+    if (code != UNZ_OK) {
+        xlog::error("unzCloseCurrentFile failed - error {}, file {}", code, entry.name);
+        success = false;
+    }
+    if (!success) {
+        DeleteFileA(output_path.c_str());
+    }
+    return success;
+}
+
 static std::vector<std::string> unzip(const char* path, const char* output_dir,
     std::function<bool(const char*)> filename_filter)
 {
@@ -49,11 +139,12 @@ static std::vector<std::string> unzip(const char* path, const char* output_dir,
     int code = unzGetGlobalInfo(archive, &global_info);
     if (code != UNZ_OK) {
         xlog::error("unzGetGlobalInfo failed - error {}, path {}", code, path);
+        unzClose(archive);
         throw std::runtime_error{"cannot open zip file"};
     }
 
-    std::vector<std::string> extracted_files;
-    char buf[4096];
+    std::vector<ZipEntry> entries;
+    std::unordered_set<std::string> output_names;
     char file_name[MAX_PATH];
     unz_file_info file_info;
     for (unsigned long i = 0; i < global_info.number_entry; i++) {
@@ -63,32 +154,22 @@ static std::vector<std::string> unzip(const char* path, const char* output_dir,
             break;
         }
 
-        if (filename_filter(file_name)) {
-            xlog::trace("Unpacking {}", file_name);
-            auto output_path = std::format("{}\\{}", output_dir, file_name);
-            std::ofstream file(output_path, std::ios_base::out | std::ios_base::binary);
-            if (!file) {
-                xlog::error("Cannot open file: {}", output_path);
-                break;
-            }
-
-            code = unzOpenCurrentFile(archive);
-            if (code != UNZ_OK) {
-                xlog::error("unzOpenCurrentFile failed - error {}, path {}", code, path);
-                break;
+        // Do not allow writing outside of the output directory
+        auto output_name = get_archive_entry_output_name(file_name);
+        if (output_name.empty()) {
+            xlog::warn("Skipping zip entry with unsafe name: {}", file_name);
+        }
+        else if (filename_filter(output_name.c_str())) {
+            // Entries from different directories can have the same output name - they must not be extracted by
+            // multiple threads into one file
+            if (!output_names.insert(string_to_lower(output_name)).second) {
+                xlog::warn("Skipping zip entry with duplicated name: {}", file_name);
             }
-
-            while ((code = unzReadCurrentFile(archive, buf, sizeof(buf))) > 0) file.write(buf, code);
-
-            if (code < 0) {
-                xlog::error("unzReadCurrentFile failed - error {}, path {}", code, path);
-                break;
+            else {
+                ZipEntry& entry = entries.emplace_back(
+                    ZipEntry{file_name, std::move(output_name), {}, file_info.uncompressed_size});
+                unzGetFilePos(archive, &entry.pos);
             }
-
-            file.close();
-            unzCloseCurrentFile(archive);
-
-            extracted_files.emplace_back(file_name);
         }
 
         if (i + 1 < global_info.number_entry) {
@@ -99,12 +180,56 @@ static std::vector<std::string> unzip(const char* path, const char* output_dir,
             }
         }
     }
-
     unzClose(archive);
-    xlog::debug("Unzipped");
+
+    // Every entry is compressed independently so entries are extracted in parallel, each thread using its own
+    // archive handle because minizip handles cannot be shared between threads
+    auto num_threads = static_cast<unsigned>(
+        std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), entries.size()));
+    std::vector<char> entry_extracted(entries.size(), false);
+    std::atomic<std::size_t> next_entry{0};
+    auto worker = [&]() {
+        unzFile thread_archive = unzOpen(path);
+        if (!thread_archive) {
+            xlog::error("unzOpen failed: {}", path);
+            return;
+        }
+        auto buf = std::make_unique<char[]>(unzip_buf_size);
+        std::size_t entry_idx;
+        while ((entry_idx = next_entry++) < entries.size()) {
+            entry_extracted[entry_idx] = unzip_entry(thread_archive, entries[entry_idx], output_dir, buf.get());
+        }
+        unzClose(thread_archive);
+    };
+    std::vector<std::future<void>> futures;
+    for (unsigned i = 1; i < num_threads; ++i) {
+        futures.push_back(std::async(std::launch::async, worker));
+    }
+    worker();
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    std::vector<std::string> extracted_files;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (entry_extracted[i]) {
+            extracted_files.push_back(std::move(entries[i].output_name));
+        }
+    }
+    xlog::debug("Unzipped {} files using {} threads", extracted_files.size(), num_threads);
     return extracted_files;
 }
 
+static std::wstring ansi_to_wide(const std::string& str)
+{
+    int len = MultiByteToWideChar(CP_ACP, 0, str.c_str(), -1, nullptr, 0);
+    std::wstring result(len > 0 ? len : 1, L'\0');
+    if (len > 0) {
+        MultiByteToWideChar(CP_ACP, 0, str.c_str(), -1, result.data(), len);
+    }
+    return result;
+}
+
 static std::vector<std::string> unrar(const char* path, const char* output_dir,
     std::function<bool(const char*)> filename_filter)
 {
@@ -137,11 +262,15 @@ static std::vector<std::string> unrar(const char* path, const char* output_dir,
             break;
         }
 
-        if (filename_filter(header_data.FileName)) {
+        // Do not let unrar build the output path from the entry name - it could point outside of the output
+        // directory. Entry is extracted to an explicit destination file instead.
+        auto output_name = get_archive_entry_output_name(header_data.FileName);
+        if (!output_name.empty() && filename_filter(output_name.c_str())) {
             xlog::trace("Unpacking {}", header_data.FileName);
-            code = RARProcessFile(archive_handle, RAR_EXTRACT, const_cast<char*>(output_dir), nullptr);
+            auto dest_name = ansi_to_wide(std::format("{}\\{}", output_dir, output_name));
+            code = RARProcessFileW(archive_handle, RAR_EXTRACT, nullptr, dest_name.data());
             if (code == 0) {
-                extracted_files.emplace_back(header_data.FileName);
+                extracted_files.push_back(std::move(output_name));
             }
         }
         else {
@@ -160,6 +289,58 @@ static std::vector<std::string> unrar(const char* path, const char* output_dir,
     return extracted_files;
 }
 
+// Collects the beginning of a packfile that is being extracted until its directory can be parsed
+class VppDirectoryCollector
+{
+    std::vector<std::byte> buf_;
+    std::optional<VPackfileIndexCache::Index> index_;
+    bool done_ = false;
+
+public:
+    void feed(std::size_t offset, const char* data, std::size_t len)
+    {
+        if (done_ || offset != buf_.size()) {
+            return;
+        }
+        auto bytes = reinterpret_cast<const std::byte*>(data);
+        buf_.insert(buf_.end(), bytes, bytes + len);
+        if (buf_.size() < vpp::block_size) {
+            return;
+        }
+        auto& hdr = *reinterpret_cast<const vpp::Header*>(buf_.data());
+        // Limit memory usage in case of a corrupted header
+        if (hdr.num_files > 0x100000) {
+            done_ = true;
+            return;
+        }
+        if (buf_.size() < vpp::block_offset(vpp::first_data_block(hdr.num_files))) {
+            return;
+        }
+        done_ = true;
+        try {
+            vpp::ArchiveView archive{buf_};
+            const vpp::FileInfo* file_infos = archive.file_infos();
+            index_ = {hdr.total_size, {file_infos, file_infos + archive.num_files()}};
+        }
+        catch (const std::exception& e) {
+            xlog::warn("Failed to parse downloaded packfile directory: {}", e.what());
+        }
+        buf_ = {};
+    }
+
+    std::optional<VPackfileIndexCache::Index>& get_index()
+    {
+        return index_;
+    }
+};
+
+struct DownloadedPackfile
+{
+    std::string filename;
+    // directory parsed during extraction - the packfile does not have to be parsed again when it is loaded
+    std::optional<VPackfileIndexCache::Index> index;
+};
+
 enum class LevelDownloadState
 {
     fetching_info,
@@ -169,6 +350,9 @@ enum class LevelDownloadState
     finished,
 };
 
+// Bigger archives are written to a temporary file during download instead of being kept in memory
+constexpr std::size_t max_archive_buf_size = 64 * 1024 * 1024;
+
 class LevelDownloadWorker
 {
 public:
@@ -178,26 +362,104 @@ public:
         std::atomic<unsigned> bytes_received{0};
         std::atomic<float> bytes_per_sec{0};
         std::atomic<bool> abort_flag{false};
+        // download speed limit used when downloading in background (0 means no limit)
+        std::atomic<unsigned> max_bytes_per_sec{0};
         std::optional<FactionFilesClient::LevelInfo> level_info;
     };
 
-    LevelDownloadWorker(std::string level_filename, std::shared_ptr<SharedData> shared_data) :
+    // If level_server_url is not empty it is used when the level cannot be downloaded from FactionFiles
+    LevelDownloadWorker(std::string level_filename, unsigned num_connections, std::string output_dir, bool use_cache,
+        std::string level_server_url, std::shared_ptr<SharedData> shared_data) :
         level_filename_{std::move(level_filename)},
+        num_connections_{num_connections},
+        output_dir_{std::move(output_dir)},
+        use_cache_{use_cache},
+        level_server_url_{std::move(level_server_url)},
         shared_data_{std::move(shared_data)}
     {}
 
-    std::vector<std::string> operator()();
+    std::vector<DownloadedPackfile> operator()();
 
 private:
     std::string level_filename_;
+    unsigned num_connections_;
+    std::string output_dir_;
+    bool use_cache_;
+    std::string level_server_url_;
+    // base URL of the service the level is downloaded from (empty for FactionFiles)
+    std::string source_url_;
     std::shared_ptr<SharedData> shared_data_;
 
-    void download_archive(int ticket_id, const char* temp_filename);
-    static std::vector<std::string> extract_archive(const char* temp_filename);
+    std::optional<FactionFilesClient::LevelInfo> find_level();
+    std::vector<DownloadedPackfile> download_archive(int ticket_id, const char* temp_filename);
+    std::vector<std::string> extract_archive(const char* temp_filename);
+    void prepare_packfile(DownloadedPackfile& packfile);
 };
 
-void LevelDownloadWorker::download_archive(int ticket_id, const char* temp_filename)
+// Zip archives are extracted while they are being downloaded. Archive is kept in memory until it is fully extracted
+// and it is written to a temporary file only if it has to be extracted the old way (e.g. it is a RAR archive), so in
+// the common case downloaded data is written to disk only once, as extracted packfiles.
+// Returns an empty vector if the archive has not been extracted during the download.
+std::vector<DownloadedPackfile> LevelDownloadWorker::download_archive(int ticket_id, const char* temp_filename)
 {
+    std::vector<char> archive_buf;
+    std::size_t expected_size = shared_data_->level_info.value().size_in_bytes;
+    if (expected_size <= max_archive_buf_size) {
+        archive_buf.reserve(expected_size);
+    }
+    std::ofstream temp_file;
+    // Called when the archive cannot be extracted during download or when it is too big to be kept in memory
+    auto spill_to_temp_file = [&]() {
+        if (temp_file.is_open()) {
+            return;
+        }
+        temp_file.open(temp_filename, std::ios_base::out | std::ios_base::binary);
+        if (!temp_file) {
+            xlog::error("Cannot open file: {}", temp_filename);
+            throw std::runtime_error("cannot open file");
+        }
+        temp_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        temp_file.write(archive_buf.data(), static_cast<std::streamsize>(archive_buf.size()));
+        archive_buf = {};
+    };
+
+    std::map<std::string, VppDirectoryCollector, std::less<>> dir_collectors;
+    auto data_observer = [&](std::string_view name, std::size_t offset, const char* data, std::size_t len) {
+        auto it = dir_collectors.find(name);
+        if (it == dir_collectors.end()) {
+            it = dir_collectors.emplace(name, VppDirectoryCollector{}).first;
+        }
+        it->second.feed(offset, data, len);
+    };
+    auto extractor = std::make_unique<ZipStreamExtractor>(output_dir_, is_vpp_filename, data_observer);
+
+    auto data_consumer = [&](const char* data, std::size_t len) {
+        // Aborted operation can be replaced by a new one writing the same files - nothing is written after abort.
+        // The download stops at the next progress callback.
+        if (shared_data_->abort_flag) {
+            return;
+        }
+        if (temp_file.is_open()) {
+            temp_file.write(data, static_cast<std::streamsize>(len));
+        }
+        else {
+            archive_buf.insert(archive_buf.end(), data, data + len);
+            if (archive_buf.size() > max_archive_buf_size) {
+                spill_to_temp_file();
+            }
+        }
+        if (extractor) {
+            try {
+                extractor->feed(data, len);
+            }
+            catch (const std::exception& e) {
+                xlog::info("Archive cannot be extracted during download ({}), it will be extracted later", e.what());
+                extractor.reset();
+                spill_to_temp_file();
+            }
+        }
+    };
+
     auto callback = [&](unsigned bytes_received, std::chrono::milliseconds duration) {
         if (shared_data_->abort_flag) {
             return false;
@@ -207,21 +469,42 @@ void LevelDownloadWorker::download_archive(int ticket_id, const char* temp_filen
         if (duration_ms > 0) {
             shared_data_->bytes_per_sec = bytes_received * 1000.0f / duration_ms;
         }
+        // Throttle by delaying reads - receive buffers fill up and the server slows down
+        unsigned max_bytes_per_sec = shared_data_->max_bytes_per_sec;
+        if (max_bytes_per_sec > 0) {
+            auto expected_duration_ms = static_cast<long long>(bytes_received) * 1000 / max_bytes_per_sec;
+            if (expected_duration_ms > duration_ms) {
+                // Sleep in short steps so abort and removal of the limit are handled quickly
+                auto delay_ms = std::min<long long>(expected_duration_ms - duration_ms, 100);
+                std::this_thread::sleep_for(std::chrono::milliseconds{delay_ms});
+            }
+        }
         return true;
     };
-    FactionFilesClient ff_client;
-    ff_client.download_map(temp_filename, ticket_id, callback);
+    FactionFilesClient ff_client{source_url_};
+    // Game server limits bandwidth and connections per address so parallel connections would not make it faster
+    unsigned num_connections = source_url_.empty() ? num_connections_ : 1;
+    ff_client.download_map(ticket_id, num_connections, data_consumer, callback);
+
+    if (!extractor || !extractor->finished()) {
+        spill_to_temp_file();
+        return {};
+    }
+    std::vector<DownloadedPackfile> packfiles;
+    for (const auto& filename : extractor->get_extracted_files()) {
+        packfiles.push_back({filename, std::move(dir_collectors[filename].get_index())});
+    }
+    return packfiles;
 }
 
 std::vector<std::string> LevelDownloadWorker::extract_archive(const char* temp_filename)
 {
-    auto output_dir = std::format("{}user_maps\\multi", rf::root_path);
     std::vector<std::string> packfiles;
     try {
-        packfiles = unzip(temp_filename, output_dir.c_str(), is_vpp_filename);
+        packfiles = unzip(temp_filename, output_dir_.c_str(), is_vpp_filename);
     }
     catch (const std::exception&) {
-        packfiles = unrar(temp_filename, output_dir.c_str(), is_vpp_filename);
+        packfiles = unrar(temp_filename, output_dir_.c_str(), is_vpp_filename);
     }
 
     if (packfiles.empty()) {
@@ -230,12 +513,56 @@ std::vector<std::string> LevelDownloadWorker::extract_archive(const char* temp_f
     return packfiles;
 }
 
-std::vector<std::string> LevelDownloadWorker::operator()()
+// Parses directory of a packfile that has not been extracted during the download and moves the packfile to its
+// final location in the level cache
+void LevelDownloadWorker::prepare_packfile(DownloadedPackfile& packfile)
+{
+    if (!packfile.index) {
+        try {
+            vpp::MappedFile mapped_file{std::format("{}\\{}", output_dir_, packfile.filename).c_str()};
+            vpp::ArchiveView archive{mapped_file.bytes()};
+            const vpp::FileInfo* file_infos = archive.file_infos();
+            packfile.index = {archive.header().total_size, {file_infos, file_infos + archive.num_files()}};
+        }
+        catch (const std::exception& e) {
+            xlog::warn("Failed to parse downloaded packfile {}: {}", packfile.filename, e.what());
+        }
+    }
+    if (use_cache_) {
+        packfile.filename = level_cache_store_packfile(packfile.filename);
+    }
+}
+
+// Looks for the level on FactionFiles first and then on the game server (if it sends levels)
+std::optional<FactionFilesClient::LevelInfo> LevelDownloadWorker::find_level()
+{
+    std::optional<FactionFilesClient::LevelInfo> level_info;
+    try {
+        FactionFilesClient ff_client;
+        level_info = ff_client.find_map(level_filename_.c_str());
+    }
+    catch (const std::exception& e) {
+        if (level_server_url_.empty()) {
+            throw;
+        }
+        xlog::warn("Cannot fetch level info from FactionFiles: {}", e.what());
+    }
+    if (!level_info && !level_server_url_.empty()) {
+        xlog::info("Fetching level info from the game server: {}", level_server_url_);
+        FactionFilesClient server_client{level_server_url_};
+        level_info = server_client.find_map(level_filename_.c_str());
+        if (level_info) {
+            source_url_ = level_server_url_;
+        }
+    }
+    return level_info;
+}
+
+std::vector<DownloadedPackfile> LevelDownloadWorker::operator()()
 {
     xlog::trace("LevelDownloadWorker started");
     shared_data_->state = LevelDownloadState::fetching_info;
-    FactionFilesClient ff_client;
-    shared_data_->level_info = ff_client.find_map(level_filename_.c_str());
+    shared_data_->level_info = find_level();
     if (!shared_data_->level_info) {
         xlog::warn("Level not found: {}", level_filename_);
         shared_data_->state = LevelDownloadState::not_found;
@@ -246,11 +573,29 @@ std::vector<std::string> LevelDownloadWorker::operator()()
     auto temp_filename = get_temp_path_name("DF_Level_");
     try {
         shared_data_->state = LevelDownloadState::fetching_data;
-        download_archive(shared_data_->level_info.value().ticket_id, temp_filename.c_str());
+        std::vector<DownloadedPackfile> packfiles =
+            download_archive(shared_data_->level_info.value().ticket_id, temp_filename.c_str());
+        auto download_end = std::chrono::steady_clock::now();
 
-        shared_data_->state = LevelDownloadState::extracting;
-        std::vector<std::string> packfiles = extract_archive(temp_filename.c_str());
+        if (shared_data_->abort_flag) {
+            throw std::runtime_error("download aborted");
+        }
+        if (packfiles.empty()) {
+            shared_data_->state = LevelDownloadState::extracting;
+            for (auto& filename : extract_archive(temp_filename.c_str())) {
+                packfiles.push_back({std::move(filename), {}});
+            }
+            auto extract_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - download_end).count();
+            xlog::info("Level archive extracted in {} ms after download", extract_time_ms);
+        }
+        else {
+            xlog::info("Level archive extracted during download");
+        }
         remove(temp_filename.c_str());
+        for (auto& packfile : packfiles) {
+            prepare_packfile(packfile);
+        }
 
         xlog::trace("LevelDownloadWorker finished");
         shared_data_->state = LevelDownloadState::finished;
@@ -262,6 +607,18 @@ std::vector<std::string> LevelDownloadWorker::operator()()
     }
 }
 
+// Returns base URL of the level transfer service of the server the client is connected to (or an empty string)
+static std::string get_level_server_url()
+{
+    const auto& server_info = get_df_server_info();
+    if (!rf::is_multi || rf::is_server || !server_info || !server_info.value().level_transfer_port) {
+        return {};
+    }
+    uint32_t ip_addr = rf::netgame.server_addr.ip_addr;
+    return std::format("http://{}.{}.{}.{}:{}", (ip_addr >> 24) & 0xFF, (ip_addr >> 16) & 0xFF,
+        (ip_addr >> 8) & 0xFF, ip_addr & 0xFF, server_info.value().level_transfer_port.value());
+}
+
 class LevelDownloadOperation
 {
 public:
@@ -274,15 +631,27 @@ public:
 
 private:
     std::shared_ptr<LevelDownloadWorker::SharedData> shared_data_;
-    std::future<std::vector<std::string>> future_;
+    std::future<std::vector<DownloadedPackfile>> future_;
     std::unique_ptr<Listener> listener_;
+    std::string level_filename_;
+    bool use_cache_;
+    bool background_;
 
 public:
-    LevelDownloadOperation(std::string level_filename, std::unique_ptr<Listener>&& listener) :
-        listener_(std::move(listener))
+    // If background_bytes_per_sec is not 0 level is downloaded into the level cache using a single connection with
+    // limited speed and it is not loaded after download
+    LevelDownloadOperation(std::string level_filename, bool use_cache, std::unique_ptr<Listener>&& listener,
+        unsigned background_bytes_per_sec = 0) :
+        listener_(std::move(listener)), level_filename_(std::move(level_filename)),
+        use_cache_(use_cache || background_bytes_per_sec > 0), background_(background_bytes_per_sec > 0)
     {
         shared_data_ = std::make_shared<LevelDownloadWorker::SharedData>();
-        future_ = std::async(std::launch::async, LevelDownloadWorker{std::move(level_filename), shared_data_});
+        shared_data_->max_bytes_per_sec = background_bytes_per_sec;
+        unsigned num_connections = background_ ? 1 : g_game_config.level_download_connections.value();
+        auto output_dir = use_cache_ ? level_cache_get_path() : std::format("{}user_maps\\multi", rf::root_path);
+        future_ = std::async(std::launch::async,
+            LevelDownloadWorker{level_filename_, num_connections, std::move(output_dir), use_cache_,
+                get_level_server_url(), shared_data_});
     }
 
     ~LevelDownloadOperation()
@@ -290,11 +659,37 @@ public:
         shared_data_->abort_flag = true;
     }
 
+    // Aborts the operation without waiting for the worker. Destroying the returned future blocks until the worker
+    // finishes.
+    std::future<std::vector<DownloadedPackfile>> abandon()
+    {
+        shared_data_->abort_flag = true;
+        return std::move(future_);
+    }
+
     [[nodiscard]] LevelDownloadState get_state() const
     {
         return shared_data_->state;
     }
 
+    [[nodiscard]] const std::string& get_level_filename() const
+    {
+        return level_filename_;
+    }
+
+    [[nodiscard]] bool is_background() const
+    {
+        return background_;
+    }
+
+    // Continues a background download at full speed when the level is needed right now
+    void promote(std::unique_ptr<Listener>&& listener)
+    {
+        background_ = false;
+        shared_data_->max_bytes_per_sec = 0;
+        listener_ = std::move(listener);
+    }
+
     [[nodiscard]] const FactionFilesClient::LevelInfo& get_level_info() const
     {
         // check state before calling this method
@@ -327,7 +722,32 @@ public:
     }
 
 private:
-    std::vector<std::string> get_pending_packfiles()
+    void add_packfiles_to_cache(const std::vector<DownloadedPackfile>& packfiles, bool mounted)
+    {
+        // Split size of the downloaded archive between packfiles so the cache can tell how much data was not
+        // downloaded again when a cached level is loaded
+        std::uint64_t total_size = 0;
+        for (const auto& packfile : packfiles) {
+            total_size += packfile.index ? packfile.index->total_size : 0;
+        }
+        for (const auto& packfile : packfiles) {
+            std::vector<std::string> level_filenames;
+            std::uint64_t download_size = 0;
+            if (packfile.index) {
+                for (const auto& file_info : packfile.index->file_infos) {
+                    std::string_view name{file_info.name, strnlen(file_info.name, sizeof(file_info.name))};
+                    if (string_ends_with_ignore_case(name, ".rfl")) {
+                        level_filenames.emplace_back(name);
+                    }
+                }
+                download_size = static_cast<std::uint64_t>(get_bytes_received()) * packfile.index->total_size /
+                    std::max<std::uint64_t>(total_size, 1);
+            }
+            level_cache_add(packfile.filename, download_size, std::move(level_filenames), mounted);
+        }
+    }
+
+    std::vector<DownloadedPackfile> get_pending_packfiles()
     {
         try {
             return future_.get();
@@ -338,15 +758,29 @@ private:
         }
     }
 
-    static void load_packfiles(const std::vector<std::string>& packfiles)
+    void load_packfiles(std::vector<DownloadedPackfile>& packfiles)
     {
-        rf::vpackfile_set_loading_user_maps(true);
-        for (const auto& filename : packfiles) {
-            if (!rf::vpackfile_add(filename.c_str(), "user_maps\\multi\\")) {
-                xlog::error("vpackfile_add failed - {}", filename);
+        auto start = std::chrono::steady_clock::now();
+        const char* dir = use_cache_ ? level_cache_dir : "user_maps\\multi\\";
+        std::vector<std::string> filenames;
+        if (use_cache_) {
+            add_packfiles_to_cache(packfiles, true);
+        }
+        for (auto& packfile : packfiles) {
+            if (packfile.index) {
+                vpackfile_add_to_index_cache(packfile.filename.c_str(), dir, std::move(packfile.index.value()));
             }
+            filenames.push_back(packfile.filename);
+        }
+        rf::vpackfile_set_loading_user_maps(true);
+        unsigned num_loaded = vpackfile_add_multiple(filenames, dir);
+        if (num_loaded != filenames.size()) {
+            xlog::error("Failed to load {} downloaded packfiles", filenames.size() - num_loaded);
         }
         rf::vpackfile_set_loading_user_maps(false);
+        auto load_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        xlog::info("Downloaded packfiles loaded in {} ms", load_time_ms);
     }
 
 public:
@@ -359,12 +793,24 @@ public:
             return false;
         }
         xlog::trace("Background worker finished");
-        std::vector<std::string> packfiles = get_pending_packfiles();
+        std::vector<DownloadedPackfile> packfiles = get_pending_packfiles();
         if (packfiles.empty()) {
             if (listener_) {
                 listener_->on_finish(*this, false);
             }
         }
+        else if (background_) {
+            // Packfiles are loaded from the cache when the level is needed. Loading them now could change files used
+            // by the current level.
+            xlog::info("Level {} downloaded in background", level_filename_);
+            add_packfiles_to_cache(packfiles, false);
+            for (auto& packfile : packfiles) {
+                if (packfile.index) {
+                    vpackfile_add_to_index_cache(packfile.filename.c_str(), level_cache_dir,
+                        std::move(packfile.index.value()));
+                }
+            }
+        }
         else {
             xlog::trace("Loading packfiles");
             load_packfiles(packfiles);
@@ -379,20 +825,57 @@ public:
 class LevelDownloadManager
 {
     std::optional<LevelDownloadOperation> operation_;
+    // Workers of aborted operations that have not finished yet. Waiting for them on the main thread could freeze
+    // the game until socket timeouts if a worker is blocked in connect or receive.
+    std::vector<std::future<std::vector<DownloadedPackfile>>> aborted_workers_;
+
+    void abandon_operation()
+    {
+        if (operation_) {
+            auto future = operation_.value().abandon();
+            if (future.valid()) {
+                aborted_workers_.push_back(std::move(future));
+            }
+            operation_.reset();
+        }
+    }
 
 public:
     void abort()
     {
         if (operation_) {
             xlog::info("Aborting level download");
-            operation_.reset();
+            abandon_operation();
         }
     }
 
-    LevelDownloadOperation& start(std::string level_filename, std::unique_ptr<LevelDownloadOperation::Listener>&& listener)
+    LevelDownloadOperation& start(std::string level_filename, bool use_cache,
+        std::unique_ptr<LevelDownloadOperation::Listener>&& listener)
     {
+        if (use_cache && operation_ && operation_.value().is_background() &&
+            string_equals_ignore_case(operation_.value().get_level_filename(), level_filename)) {
+            // Level is already being downloaded in background - continue at full speed
+            xlog::info("Continuing background level download: {}", level_filename);
+            operation_.value().promote(std::move(listener));
+            return operation_.value();
+        }
         xlog::info("Starting level download: {}", level_filename);
-        return operation_.emplace(std::move(level_filename), std::move(listener));
+        abandon_operation();
+        return operation_.emplace(std::move(level_filename), use_cache, std::move(listener));
+    }
+
+    void start_background(std::string level_filename)
+    {
+        xlog::info("Starting background level download: {}", level_filename);
+        abandon_operation();
+        operation_.emplace(std::move(level_filename), true, nullptr,
+            g_game_config.rotation_prefetch_rate * 1024);
+    }
+
+    // Called when leaving a game so levels are considered for prefetching again on the next server
+    void reset_rotation_prefetch()
+    {
+        prefetch_attempted_.clear();
     }
 
     [[nodiscard]] const std::optional<LevelDownloadOperation>& get_operation() const
@@ -402,7 +885,14 @@ public:
 
     void process()
     {
-        if (operation_ && operation_.value().process()) {
+        using namespace std::chrono_literals;
+        std::erase_if(aborted_workers_, [](const auto& future) {
+            return future.wait_for(0ms) == std::future_status::ready;
+        });
+        if (!operation_) {
+            maybe_start_rotation_prefetch();
+        }
+        else if (operation_.value().process()) {
             operation_.reset();
         }
     }
@@ -412,6 +902,33 @@ public:
         static LevelDownloadManager inst;
         return inst;
     }
+
+private:
+    // Downloads levels from the server rotation while playing so level changes do not need to wait for a download
+    void maybe_start_rotation_prefetch()
+    {
+        if (g_game_config.rotation_prefetch_rate == 0 || rf::is_server
+            || rf::gameseq_get_state() != rf::GS_GAMEPLAY) {
+            return;
+        }
+        const auto& server_info = get_df_server_info();
+        if (!server_info) {
+            return;
+        }
+        for (const auto& level_filename : server_info.value().level_rotation) {
+            // Every level is tried once per game session - it may be missing on FactionFiles
+            if (!prefetch_attempted_.insert(string_to_lower(level_filename)).second) {
+                continue;
+            }
+            rf::File file;
+            if (!file.find(level_filename.c_str()) && !level_cache_contains_level(level_filename.c_str())) {
+                start_background(level_filename);
+                return;
+            }
+        }
+    }
+
+    std::unordered_set<std::string> prefetch_attempted_;
 };
 
 class ConsoleReportingDownloadListener : public LevelDownloadOperation::Listener
@@ -612,12 +1129,14 @@ CallHook<void(rf::GameState, bool)> process_leave_limbo_packet_gameseq_set_next_
     0x0047C24F,
     [](rf::GameState state, bool force) {
         xlog::trace("Leave limbo - next level: {}", rf::level.next_level_filename);
-        if (!next_level_exists()) {
+        if (!next_level_exists() && !level_cache_mount_level(rf::level.next_level_filename)) {
             rf::gameseq_set_state(rf::GS_MULTI_LEVEL_DOWNLOAD, false);
-            LevelDownloadManager::instance().start(rf::level.next_level_filename,
+            LevelDownloadManager::instance().start(rf::level.next_level_filename, true,
                 std::make_unique<SetNewLevelStateDownloadListener>());
         }
         else {
+            // Level is loaded in the next frame so start reading its assets early
+            level_prefetch_start(rf::level.next_level_filename);
             process_leave_limbo_packet_gameseq_set_next_state_hook.call_target(state, force);
         }
     },
@@ -626,12 +1145,16 @@ CallHook<void(rf::GameState, bool)> process_leave_limbo_packet_gameseq_set_next_
 CallHook<void(rf::GameState, bool)> game_new_game_gameseq_set_next_state_hook{
     0x00436959,
     [](rf::GameState state, bool force) {
-        if (rf::is_multi && !rf::is_server && !next_level_exists()) {
+        if (rf::is_multi && !rf::is_server && !next_level_exists() &&
+            !level_cache_mount_level(rf::level.next_level_filename)) {
             rf::gameseq_set_state(rf::GS_MULTI_LEVEL_DOWNLOAD, false);
-            LevelDownloadManager::instance().start(rf::level.next_level_filename,
+            LevelDownloadManager::instance().start(rf::level.next_level_filename, true,
                 std::make_unique<SetNewLevelStateDownloadListener>());
         }
         else {
+            if (rf::is_multi && !rf::is_server) {
+                level_prefetch_start(rf::level.next_level_filename);
+            }
             game_new_game_gameseq_set_next_state_hook.call_target(state, force);
         }
     },
@@ -649,7 +1172,8 @@ static void do_download_level(std::string filename, bool force)
     if (filename.rfind('.') == std::string::npos) {
         filename += ".rfl";
     }
-    if (LevelDownloadManager::instance().get_operation()) {
+    const auto& operation_opt = LevelDownloadManager::instance().get_operation();
+    if (operation_opt && !operation_opt.value().is_background()) {
         xlog::error("Level download is already in progress!");
     }
     else {
@@ -657,7 +1181,7 @@ static void do_download_level(std::string filename, bool force)
             xlog::error("Level already exists on disk! Use download_level_force to download anyway.");
             return;
         }
-        LevelDownloadManager::instance().start(filename,
+        LevelDownloadManager::instance().start(filename, false,
             std::make_unique<ConsoleReportingDownloadListener>());
     }
 }
@@ -678,6 +1202,44 @@ ConsoleCommand2 download_level_force_cmd{
     },
 };
 
+ConsoleCommand2 download_connections_cmd{
+    "download_connections",
+    [](std::optional<unsigned> num_connections_opt) {
+        if (num_connections_opt) {
+            g_game_config.level_download_connections = num_connections_opt.value();
+            g_game_config.save();
+        }
+        rf::console::print("Level download connections: {}", g_game_config.level_download_connections.value());
+    },
+    "Sets/gets number of parallel connections used for downloading levels",
+    "download_connections [count]",
+};
+
+ConsoleCommand2 rotation_prefetch_cmd{
+    "rotation_prefetch",
+    [](std::optional<unsigned> rate_opt) {
+        if (rate_opt) {
+            g_game_config.rotation_prefetch_rate = rate_opt.value();
+            g_game_config.save();
+            if (rate_opt.value() == 0) {
+                const auto& operation_opt = LevelDownloadManager::instance().get_operation();
+                if (operation_opt && operation_opt.value().is_background()) {
+                    LevelDownloadManager::instance().abort();
+                }
+            }
+        }
+        if (g_game_config.rotation_prefetch_rate == 0) {
+            rf::console::print("Prefetching of levels from server rotation is disabled");
+        }
+        else {
+            rf::console::print("Levels from server rotation are prefetched at up to {} KB/s",
+                g_game_config.rotation_prefetch_rate.value());
+        }
+    },
+    "Sets/gets download speed limit for prefetching levels from server rotation (0 disables prefetching)",
+    "rotation_prefetch [rate_kbps]",
+};
+
 void level_download_do_patch()
 {
     join_failed_injection.install();
@@ -690,6 +1252,9 @@ void level_download_init()
 {
     download_level_cmd.register_cmd();
     download_level_force_cmd.register_cmd();
+    download_connections_cmd.register_cmd();
+    rotation_prefetch_cmd.register_cmd();
+    level_cache_init();
 }
 
 void multi_level_download_update()
@@ -700,4 +1265,5 @@ void multi_level_download_update()
 void multi_level_download_abort()
 {
     LevelDownloadManager::instance().abort();
+    LevelDownloadManager::instance().reset_rotation_prefetch();
 }
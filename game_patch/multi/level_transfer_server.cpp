@@ -0,0 +1,104 @@
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <xlog/xlog.h>
+#include <common/utils/string-utils.h>
+#include "../rf/multi.h"
+#include "../rf/level.h"
+#include "../rf/file/packfile.h"
+#include "../misc/vpackfile.h"
+#include "server_internal.h"
+#include "level_transfer_service.h"
+#include "level_transfer_server.h"
+
+class LevelTransferServer
+{
+    LevelTransferService service_;
+    std::string indexed_level_;
+
+    static LevelTransferService::Limits get_limits(const LevelTransferConfig& config)
+    {
+        LevelTransferService::Limits limits;
+        limits.max_client_rate = config.max_client_rate * 1024;
+        limits.max_total_rate = config.max_total_rate * 1024;
+        limits.max_connections = config.max_connections;
+        limits.max_client_connections = config.max_client_connections;
+        return limits;
+    }
+
+public:
+    LevelTransferServer(unsigned short port, const LevelTransferConfig& config) :
+        service_{port, get_limits(config)}
+    {}
+
+    bool start()
+    {
+        return service_.start();
+    }
+
+    [[nodiscard]] unsigned short get_port() const
+    {
+        return service_.get_port();
+    }
+
+    void update_levels()
+    {
+        std::string current_level = rf::level.filename.c_str();
+        if (string_equals_ignore_case(current_level, indexed_level_)) {
+            return;
+        }
+        std::map<std::string, std::string> level_packfiles;
+        auto add_level = [&](std::string level_filename) {
+            if (level_filename.find('.') == std::string::npos) {
+                level_filename += ".rfl";
+            }
+            // Only levels from user_maps are sent - stock levels are available on every client
+            const rf::VPackfileEntry* entry = vpackfile_lookup(level_filename.c_str());
+            if (entry && entry->parent && entry->parent->is_user_maps) {
+                level_packfiles.emplace(string_to_lower(level_filename), entry->parent->path);
+            }
+        };
+        for (int i = 0; i < rf::netgame.levels.size(); ++i) {
+            add_level(rf::netgame.levels[i].c_str());
+        }
+        add_level(current_level);
+        indexed_level_ = std::move(current_level);
+        service_.set_levels(std::move(level_packfiles));
+    }
+};
+
+static std::unique_ptr<LevelTransferServer> g_level_transfer_server;
+
+void level_transfer_server_start(unsigned short port)
+{
+    g_level_transfer_server = std::make_unique<LevelTransferServer>(port, server_get_df_config().level_transfer);
+    if (!g_level_transfer_server->start()) {
+        g_level_transfer_server.reset();
+        return;
+    }
+    g_level_transfer_server->update_levels();
+}
+
+void level_transfer_server_stop()
+{
+    if (g_level_transfer_server) {
+        xlog::info("Stopping level transfer server");
+        g_level_transfer_server.reset();
+    }
+}
+
+void level_transfer_server_do_frame()
+{
+    if (g_level_transfer_server) {
+        g_level_transfer_server->update_levels();
+    }
+}
+
+std::optional<unsigned short> level_transfer_server_get_port()
+{
+    if (g_level_transfer_server) {
+        return {g_level_transfer_server->get_port()};
+    }
+    return {};
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <optional>
+
+// Dedicated server can send levels from user_maps to joining clients. Levels are served on a TCP port with the same
+// number as the game (UDP) port using the same HTTP API as FactionFiles autodl service, so clients download them using
+// the same code (including resuming and extraction during download). Every packfile is served as a single-file zip
+// archive without compression.
+
+void level_transfer_server_start(unsigned short port);
+void level_transfer_server_stop();
+// Updates the list of levels that can be downloaded when the server changes the level
+void level_transfer_server_do_frame();
+// Returns the TCP port if the server is running
+std::optional<unsigned short> level_transfer_server_get_port();
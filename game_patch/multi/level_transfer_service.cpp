@@ -0,0 +1,587 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <zlib.h>
+#include <xlog/xlog.h>
+#include <common/utils/string-utils.h>
+#include "level_transfer_service.h"
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Requests with a bigger header block are rejected
+constexpr std::size_t max_request_size = 8 * 1024;
+constexpr std::size_t send_chunk_size = 16 * 1024;
+constexpr unsigned socket_timeout_ms = 10000;
+
+#ifdef _WIN32
+
+constexpr int send_flags = 0;
+
+static int get_socket_error()
+{
+    return WSAGetLastError();
+}
+
+static void set_socket_timeouts(SOCKET sock, unsigned timeout_ms)
+{
+    DWORD timeout = timeout_ms;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+#else
+
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SD_BOTH = SHUT_RDWR;
+// Broken connections must not raise SIGPIPE
+constexpr int send_flags = MSG_NOSIGNAL;
+
+static int closesocket(SOCKET sock)
+{
+    return close(sock);
+}
+
+static int get_socket_error()
+{
+    return errno;
+}
+
+static void set_socket_timeouts(SOCKET sock, unsigned timeout_ms)
+{
+    timeval timeout{};
+    timeout.tv_sec = static_cast<time_t>(timeout_ms / 1000);
+    timeout.tv_usec = static_cast<suseconds_t>((timeout_ms % 1000) * 1000);
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+#endif
+
+std::chrono::milliseconds TokenBucket::consume(std::size_t len)
+{
+    if (rate_ == 0) {
+        return {};
+    }
+    std::lock_guard lock{mutex_};
+    auto now = std::chrono::steady_clock::now();
+    double elapsed_sec = std::chrono::duration<double>(now - last_refill_).count();
+    last_refill_ = now;
+    tokens_ = std::min(tokens_ + elapsed_sec * rate_, static_cast<double>(rate_));
+    tokens_ -= static_cast<double>(len);
+    if (tokens_ >= 0) {
+        return {};
+    }
+    return std::chrono::milliseconds{static_cast<long long>(-tokens_ * 1000 / rate_)};
+}
+
+// Zip archive containing a single packfile without compression. Only zip headers are kept in memory, packfile
+// contents are read from disk when they are sent.
+struct ServedArchive
+{
+    std::string packfile_path;
+    std::uint32_t packfile_size = 0;
+    // modification time of the packfile when the archive was built
+    std::filesystem::file_time_type packfile_mtime;
+    // local file header
+    std::string header;
+    // central directory
+    std::string trailer;
+
+    [[nodiscard]] std::size_t size() const
+    {
+        return header.size() + packfile_size + trailer.size();
+    }
+};
+
+static void append_le(std::string& buf, std::uint32_t value, int num_bytes)
+{
+    for (int i = 0; i < num_bytes; ++i) {
+        buf += static_cast<char>((value >> (i * 8)) & 0xFF);
+    }
+}
+
+// Returns true if the packfile has not been changed since the archive was built
+static bool is_served_archive_up_to_date(const ServedArchive& archive)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(archive.packfile_path, ec);
+    if (ec || size != archive.packfile_size) {
+        return false;
+    }
+    auto mtime = std::filesystem::last_write_time(archive.packfile_path, ec);
+    return !ec && mtime == archive.packfile_mtime;
+}
+
+static std::shared_ptr<const ServedArchive> build_served_archive(const std::string& packfile_path)
+{
+    // Get modification time before reading so a change during reading is detected next time
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(packfile_path, ec);
+    std::ifstream file{packfile_path, std::ios_base::in | std::ios_base::binary};
+    if (ec || !file) {
+        throw std::runtime_error{"cannot open packfile"};
+    }
+    uLong crc = crc32(0, nullptr, 0);
+    std::uint64_t size = 0;
+    std::vector<char> buf(64 * 1024);
+    while (file) {
+        file.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        auto num_read = file.gcount();
+        if (num_read <= 0) {
+            break;
+        }
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(buf.data()), static_cast<uInt>(num_read));
+        size += static_cast<std::uint64_t>(num_read);
+    }
+    if (size > UINT32_MAX) {
+        throw std::runtime_error{"packfile is too big"};
+    }
+
+    auto archive = std::make_shared<ServedArchive>();
+    archive->packfile_path = packfile_path;
+    archive->packfile_size = static_cast<std::uint32_t>(size);
+    archive->packfile_mtime = mtime;
+    auto name_pos = packfile_path.find_last_of("\\/");
+    std::string name = name_pos == std::string::npos ? packfile_path : packfile_path.substr(name_pos + 1);
+
+    auto& header = archive->header;
+    append_le(header, 0x04034B50, 4); // signature
+    append_le(header, 10, 2); // version needed to extract
+    append_le(header, 0, 2); // flags
+    append_le(header, 0, 2); // compression method (stored)
+    append_le(header, 0, 2); // modification time
+    append_le(header, 0x21, 2); // modification date (1980-01-01)
+    append_le(header, crc, 4);
+    append_le(header, archive->packfile_size, 4); // compressed size
+    append_le(header, archive->packfile_size, 4); // uncompressed size
+    append_le(header, name.size(), 2);
+    append_le(header, 0, 2); // extra field length
+    header += name;
+
+    std::string central_dir;
+    append_le(central_dir, 0x02014B50, 4); // signature
+    append_le(central_dir, 20, 2); // version made by
+    append_le(central_dir, 10, 2); // version needed to extract
+    append_le(central_dir, 0, 2); // flags
+    append_le(central_dir, 0, 2); // compression method (stored)
+    append_le(central_dir, 0, 2); // modification time
+    append_le(central_dir, 0x21, 2); // modification date
+    append_le(central_dir, crc, 4);
+    append_le(central_dir, archive->packfile_size, 4); // compressed size
+    append_le(central_dir, archive->packfile_size, 4); // uncompressed size
+    append_le(central_dir, name.size(), 2);
+    append_le(central_dir, 0, 2); // extra field length
+    append_le(central_dir, 0, 2); // comment length
+    append_le(central_dir, 0, 2); // disk number
+    append_le(central_dir, 0, 2); // internal attributes
+    append_le(central_dir, 0, 4); // external attributes
+    append_le(central_dir, 0, 4); // local header offset
+    central_dir += name;
+
+    auto& trailer = archive->trailer;
+    trailer = central_dir;
+    append_le(trailer, 0x06054B50, 4); // end of central directory signature
+    append_le(trailer, 0, 2); // disk number
+    append_le(trailer, 0, 2); // disk with central directory
+    append_le(trailer, 1, 2); // number of entries on this disk
+    append_le(trailer, 1, 2); // total number of entries
+    append_le(trailer, central_dir.size(), 4);
+    append_le(trailer, header.size() + archive->packfile_size, 4); // central directory offset
+    append_le(trailer, 0, 2); // comment length
+    return archive;
+}
+
+// Copies archive bytes [pos, pos + len) to out
+static void read_served_archive(const ServedArchive& archive, std::ifstream& packfile, std::size_t pos, char* out,
+    std::size_t len)
+{
+    std::size_t packfile_begin = archive.header.size();
+    std::size_t packfile_end = packfile_begin + archive.packfile_size;
+    while (len > 0) {
+        std::size_t num_copied;
+        if (pos < packfile_begin) {
+            num_copied = std::min(len, packfile_begin - pos);
+            std::memcpy(out, archive.header.data() + pos, num_copied);
+        }
+        else if (pos < packfile_end) {
+            num_copied = std::min(len, packfile_end - pos);
+            packfile.seekg(static_cast<std::streamoff>(pos - packfile_begin));
+            packfile.read(out, static_cast<std::streamsize>(num_copied));
+            if (!packfile) {
+                throw std::runtime_error{"cannot read packfile"};
+            }
+        }
+        else {
+            num_copied = std::min(len, archive.trailer.size() - (pos - packfile_end));
+            std::memcpy(out, archive.trailer.data() + (pos - packfile_end), num_copied);
+        }
+        pos += num_copied;
+        out += num_copied;
+        len -= num_copied;
+    }
+}
+
+static bool send_all(SOCKET sock, std::string_view data)
+{
+    while (!data.empty()) {
+        int sent = send(sock, data.data(), static_cast<int>(data.size()), send_flags);
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+    return true;
+}
+
+static void send_text_response(SOCKET sock, std::string_view status, std::string_view body)
+{
+    auto response = std::format("HTTP/1.0 {}\r\nContent-Type: text/plain\r\nContent-Length: {}\r\n\r\n{}",
+        status, body.size(), body);
+    send_all(sock, response);
+}
+
+static std::string decode_uri_component(std::string_view value)
+{
+    std::string result;
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '%' && i + 2 < value.size()) {
+            result += static_cast<char>(std::stoi(std::string{value.substr(i + 1, 2)}, nullptr, 16));
+            i += 2;
+        }
+        else if (value[i] == '+') {
+            result += ' ';
+        }
+        else {
+            result += value[i];
+        }
+    }
+    return result;
+}
+
+static std::optional<std::string> get_query_param(std::string_view query, std::string_view name)
+{
+    for (auto param : string_split(query, '&')) {
+        auto eq_pos = param.find('=');
+        if (eq_pos != std::string_view::npos && param.substr(0, eq_pos) == name) {
+            return {decode_uri_component(param.substr(eq_pos + 1))};
+        }
+    }
+    return {};
+}
+
+static std::optional<std::string> get_request_header(std::string_view request, std::string_view name)
+{
+    for (auto line : string_split(request, '\n')) {
+        auto colon_pos = line.find(':');
+        if (colon_pos != std::string_view::npos && string_equals_ignore_case(line.substr(0, colon_pos), name)) {
+            auto value = line.substr(colon_pos + 1);
+            auto begin = value.find_first_not_of(' ');
+            auto end = value.find_last_not_of("\r ");
+            if (begin == std::string_view::npos) {
+                return {""};
+            }
+            return {std::string{value.substr(begin, end - begin + 1)}};
+        }
+    }
+    return {};
+}
+
+LevelTransferService::LevelTransferService(unsigned short port, const Limits& limits) :
+    listen_socket_{INVALID_SOCKET}, port_{port}, limits_{limits}, total_bucket_{limits.max_total_rate}
+{}
+
+LevelTransferService::~LevelTransferService()
+{
+    stop_flag_ = true;
+    if (listen_thread_.joinable()) {
+        listen_thread_.join();
+    }
+    if (listen_socket_ != INVALID_SOCKET) {
+        closesocket(listen_socket_);
+    }
+    for (auto& conn : connections_) {
+        // Unblock send/recv calls
+        shutdown(conn.sock, SD_BOTH);
+        conn.thread.join();
+        closesocket(conn.sock);
+    }
+}
+
+bool LevelTransferService::start()
+{
+    listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_socket_ == INVALID_SOCKET) {
+        xlog::error("Level transfer server: socket failed - error {}", get_socket_error());
+        return false;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port_);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_socket_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || listen(listen_socket_, SOMAXCONN) != 0
+        || getsockname(listen_socket_, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+        xlog::error("Level transfer server: cannot listen on TCP port {} - error {}", port_, get_socket_error());
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+    listen_thread_ = std::thread{&LevelTransferService::listen_thread_proc, this};
+    xlog::info("Level transfer server listening on TCP port {}", port_);
+    return true;
+}
+
+void LevelTransferService::set_levels(std::map<std::string, std::string> level_packfiles)
+{
+    std::lock_guard lock{levels_mutex_};
+    for (const auto& [level_filename, path] : level_packfiles) {
+        if (std::find(packfile_paths_.begin(), packfile_paths_.end(), path) == packfile_paths_.end()) {
+            packfile_paths_.push_back(path);
+        }
+    }
+    level_packfiles_ = std::move(level_packfiles);
+    xlog::debug("Level transfer server: {} levels can be downloaded", level_packfiles_.size());
+}
+
+void LevelTransferService::listen_thread_proc()
+{
+    while (!stop_flag_) {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(listen_socket_, &read_fds);
+        timeval timeout{0, 250 * 1000};
+        // Note: the first argument is ignored by Winsock
+        int result = select(static_cast<int>(listen_socket_) + 1, &read_fds, nullptr, nullptr, &timeout);
+        remove_finished_connections();
+        if (result <= 0) {
+            continue;
+        }
+        sockaddr_in peer_addr{};
+        socklen_t peer_addr_len = sizeof(peer_addr);
+        SOCKET sock = accept(listen_socket_, reinterpret_cast<sockaddr*>(&peer_addr), &peer_addr_len);
+        if (sock == INVALID_SOCKET) {
+            continue;
+        }
+        set_socket_timeouts(sock, socket_timeout_ms);
+        if (connections_.size() >= limits_.max_connections) {
+            send_text_response(sock, "503 Service Unavailable", "too many connections\n");
+            closesocket(sock);
+            continue;
+        }
+        std::uint32_t ip_addr = peer_addr.sin_addr.s_addr;
+        // Connections that have just sent their response are not removed yet - do not count them
+        auto num_client_connections = std::count_if(connections_.begin(), connections_.end(),
+            [=](const Connection& conn) { return conn.ip_addr == ip_addr && !conn.finished; });
+        if (static_cast<unsigned>(num_client_connections) >= limits_.max_client_connections) {
+            // One client must not be able to use all connections
+            send_text_response(sock, "503 Service Unavailable", "too many connections from your address\n");
+            closesocket(sock);
+            continue;
+        }
+        auto same_client_it = std::find_if(connections_.begin(), connections_.end(), [=](const Connection& conn) {
+            return conn.ip_addr == ip_addr;
+        });
+        auto client_bucket = same_client_it != connections_.end()
+            ? same_client_it->client_bucket
+            : std::make_shared<TokenBucket>(limits_.max_client_rate);
+        auto& conn = connections_.emplace_back(sock, ip_addr, std::move(client_bucket));
+        conn.thread = std::thread{[this, &conn]() {
+            try {
+                handle_connection(conn.sock, *conn.client_bucket);
+            }
+            catch (const std::exception& e) {
+                xlog::warn("Level transfer server: {}", e.what());
+            }
+            conn.finished = true;
+        }};
+    }
+}
+
+void LevelTransferService::remove_finished_connections()
+{
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if (it->finished) {
+            it->thread.join();
+            closesocket(it->sock);
+            it = connections_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void LevelTransferService::handle_connection(SOCKET sock, TokenBucket& client_bucket)
+{
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+        if (request.size() > max_request_size) {
+            send_text_response(sock, "400 Bad Request", "");
+            return;
+        }
+        int received = recv(sock, buf, sizeof(buf), 0);
+        if (received <= 0) {
+            return;
+        }
+        request.append(buf, static_cast<std::size_t>(received));
+    }
+
+    // Request line: GET /path?query HTTP/1.0
+    auto line_end = request.find("\r\n");
+    std::string_view request_line{request.data(), line_end};
+    auto target_begin = request_line.find(' ');
+    auto target_end = request_line.rfind(' ');
+    if (target_begin == std::string_view::npos || target_end <= target_begin) {
+        send_text_response(sock, "400 Bad Request", "");
+        return;
+    }
+    if (request_line.substr(0, target_begin) != "GET") {
+        send_text_response(sock, "405 Method Not Allowed", "");
+        return;
+    }
+    auto target = request_line.substr(target_begin + 1, target_end - target_begin - 1);
+    auto query_pos = target.find('?');
+    auto path = target.substr(0, query_pos);
+    auto query = query_pos == std::string_view::npos ? std::string_view{} : target.substr(query_pos + 1);
+    std::string_view headers{request.data() + line_end, request.size() - line_end};
+
+    if (path == "/findmap.php") {
+        handle_find_map(sock, get_query_param(query, "rflName").value_or(""));
+    }
+    else if (path == "/downloadmap.php") {
+        handle_download_map(sock, get_query_param(query, "ticketid").value_or(""),
+            get_request_header(headers, "Range"), client_bucket);
+    }
+    else {
+        send_text_response(sock, "404 Not Found", "");
+    }
+}
+
+std::shared_ptr<const ServedArchive> LevelTransferService::get_archive(int ticket_id)
+{
+    std::string packfile_path;
+    {
+        std::lock_guard lock{levels_mutex_};
+        if (ticket_id <= 0 || static_cast<std::size_t>(ticket_id) > packfile_paths_.size()) {
+            return {};
+        }
+        packfile_path = packfile_paths_[ticket_id - 1];
+        auto it = archives_.find(packfile_path);
+        // Packfile can be replaced while the server is running - clients would get a wrong checksum and size
+        if (it != archives_.end() && is_served_archive_up_to_date(*it->second)) {
+            return it->second;
+        }
+    }
+    // Packfile checksum is calculated without holding the lock so other requests are not blocked
+    auto archive = build_served_archive(packfile_path);
+    std::lock_guard lock{levels_mutex_};
+    archives_[packfile_path] = archive;
+    return archive;
+}
+
+void LevelTransferService::handle_find_map(SOCKET sock, const std::string& level_filename)
+{
+    int ticket_id = 0;
+    {
+        std::lock_guard lock{levels_mutex_};
+        auto it = level_packfiles_.find(string_to_lower(level_filename));
+        if (it != level_packfiles_.end()) {
+            auto path_it = std::find(packfile_paths_.begin(), packfile_paths_.end(), it->second);
+            ticket_id = static_cast<int>(path_it - packfile_paths_.begin()) + 1;
+        }
+    }
+    auto archive = get_archive(ticket_id);
+    if (!archive) {
+        send_text_response(sock, "200 OK", "notfound\n");
+        return;
+    }
+    auto name = level_filename.substr(0, level_filename.rfind('.'));
+    double size_mb = archive->size() / 1024.0 / 1024.0;
+    send_text_response(sock, "200 OK",
+        std::format("found\n{}\nUnknown\nSent by the game server\n{:.4f}\n{}\n", name, size_mb, ticket_id));
+}
+
+void LevelTransferService::handle_download_map(SOCKET sock, const std::string& ticket_id_str,
+    const std::optional<std::string>& range, TokenBucket& client_bucket)
+{
+    int ticket_id = 0;
+    try {
+        ticket_id = std::stoi(ticket_id_str);
+    }
+    catch (const std::exception&) {
+    }
+    auto archive = get_archive(ticket_id);
+    if (!archive) {
+        send_text_response(sock, "404 Not Found", "");
+        return;
+    }
+    std::ifstream packfile{archive->packfile_path, std::ios_base::in | std::ios_base::binary};
+    if (!packfile) {
+        send_text_response(sock, "500 Internal Server Error", "");
+        return;
+    }
+
+    std::size_t total_size = archive->size();
+    std::size_t begin = 0;
+    std::size_t end = total_size;
+    std::string status = "200 OK";
+    std::string range_header;
+    if (range && range.value().starts_with("bytes=")) {
+        std::string_view range_spec{range.value()};
+        range_spec.remove_prefix(6);
+        auto dash_pos = range_spec.find('-');
+        try {
+            begin = std::stoul(std::string{range_spec.substr(0, dash_pos)});
+            if (dash_pos != std::string_view::npos && dash_pos + 1 < range_spec.size()) {
+                end = std::min<std::size_t>(std::stoul(std::string{range_spec.substr(dash_pos + 1)}) + 1,
+                    total_size);
+            }
+        }
+        catch (const std::exception&) {
+            send_text_response(sock, "400 Bad Request", "");
+            return;
+        }
+        if (begin >= end) {
+            send_text_response(sock, "416 Range Not Satisfiable", "");
+            return;
+        }
+        status = "206 Partial Content";
+        range_header = std::format("Content-Range: bytes {}-{}/{}\r\n", begin, end - 1, total_size);
+    }
+    auto response_header = std::format(
+        "HTTP/1.0 {}\r\nContent-Type: application/zip\r\nContent-Length: {}\r\nAccept-Ranges: bytes\r\n{}\r\n",
+        status, end - begin, range_header);
+    if (!send_all(sock, response_header)) {
+        return;
+    }
+
+    xlog::info("Level transfer server: sending {} (bytes {}-{})", archive->packfile_path, begin, end);
+    std::vector<char> buf(send_chunk_size);
+    std::size_t pos = begin;
+    while (pos < end && !stop_flag_) {
+        std::size_t len = std::min(buf.size(), end - pos);
+        read_served_archive(*archive, packfile, pos, buf.data(), len);
+        auto delay = std::max(client_bucket.consume(len), total_bucket_.consume(len));
+        if (delay.count() > 0) {
+            std::this_thread::sleep_for(delay);
+        }
+        if (!send_all(sock, {buf.data(), len})) {
+            xlog::info("Level transfer server: connection closed at byte {}", pos);
+            return;
+        }
+        pos += len;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+using SOCKET = int;
+#endif
+
+// Limits bandwidth used by one or many connections. Allows bursts of up to one second worth of data.
+class TokenBucket
+{
+    std::mutex mutex_;
+    // bytes per second, 0 means no limit
+    unsigned rate_;
+    double tokens_;
+    std::chrono::steady_clock::time_point last_refill_ = std::chrono::steady_clock::now();
+
+public:
+    TokenBucket(unsigned rate) : rate_{rate}, tokens_{static_cast<double>(rate)} {}
+
+    // Takes len bytes from the bucket and returns how long the caller has to wait before sending them
+    std::chrono::milliseconds consume(std::size_t len);
+};
+
+struct ServedArchive;
+
+// HTTP service implementing the FactionFiles autodl API for a set of packfiles (see level_transfer_server.h). It does
+// not depend on the game so it can be tested natively.
+class LevelTransferService
+{
+public:
+    struct Limits
+    {
+        // bytes per second, 0 means no limit
+        unsigned max_client_rate = 0;
+        unsigned max_total_rate = 0;
+        unsigned max_connections = 8;
+        // connections from a single address
+        unsigned max_client_connections = 4;
+    };
+
+    // If port is 0 a free port is used
+    LevelTransferService(unsigned short port, const Limits& limits);
+    ~LevelTransferService();
+    LevelTransferService(const LevelTransferService&) = delete;
+    LevelTransferService& operator=(const LevelTransferService&) = delete;
+
+    bool start();
+    // Sets levels that can be downloaded: lower-case level filename -> full path of the packfile.
+    // Note: ticket ids of packfiles served before stay valid.
+    void set_levels(std::map<std::string, std::string> level_packfiles);
+
+    [[nodiscard]] unsigned short get_port() const
+    {
+        return port_;
+    }
+
+private:
+    struct Connection
+    {
+        SOCKET sock;
+        std::uint32_t ip_addr;
+        // shared by all connections from the same address so clients cannot bypass the limit by using ranges
+        std::shared_ptr<TokenBucket> client_bucket;
+        std::thread thread;
+        std::atomic<bool> finished{false};
+
+        Connection(SOCKET sock, std::uint32_t ip_addr, std::shared_ptr<TokenBucket> client_bucket) :
+            sock{sock}, ip_addr{ip_addr}, client_bucket{std::move(client_bucket)}
+        {}
+    };
+
+    SOCKET listen_socket_;
+    unsigned short port_;
+    Limits limits_;
+    std::atomic<bool> stop_flag_{false};
+    std::thread listen_thread_;
+    TokenBucket total_bucket_;
+    std::list<Connection> connections_;
+
+    // Levels are updated by the main thread and read by connection threads
+    std::mutex levels_mutex_;
+    // lower-case level filename -> full path of the packfile
+    std::map<std::string, std::string> level_packfiles_;
+    // ticket id is an index in this vector plus one
+    std::vector<std::string> packfile_paths_;
+    // by packfile path, rebuilt when the packfile changes
+    std::map<std::string, std::shared_ptr<const ServedArchive>> archives_;
+
+    void listen_thread_proc();
+    void remove_finished_connections();
+    void handle_connection(SOCKET sock, TokenBucket& client_bucket);
+    std::shared_ptr<const ServedArchive> get_archive(int ticket_id);
+    void handle_find_map(SOCKET sock, const std::string& level_filename);
+    void handle_download_map(SOCKET sock, const std::string& ticket_id_str, const std::optional<std::string>& range,
+        TokenBucket& client_bucket);
+};
@@ -5,6 +5,11 @@
 #include <patch_common/CodeInjection.h>
 #include "multi.h"
 #include "multi_private.h"
+#include "packet_capture.h"
+#include "obj_update_delta.h"
+#include "obj_interest.h"
+#include "send_scheduler.h"
+#include "net_stats.h"
 #include "../misc/misc.h"
 #include "../rf/os/os.h"
 #include "../rf/os/timer.h"
@@ -354,6 +359,12 @@ void multi_do_patch()
 
     level_download_init();
     multi_ban_apply_patch();
+    packet_capture_init();
+    obj_update_delta_do_patch();
+    obj_interest_do_patch();
+    send_scheduler_do_patch();
+    // Must be installed after other multi_io_process_packets injections
+    net_stats_do_patch();
 
     // Init cmd line param
     get_url_cmd_line_param();
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <optional>
+#include <string>
+#include <vector>
 #include "../rf/player/player.h"
 
 struct PlayerStatsNew : rf::PlayerLevelStats
@@ -76,6 +78,14 @@ struct DashFactionServerInfo
     uint8_t version_minor = 0;
     bool saving_enabled = false;
     std::optional<float> max_fov;
+    // upcoming levels starting from the one after the level played when joining
+    std::vector<std::string> level_rotation;
+    // TCP port of the server level transfer service (if enabled)
+    std::optional<uint16_t> level_transfer_port;
+    // server sends delta-compressed object updates to clients that acknowledge them
+    bool obj_update_delta = false;
+    // step used for quantization of positions in delta-compressed object updates (0 if not quantized)
+    float obj_update_pos_precision = 0.0f;
 };
 
 void multi_level_download_update();
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <common/utils/list-utils.h>
+#include <patch_common/CodeInjection.h>
+#include <xlog/xlog.h>
+#include "net_stats.h"
+#include "../misc/player.h"
+#include "../os/console.h"
+#include "../rf/multi.h"
+#include "../rf/player/player.h"
+
+// Packet being handled by the game
+struct NetStatsPendingPacket
+{
+    int type;
+    std::chrono::steady_clock::time_point start;
+};
+
+static NetPacketTypeStatsTable g_packet_type_stats;
+static std::chrono::steady_clock::time_point g_net_stats_start = std::chrono::steady_clock::now();
+static rf::Player* g_processing_player = nullptr;
+static std::optional<NetStatsPendingPacket> g_pending_packet;
+
+static NetClientStats* get_client_stats(rf::Player* player)
+{
+    if (!player) {
+        return nullptr;
+    }
+    auto& pdata = get_player_additional_data(player);
+    if (!pdata.net_stats) {
+        pdata.net_stats = std::make_unique<NetClientStats>();
+    }
+    return pdata.net_stats.get();
+}
+
+static void finish_pending_packet(std::chrono::steady_clock::time_point now)
+{
+    if (g_pending_packet) {
+        auto& pending = g_pending_packet.value();
+        auto time_us = std::chrono::duration_cast<std::chrono::microseconds>(now - pending.start).count();
+        g_packet_type_stats[pending.type & 0xFF].handling_time.add(static_cast<uint32_t>(time_us));
+        g_pending_packet.reset();
+    }
+}
+
+void net_stats_begin_processing(rf::Player* player, std::span<const std::byte> buf)
+{
+    g_processing_player = player;
+    net_stats_count_recv(g_packet_type_stats, get_client_stats(player), buf);
+}
+
+void net_stats_end_processing()
+{
+    finish_pending_packet(std::chrono::steady_clock::now());
+    g_processing_player = nullptr;
+}
+
+void net_stats_on_recv_dropped(rf::Player* player, int packet_type, size_t len)
+{
+    // Packet type is unknown if the buffer is truncated in the packet header
+    if (packet_type >= 0) {
+        ++g_packet_type_stats[packet_type & 0xFF].recv_dropped;
+    }
+    if (auto client_stats = get_client_stats(player)) {
+        ++client_stats->recv_dropped;
+        // Count the bytes so clients flooding the server with invalid packets can be found
+        client_stats->recv.bytes += len;
+    }
+}
+
+void net_stats_on_packet_rejected(int packet_type)
+{
+    ++g_packet_type_stats[packet_type & 0xFF].rejected;
+    if (auto client_stats = get_client_stats(g_processing_player)) {
+        ++client_stats->rejected;
+    }
+}
+
+void net_stats_on_send(rf::Player* player, std::span<const std::byte> buf)
+{
+    net_stats_count_sent(g_packet_type_stats, get_client_stats(player), buf);
+}
+
+void net_stats_on_send_dropped(rf::Player* player, std::span<const std::byte> buf)
+{
+    net_stats_count_sent_dropped(g_packet_type_stats, get_client_stats(player), buf);
+}
+
+// Runs before packet type whitelist and custom packet handling (it is installed later) so it sees every packet
+// dispatched by multi_io_process_packets. Handling of a packet ends when the next one is dispatched or when
+// multi_io_process_packets returns.
+CodeInjection multi_io_process_packets_timing_injection{
+    0x0047918D,
+    [](auto& regs) {
+        auto now = std::chrono::steady_clock::now();
+        finish_pending_packet(now);
+        g_pending_packet = {static_cast<int>(regs.esi), now};
+    },
+};
+
+static void net_stats_reset()
+{
+    g_packet_type_stats = {};
+    g_net_stats_start = std::chrono::steady_clock::now();
+    auto player_list = SinglyLinkedList{rf::player_list};
+    for (auto& player : player_list) {
+        get_player_additional_data(&player).net_stats.reset();
+    }
+}
+
+static std::string format_histogram(const NetStatsHistogram& histogram)
+{
+    std::string result;
+    for (auto n : histogram.buckets) {
+        if (!result.empty()) {
+            result += ' ';
+        }
+        result += std::to_string(n);
+    }
+    return result;
+}
+
+static std::string get_player_addr_str(const rf::Player& player)
+{
+    if (!player.net_data) {
+        return "local";
+    }
+    char addr_str[64];
+    rf::net_addr_to_string(addr_str, sizeof(addr_str), player.net_data->addr);
+    return addr_str;
+}
+
+static void net_stats_dump(const std::string& filename)
+{
+    std::ofstream file{filename, std::ios_base::out | std::ios_base::trunc};
+    if (!file) {
+        rf::console::print("Cannot open {}", filename);
+        return;
+    }
+    // Histogram columns contain space separated bucket counts (see NetStatsHistogram)
+    file << "scope;id;recv count;recv bytes;sent count;sent bytes;recv dropped;sent dropped;rejected;"
+        "recv size histogram;sent size histogram;handling time histogram (us)\n";
+    for (int type = 0; type < static_cast<int>(g_packet_type_stats.size()); ++type) {
+        const auto& stats = g_packet_type_stats[type];
+        if (stats.recv.count == 0 && stats.sent.count == 0 && stats.recv_dropped == 0 && stats.sent_dropped == 0 &&
+            stats.rejected == 0) {
+            continue;
+        }
+        file << std::format("type;0x{:02x};{};{};{};{};{};{};{};{};{};{}\n", type, stats.recv.count,
+            stats.recv.bytes, stats.sent.count, stats.sent.bytes, stats.recv_dropped, stats.sent_dropped,
+            stats.rejected, format_histogram(stats.recv_size), format_histogram(stats.sent_size),
+            format_histogram(stats.handling_time));
+    }
+    auto player_list = SinglyLinkedList{rf::player_list};
+    for (auto& player : player_list) {
+        const auto& stats = get_player_additional_data(&player).net_stats;
+        if (!stats) {
+            continue;
+        }
+        file << std::format("client;{};{};{};{};{};{};{};{};;;\n", get_player_addr_str(player), stats->recv.count,
+            stats->recv.bytes, stats->sent.count, stats->sent.bytes, stats->recv_dropped, stats->sent_dropped,
+            stats->rejected);
+    }
+    rf::console::print("Network statistics saved to {}", filename);
+}
+
+static void net_stats_print_top()
+{
+    constexpr size_t max_rows = 10;
+    auto elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - g_net_stats_start).count();
+    elapsed = std::max(elapsed, 1.0f);
+    rf::console::print("Network statistics for last {:.0f} seconds", elapsed);
+
+    std::vector<int> types;
+    for (int type = 0; type < static_cast<int>(g_packet_type_stats.size()); ++type) {
+        const auto& stats = g_packet_type_stats[type];
+        if (stats.recv.count > 0 || stats.sent.count > 0 || stats.rejected > 0 || stats.recv_dropped > 0) {
+            types.push_back(type);
+        }
+    }
+    auto total_bytes = [](const auto& stats) { return stats.recv.bytes + stats.sent.bytes; };
+    std::sort(types.begin(), types.end(), [&](int a, int b) {
+        return total_bytes(g_packet_type_stats[a]) > total_bytes(g_packet_type_stats[b]);
+    });
+    rf::console::print("Type  recv B/s  sent B/s  count/s  size p50/p99  time p99  drops  rejected");
+    for (size_t i = 0; i < std::min(types.size(), max_rows); ++i) {
+        const auto& stats = g_packet_type_stats[types[i]];
+        const auto& size_histogram = stats.sent.count > stats.recv.count ? stats.sent_size : stats.recv_size;
+        rf::console::print("0x{:02x}  {:8.0f}  {:8.0f}  {:7.1f}  {:5}/{:<5}  {:6}us  {:5}  {:8}", types[i],
+            stats.recv.bytes / elapsed, stats.sent.bytes / elapsed, (stats.recv.count + stats.sent.count) / elapsed,
+            size_histogram.percentile(0.5f), size_histogram.percentile(0.99f),
+            stats.handling_time.percentile(0.99f), stats.recv_dropped + stats.sent_dropped, stats.rejected);
+    }
+
+    std::vector<rf::Player*> players;
+    auto player_list = SinglyLinkedList{rf::player_list};
+    for (auto& player : player_list) {
+        if (get_player_additional_data(&player).net_stats) {
+            players.push_back(&player);
+        }
+    }
+    std::sort(players.begin(), players.end(), [&](rf::Player* a, rf::Player* b) {
+        return total_bytes(*get_player_additional_data(a).net_stats) >
+            total_bytes(*get_player_additional_data(b).net_stats);
+    });
+    if (players.empty()) {
+        return;
+    }
+    rf::console::print("Client  recv B/s  sent B/s  drops  rejected");
+    for (size_t i = 0; i < std::min(players.size(), max_rows); ++i) {
+        const auto& stats = *get_player_additional_data(players[i]).net_stats;
+        rf::console::print("{} ({})  {:.0f}  {:.0f}  {}  {}", players[i]->name, get_player_addr_str(*players[i]),
+            stats.recv.bytes / elapsed, stats.sent.bytes / elapsed, stats.recv_dropped + stats.sent_dropped,
+            stats.rejected);
+    }
+}
+
+ConsoleCommand2 net_stats_cmd{
+    "net_stats",
+    [](std::optional<std::string> action_opt, std::optional<std::string> filename_opt) {
+        auto action = action_opt.value_or("");
+        if (action == "reset") {
+            net_stats_reset();
+            rf::console::print("Network statistics reset");
+        }
+        else if (action == "dump") {
+            net_stats_dump(filename_opt.value_or("net_stats.csv"));
+        }
+        else if (action.empty()) {
+            net_stats_print_top();
+        }
+        else {
+            rf::console::print("Usage: net_stats [reset | dump [filename]]");
+        }
+    },
+    "Prints packet types and clients using the most bandwidth, resets network statistics or saves them to a CSV file",
+    "net_stats [reset | dump [filename]]",
+};
+
+void net_stats_do_patch()
+{
+    multi_io_process_packets_timing_injection.install();
+    net_stats_cmd.register_cmd();
+}
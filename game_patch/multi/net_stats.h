@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include "net_stats_counters.h"
+
+// Forward declarations
+namespace rf
+{
+    struct Player;
+}
+
+// Network statistics gathered per game packet type and per client. Counting is done on buffers that are already
+// parsed by other code so it only walks packet headers - it is always enabled.
+
+void net_stats_do_patch();
+// Called for a buffer with validated packets before and after they are handled by the game
+void net_stats_begin_processing(rf::Player* player, std::span<const std::byte> buf);
+void net_stats_end_processing();
+// Received buffer was dropped because it failed validation
+void net_stats_on_recv_dropped(rf::Player* player, int packet_type, size_t len);
+// Packet from the buffer being processed was rejected by the packet type whitelist
+void net_stats_on_packet_rejected(int packet_type);
+void net_stats_on_send(rf::Player* player, std::span<const std::byte> buf);
+void net_stats_on_send_dropped(rf::Player* player, std::span<const std::byte> buf);
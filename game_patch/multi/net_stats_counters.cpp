@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <common/rfproto.h>
+#include "net_stats_counters.h"
+
+void NetStatsHistogram::add(uint32_t value)
+{
+    auto bucket = std::min<int>(std::bit_width(value), num_buckets - 1);
+    ++buckets[bucket];
+}
+
+uint32_t NetStatsHistogram::percentile(float fraction) const
+{
+    uint64_t total = 0;
+    for (auto n : buckets) {
+        total += n;
+    }
+    uint64_t sum = 0;
+    for (int i = 0; i < num_buckets; ++i) {
+        sum += buckets[i];
+        if (sum > 0 && sum >= total * fraction) {
+            return (1u << i) - 1;
+        }
+    }
+    return 0;
+}
+
+// Calls callback for every packet in the buffer. Packets are not validated.
+template<typename F>
+static void for_each_packet(std::span<const std::byte> buf, F callback)
+{
+    size_t offset = 0;
+    while (offset + sizeof(RF_GamePacketHeader) <= buf.size()) {
+        RF_GamePacketHeader header;
+        std::memcpy(&header, &buf[offset], sizeof(header));
+        size_t packet_len = std::min(sizeof(header) + header.size, buf.size() - offset);
+        callback(header.type, packet_len);
+        offset += packet_len;
+    }
+}
+
+void net_stats_count_recv(NetPacketTypeStatsTable& type_stats, NetClientStats* client_stats,
+                          std::span<const std::byte> buf)
+{
+    for_each_packet(buf, [&](uint8_t type, size_t len) {
+        auto& stats = type_stats[type];
+        ++stats.recv.count;
+        stats.recv.bytes += len;
+        stats.recv_size.add(static_cast<uint32_t>(len));
+        if (client_stats) {
+            ++client_stats->recv.count;
+            client_stats->recv.bytes += len;
+        }
+    });
+}
+
+void net_stats_count_sent(NetPacketTypeStatsTable& type_stats, NetClientStats* client_stats,
+                          std::span<const std::byte> buf)
+{
+    for_each_packet(buf, [&](uint8_t type, size_t len) {
+        auto& stats = type_stats[type];
+        ++stats.sent.count;
+        stats.sent.bytes += len;
+        stats.sent_size.add(static_cast<uint32_t>(len));
+        if (client_stats) {
+            ++client_stats->sent.count;
+            client_stats->sent.bytes += len;
+        }
+    });
+}
+
+void net_stats_count_sent_dropped(NetPacketTypeStatsTable& type_stats, NetClientStats* client_stats,
+                                  std::span<const std::byte> buf)
+{
+    for_each_packet(buf, [&](uint8_t type, [[maybe_unused]] size_t len) {
+        ++type_stats[type].sent_dropped;
+        if (client_stats) {
+            ++client_stats->sent_dropped;
+        }
+    });
+}
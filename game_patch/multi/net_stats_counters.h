@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Counters of network statistics (see net_stats.h). They do not depend on the game so counting can be tested and
+// measured natively.
+
+// Histogram with power of two buckets: bucket 0 counts zeros, bucket N counts values in range [2^(N-1), 2^N) and the
+// last bucket also counts all bigger values
+struct NetStatsHistogram
+{
+    static constexpr int num_buckets = 16;
+    std::array<uint32_t, num_buckets> buckets{};
+
+    void add(uint32_t value);
+    // Returns upper bound of the bucket containing given fraction of values
+    [[nodiscard]] uint32_t percentile(float fraction) const;
+};
+
+struct NetTrafficCounters
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// Server-side state kept for every client
+struct NetClientStats
+{
+    NetTrafficCounters recv;
+    NetTrafficCounters sent;
+    uint32_t recv_dropped = 0;
+    uint32_t sent_dropped = 0;
+    uint32_t rejected = 0;
+};
+
+struct NetPacketTypeStats
+{
+    NetTrafficCounters recv;
+    NetTrafficCounters sent;
+    uint32_t recv_dropped = 0;
+    uint32_t sent_dropped = 0;
+    uint32_t rejected = 0;
+    NetStatsHistogram recv_size;
+    NetStatsHistogram sent_size;
+    // time spent in the game packet handler in microseconds
+    NetStatsHistogram handling_time;
+};
+
+// Indexed by packet type
+using NetPacketTypeStatsTable = std::array<NetPacketTypeStats, 256>;
+
+// Count packets in a buffer in statistics of their types and of the client (can be null). Packets are not validated -
+// only their headers are read.
+void net_stats_count_recv(NetPacketTypeStatsTable& type_stats, NetClientStats* client_stats,
+                          std::span<const std::byte> buf);
+void net_stats_count_sent(NetPacketTypeStatsTable& type_stats, NetClientStats* client_stats,
+                          std::span<const std::byte> buf);
+void net_stats_count_sent_dropped(NetPacketTypeStatsTable& type_stats, NetClientStats* client_stats,
+                                  std::span<const std::byte> buf);
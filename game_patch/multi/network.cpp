@@ -5,13 +5,16 @@
 #include <cstring>
 #include <format>
 #include <functional>
+#include <string>
 #include <thread>
+#include <vector>
 #include <winsock2.h>
 #include <iphlpapi.h>
 #include <ws2ipdef.h>
 #include <natupnp.h>
 #include <common/config/BuildConfig.h>
 #include <common/rfproto.h>
+#include <common/rfproto-parser.h>
 #include <common/version/version.h>
 #include <common/utils/enum-bitwise-operators.h>
 #include <common/utils/list-utils.h>
@@ -25,6 +28,10 @@
 #include "multi.h"
 #include "server.h"
 #include "server_internal.h"
+#include "level_transfer_server.h"
+#include "packet_capture.h"
+#include "obj_update_delta.h"
+#include "net_stats.h"
 #include "../main/main.h"
 #include "../rf/multi.h"
 #include "../rf/misc.h"
@@ -276,6 +283,7 @@ CodeInjection process_game_packet_whitelist_filter{
         }
         if (!allowed) {
             xlog::warn("Ignoring packet 0x{:x}", packet_type);
+            net_stats_on_packet_rejected(packet_type);
             regs.eip = 0x00479194;
         }
         else {
@@ -619,24 +627,30 @@ struct df_sign_packet_ext
     uint8_t version_minor = VERSION_MINOR;
 };
 
-template<typename T>
-std::pair<std::unique_ptr<std::byte[]>, size_t> extend_packet(const std::byte* data, size_t len, const T& ext_data)
+std::pair<std::unique_ptr<std::byte[]>, size_t> extend_packet(const std::byte* data, size_t len,
+    const void* ext_data, size_t ext_len)
 {
-    auto new_data = std::make_unique<std::byte[]>(len + sizeof(ext_data));
+    auto new_data = std::make_unique<std::byte[]>(len + ext_len);
 
     // Modify size in packet header
     RF_GamePacketHeader header;
     std::memcpy(&header, data, sizeof(header));
-    header.size += sizeof(ext_data);
+    header.size += ext_len;
     std::memcpy(new_data.get(), &header, sizeof(header));
 
     // Copy old data
     std::memcpy(new_data.get() + sizeof(header), data + sizeof(header), len - sizeof(header));
 
     // Append extension data
-    std::memcpy(new_data.get() + len, &ext_data, sizeof(ext_data));
+    std::memcpy(new_data.get() + len, ext_data, ext_len);
 
-    return {std::move(new_data), len + sizeof(ext_data)};
+    return {std::move(new_data), len + ext_len};
+}
+
+template<typename T>
+std::pair<std::unique_ptr<std::byte[]>, size_t> extend_packet(const std::byte* data, size_t len, const T& ext_data)
+{
+    return extend_packet(data, len, &ext_data, sizeof(ext_data));
 }
 
 std::pair<std::unique_ptr<std::byte[]>, size_t> extend_packet_with_df_signature(std::byte* data, size_t len)
@@ -667,10 +681,20 @@ struct DashFactionJoinAcceptPacketExt
         none           = 0,
         saving_enabled = 1,
         max_fov        = 2,
+        level_rotation = 4,
+        level_transfer = 8,
+        obj_update_delta = 16,
     } flags = Flags::none;
 
     float max_fov;
 
+    // Size of level rotation data following this struct: number of levels (uint8_t) and their null-terminated
+    // file names in the order they are going to be played, starting from the level after the current one
+    uint16_t level_rotation_size = 0;
+    // TCP port used for downloading levels from the server (see level_transfer_server.h)
+    uint16_t level_transfer_port = 0;
+    // Step of quantized positions in obj_update_delta packets (0 - not quantized)
+    float obj_update_pos_precision = 0.0f;
 };
 template<>
 struct EnableEnumBitwiseOperators<DashFactionJoinAcceptPacketExt::Flags> : std::true_type {};
@@ -684,6 +708,48 @@ CallHook<int(const rf::NetAddr*, std::byte*, size_t)> send_join_req_packet_hook{
     },
 };
 
+static std::vector<std::byte> build_level_rotation_ext(size_t max_size)
+{
+    const auto& levels = rf::netgame.levels;
+    std::vector<std::byte> buf{std::byte{0}};
+    uint8_t num_levels = 0;
+    for (int i = 1; i < levels.size() && num_levels < UINT8_MAX; ++i) {
+        const rf::String& level = levels[(rf::netgame.current_level_index + i) % levels.size()];
+        size_t name_len = std::strlen(level.c_str()) + 1;
+        if (buf.size() + name_len > max_size) {
+            break;
+        }
+        auto name_bytes = reinterpret_cast<const std::byte*>(level.c_str());
+        buf.insert(buf.end(), name_bytes, name_bytes + name_len);
+        ++num_levels;
+    }
+    if (num_levels == 0) {
+        return {};
+    }
+    buf[0] = static_cast<std::byte>(num_levels);
+    return buf;
+}
+
+static std::vector<std::string> parse_level_rotation_ext(const std::byte* data, size_t size)
+{
+    std::vector<std::string> levels;
+    if (size == 0) {
+        return levels;
+    }
+    auto num_levels = static_cast<uint8_t>(data[0]);
+    auto chars = reinterpret_cast<const char*>(data);
+    size_t pos = 1;
+    while (levels.size() < num_levels && pos < size) {
+        const char* name_end = static_cast<const char*>(std::memchr(chars + pos, 0, size - pos));
+        if (!name_end) {
+            break;
+        }
+        levels.emplace_back(chars + pos, name_end);
+        pos = name_end - chars + 1;
+    }
+    return levels;
+}
+
 CallHook<int(const rf::NetAddr*, std::byte*, size_t)> send_join_accept_packet_hook{
     0x0047A825,
     [](const rf::NetAddr* addr, std::byte* data, size_t len) {
@@ -696,21 +762,51 @@ CallHook<int(const rf::NetAddr*, std::byte*, size_t)> send_join_accept_packet_ho
             ext_data.flags |= DashFactionJoinAcceptPacketExt::Flags::max_fov;
             ext_data.max_fov = server_get_df_config().max_fov.value();
         }
-        auto [new_data, new_len] = extend_packet(data, len, ext_data);
+        if (auto level_transfer_port = level_transfer_server_get_port()) {
+            ext_data.flags |= DashFactionJoinAcceptPacketExt::Flags::level_transfer;
+            ext_data.level_transfer_port = level_transfer_port.value();
+        }
+        if (g_additional_server_config.obj_update_delta) {
+            ext_data.flags |= DashFactionJoinAcceptPacketExt::Flags::obj_update_delta;
+            ext_data.obj_update_pos_precision = g_additional_server_config.obj_update_pos_precision;
+        }
+        // Let clients download upcoming levels in background. Levels that do not fit in the packet are skipped.
+        size_t max_rotation_size = rf::max_packet_size - std::min(rf::max_packet_size, len + sizeof(ext_data));
+        std::vector<std::byte> rotation = build_level_rotation_ext(max_rotation_size);
+        if (!rotation.empty()) {
+            ext_data.flags |= DashFactionJoinAcceptPacketExt::Flags::level_rotation;
+            ext_data.level_rotation_size = static_cast<uint16_t>(rotation.size());
+        }
+        std::vector<std::byte> ext_buf(sizeof(ext_data));
+        std::memcpy(ext_buf.data(), &ext_data, sizeof(ext_data));
+        ext_buf.insert(ext_buf.end(), rotation.begin(), rotation.end());
+        auto [new_data, new_len] = extend_packet(data, len, ext_buf.data(), ext_buf.size());
         return send_join_accept_packet_hook.call_target(addr, new_data.get(), new_len);
     },
 };
 
+// Packet handlers get a pointer to the packet data following the header. Header size has been checked against
+// the number of received bytes by rf_validate_game_packets.
+static size_t get_received_packet_data_size(const std::byte* data)
+{
+    RF_GamePacketHeader header;
+    std::memcpy(&header, data - sizeof(header), sizeof(header));
+    return header.size;
+}
+
 CodeInjection process_join_accept_injection{
     0x0047A979,
     [](auto& regs) {
         std::byte* packet = regs.ebp;
-        auto ext_offset = regs.esi + 5;
+        size_t packet_len = get_received_packet_data_size(packet);
+        size_t ext_offset = regs.esi + 5;
         DashFactionJoinAcceptPacketExt ext_data;
-        std::copy(packet + ext_offset, packet + ext_offset + sizeof(DashFactionJoinAcceptPacketExt),
-            reinterpret_cast<std::byte*>(&ext_data));
-        xlog::debug("Checking for join_accept DF extension: {:08X}", ext_data.df_signature);
-        if (ext_data.df_signature == DASH_FACTION_SIGNATURE) {
+        bool has_ext = ext_offset + sizeof(ext_data) <= packet_len;
+        if (has_ext) {
+            std::memcpy(&ext_data, packet + ext_offset, sizeof(ext_data));
+            xlog::debug("Checking for join_accept DF extension: {:08X}", ext_data.df_signature);
+        }
+        if (has_ext && ext_data.df_signature == DASH_FACTION_SIGNATURE) {
             DashFactionServerInfo server_info;
             server_info.version_major = ext_data.version_major;
             server_info.version_minor = ext_data.version_minor;
@@ -722,11 +818,25 @@ CodeInjection process_join_accept_injection{
             if (!!(ext_data.flags & DashFactionJoinAcceptPacketExt::Flags::max_fov) && ext_data.max_fov >= default_fov) {
                 server_info.max_fov = ext_data.max_fov;
             }
+            if (!!(ext_data.flags & DashFactionJoinAcceptPacketExt::Flags::level_rotation) &&
+                ext_offset + sizeof(ext_data) + ext_data.level_rotation_size <= packet_len) {
+                server_info.level_rotation = parse_level_rotation_ext(
+                    packet + ext_offset + sizeof(DashFactionJoinAcceptPacketExt), ext_data.level_rotation_size);
+                xlog::debug("Got DF server level rotation: {} levels", server_info.level_rotation.size());
+            }
+            if (!!(ext_data.flags & DashFactionJoinAcceptPacketExt::Flags::level_transfer)) {
+                server_info.level_transfer_port = {ext_data.level_transfer_port};
+            }
+            server_info.obj_update_delta = !!(ext_data.flags & DashFactionJoinAcceptPacketExt::Flags::obj_update_delta);
+            if (server_info.obj_update_delta) {
+                server_info.obj_update_pos_precision = ext_data.obj_update_pos_precision;
+            }
             g_df_server_info = std::optional{server_info};
         }
         else {
             g_df_server_info.reset();
         }
+        obj_update_delta_reset_client();
     },
 };
 
@@ -870,6 +980,9 @@ FunHook<void(int, rf::NetAddr*)> multi_start_hook{
             rf::net_init_socket(7755);
         }
         multi_start_hook.call_target(is_client, serv_addr);
+        if (!is_client && g_additional_server_config.level_transfer.enabled) {
+            level_transfer_server_start(rf::net_port);
+        }
     },
 };
 
@@ -890,6 +1003,8 @@ FunHook<void()> multi_stop_hook{
     []() {
         // Clear server info when leaving
         g_df_server_info.reset();
+        obj_update_delta_reset_client();
+        level_transfer_server_stop();
         multi_stop_hook.call_target();
     },
 };
@@ -1042,6 +1157,38 @@ CodeInjection multi_io_process_packets_injection{
     },
 };
 
+FunHook<rf::MultiIoProcessPackets_Type> multi_io_process_packets_hook{
+    0x004790D0,
+    [](const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player) {
+        packet_capture_on_recv(data, len, addr);
+
+        // Restore obj_update packets from delta-compressed ones
+        std::span buf{static_cast<const std::byte*>(data), len};
+        std::vector<std::byte> decoded_buf;
+        if (obj_update_delta_process_packets(buf, addr, decoded_buf)) {
+            buf = decoded_buf;
+        }
+
+        // Validate all packets before any handler runs. Packets are checked against layouts from rfproto.h so
+        // handlers never read outside of the received data.
+        auto source = rf::is_server ? RfPacketSource::client : RfPacketSource::server;
+        size_t error_offset = 0;
+        auto error = rf_validate_game_packets(buf, source, &error_offset);
+        if (error != RfPacketError::none) {
+            char addr_str[64];
+            rf::net_addr_to_string(addr_str, sizeof(addr_str), addr);
+            auto packet_type = error_offset < buf.size() ? static_cast<int>(buf[error_offset]) : -1;
+            xlog::warn("Ignoring packets from {}: {} (type 0x{:x}, offset {})", addr_str,
+                rf_packet_error_str(error), packet_type, error_offset);
+            net_stats_on_recv_dropped(player, packet_type, buf.size());
+            return;
+        }
+        net_stats_begin_processing(player, buf);
+        multi_io_process_packets_hook.call_target(buf.data(), buf.size(), addr, player);
+        net_stats_end_processing();
+    },
+};
+
 CallHook<void(const void*, size_t, const rf::NetAddr&, rf::Player*)> process_unreliable_game_packets_hook{
     0x00479244,
     [](const void* data, size_t len, const rf::NetAddr& addr, rf::Player* player) {
@@ -1218,6 +1365,9 @@ void network_init()
     multi_io_stats_add_hook.install();
     process_unreliable_game_packets_hook.install();
 
+    // Reject malformed packets
+    multi_io_process_packets_hook.install();
+
     // Fix rejecting reliable packets from non-connected clients
     // Fixes players randomly losing connection to the server when some player sends double left game packets
     // when leaving because of missing level file
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <common/rfproto.h>
+#include <common/rfproto-parser.h>
+#include <xlog/xlog.h>
+#include "obj_interest.h"
+#include "obj_update_delta.h"
+#include "server_internal.h"
+#include "../misc/player.h"
+#include "../os/console.h"
+#include "../rf/collide.h"
+#include "../rf/entity.h"
+#include "../rf/geometry.h"
+#include "../rf/level.h"
+#include "../rf/multi.h"
+#include "../rf/player/player.h"
+#include "../rf/os/timer.h"
+
+// Distances are increased by this factor for entities that are currently relevant
+constexpr float distance_hysteresis = 1.25f;
+
+struct ObjInterestStats
+{
+    size_t original_bytes = 0;
+    size_t filtered_bytes = 0;
+    size_t num_objects = 0;
+    size_t num_filtered_objects = 0;
+    size_t num_checks = 0;
+    std::chrono::steady_clock::duration checks_time{};
+    size_t num_passes = 0;
+};
+
+// Rooms connected by portals. Portal data is not known so rooms with touching bounding boxes are treated as
+// connected - it is a conservative approximation. The graph is built when a level is loaded. Rooms created later by
+// geomod are not in the graph - relevance of entities in them is based on distance and visibility.
+class RoomGraph
+{
+public:
+    void build(const rf::GSolid& geometry)
+    {
+        clear();
+        auto& rooms = geometry.all_rooms;
+        constexpr float epsilon = 0.1f;
+        for (int i = 0; i < rooms.size(); ++i) {
+            neighbours_[rooms[i]];
+            for (int j = i + 1; j < rooms.size(); ++j) {
+                const auto& a = *rooms[i];
+                const auto& b = *rooms[j];
+                if (a.bbox_min.x <= b.bbox_max.x + epsilon && b.bbox_min.x <= a.bbox_max.x + epsilon &&
+                    a.bbox_min.y <= b.bbox_max.y + epsilon && b.bbox_min.y <= a.bbox_max.y + epsilon &&
+                    a.bbox_min.z <= b.bbox_max.z + epsilon && b.bbox_min.z <= a.bbox_max.z + epsilon) {
+                    neighbours_[rooms[i]].push_back(rooms[j]);
+                    neighbours_[rooms[j]].push_back(rooms[i]);
+                }
+            }
+        }
+        xlog::debug("Built room graph for {} rooms", rooms.size());
+    }
+
+    void clear()
+    {
+        neighbours_.clear();
+    }
+
+    // Checks if room to can be reached from room from by crossing at most max_depth room boundaries
+    bool is_connected(const rf::GRoom* from, const rf::GRoom* to, int max_depth)
+    {
+        if (from == to) {
+            return true;
+        }
+        visited_.assign(1, from);
+        size_t level_begin = 0;
+        for (int depth = 0; depth < max_depth; ++depth) {
+            size_t level_end = visited_.size();
+            for (size_t i = level_begin; i < level_end; ++i) {
+                auto it = neighbours_.find(visited_[i]);
+                if (it == neighbours_.end()) {
+                    continue;
+                }
+                for (const rf::GRoom* room : it->second) {
+                    if (room == to) {
+                        return true;
+                    }
+                    if (std::find(visited_.begin(), visited_.end(), room) == visited_.end()) {
+                        visited_.push_back(room);
+                    }
+                }
+            }
+            level_begin = level_end;
+        }
+        return false;
+    }
+
+private:
+    std::unordered_map<const rf::GRoom*, std::vector<const rf::GRoom*>> neighbours_;
+    std::vector<const rf::GRoom*> visited_;
+};
+
+static RoomGraph g_room_graph;
+static ObjInterestStats g_obj_interest_stats;
+
+static bool is_flag_carrier(const rf::Entity* entity)
+{
+    if (rf::multi_get_game_type() != rf::NG_TYPE_CTF) {
+        return false;
+    }
+    for (rf::Player* player : {rf::multi_ctf_get_red_flag_player(), rf::multi_ctf_get_blue_flag_player()}) {
+        if (player && player->entity_handle == entity->handle) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_visible(rf::Entity* viewer, rf::Entity* entity)
+{
+    rf::Vector3 p0 = viewer->eye_pos;
+    rf::Vector3 p1 = entity->pos;
+    rf::LevelCollisionOut col_info;
+    col_info.face = nullptr;
+    col_info.obj_handle = -1;
+    bool hit = rf::collide_linesegment_level_for_multi(p0, p1, viewer, entity, &col_info, 0.0f, false, 1.0f);
+    // Other objects do not block the view
+    return !hit || col_info.obj_handle != -1;
+}
+
+static bool is_entity_relevant(rf::Entity* viewer, rf::Entity* entity, bool was_relevant)
+{
+    const auto& config = g_additional_server_config.interest_management;
+    if (entity == viewer || is_flag_carrier(entity)) {
+        return true;
+    }
+    float scale = was_relevant ? distance_hysteresis : 1.0f;
+    float dist = (entity->pos - viewer->eye_pos).len();
+    if (dist < config.always_relevant_distance * scale) {
+        return true;
+    }
+    if (config.max_distance > 0.0f && dist > config.max_distance * scale) {
+        return false;
+    }
+    if (viewer->room && entity->room && g_room_graph.is_connected(viewer->room, entity->room, config.room_depth)) {
+        return true;
+    }
+    return is_visible(viewer, entity);
+}
+
+static bool should_send_obj_update(ObjInterestState& state, rf::Entity* viewer, int handle, int now_ms)
+{
+    rf::Entity* entity = rf::entity_from_handle(handle);
+    if (!entity) {
+        // Filter only entities
+        return true;
+    }
+    return state.should_send(handle, now_ms, [=](bool was_relevant) {
+        auto start = std::chrono::steady_clock::now();
+        bool relevant = is_entity_relevant(viewer, entity, was_relevant);
+        g_obj_interest_stats.checks_time += std::chrono::steady_clock::now() - start;
+        ++g_obj_interest_stats.num_checks;
+        return relevant;
+    });
+}
+
+// Copies obj_update payload skipping objects that should not be sent. Returns false if payload is malformed.
+static bool filter_obj_update(ObjInterestState& state, rf::Entity* viewer, std::span<const std::byte> obj_update,
+                              std::vector<std::byte>& out, int now_ms)
+{
+    RfPacketReader reader{obj_update};
+    while (true) {
+        uint32_t handle = 0;
+        uint8_t flags = 0;
+        size_t obj_offset = reader.pos();
+        if (!reader.read(handle)) {
+            return false;
+        }
+        if (handle == 0xFFFFFFFF) {
+            break;
+        }
+        auto fields_size = reader.read(flags)
+            ? obj_update_get_fields_size(obj_update.subspan(reader.pos()), flags)
+            : std::nullopt;
+        if (!fields_size) {
+            return false;
+        }
+        reader.skip(fields_size.value());
+        ++g_obj_interest_stats.num_objects;
+        if (should_send_obj_update(state, viewer, static_cast<int>(handle), now_ms)) {
+            auto obj_data = obj_update.subspan(obj_offset, reader.pos() - obj_offset);
+            out.insert(out.end(), obj_data.begin(), obj_data.end());
+        }
+        else {
+            ++g_obj_interest_stats.num_filtered_objects;
+        }
+    }
+    uint32_t terminator = 0xFFFFFFFF;
+    auto terminator_bytes = reinterpret_cast<const std::byte*>(&terminator);
+    out.insert(out.end(), terminator_bytes, terminator_bytes + sizeof(terminator));
+    return reader.remaining() == 0;
+}
+
+bool obj_interest_filter_packets(rf::Player* player, std::span<const std::byte> buf, std::vector<std::byte>& out_buf)
+{
+    if (!g_additional_server_config.interest_management.enabled) {
+        return false;
+    }
+    rf::Entity* viewer = rf::entity_from_handle(player->entity_handle);
+    if (!viewer || rf::entity_is_dying(viewer)) {
+        // Dead players and spectators get all updates
+        return false;
+    }
+
+    auto& pdata = get_player_additional_data(player);
+    if (!pdata.interest) {
+        pdata.interest = std::make_unique<ObjInterestState>();
+    }
+    auto& state = *pdata.interest;
+    int now_ms = rf::timer_get_milliseconds();
+    state.prune(now_ms);
+
+    RfGamePacketParser parser{buf, RfPacketSource::server};
+    RfGamePacketView packet;
+    bool has_obj_update = false;
+    out_buf.reserve(buf.size());
+    while (parser.next(packet)) {
+        size_t header_offset = out_buf.size();
+        auto packet_data = buf.subspan(parser.packet_offset(), sizeof(RF_GamePacketHeader) + packet.payload.size());
+        if (packet.type == RF_GPT_OBJECT_UPDATE) {
+            out_buf.insert(out_buf.end(), packet_data.begin(), packet_data.begin() + sizeof(RF_GamePacketHeader));
+            if (!filter_obj_update(state, viewer, packet.payload, out_buf, now_ms)) {
+                return false;
+            }
+            auto size = static_cast<uint16_t>(out_buf.size() - header_offset - sizeof(RF_GamePacketHeader));
+            std::memcpy(&out_buf[header_offset + offsetof(RF_GamePacketHeader, size)], &size, sizeof(size));
+            has_obj_update = true;
+        }
+        else {
+            out_buf.insert(out_buf.end(), packet_data.begin(), packet_data.end());
+        }
+    }
+    if (!has_obj_update || parser.error() != RfPacketError::none) {
+        return false;
+    }
+    ++g_obj_interest_stats.num_passes;
+    g_obj_interest_stats.original_bytes += buf.size();
+    g_obj_interest_stats.filtered_bytes += out_buf.size();
+    return true;
+}
+
+void obj_interest_level_init()
+{
+    g_room_graph.clear();
+    if (rf::is_server && g_additional_server_config.interest_management.enabled && rf::level.geometry) {
+        g_room_graph.build(*rf::level.geometry);
+    }
+}
+
+ConsoleCommand2 obj_interest_cmd{
+    "obj_interest",
+    []() {
+        const auto& config = g_additional_server_config.interest_management;
+        const auto& stats = g_obj_interest_stats;
+        rf::console::print("Area of interest filtering is {}", config.enabled ? "enabled" : "disabled");
+        if (stats.num_passes == 0) {
+            return;
+        }
+        rf::console::print("Object updates: {} bytes per packet instead of {} ({:.1f}%)",
+            stats.filtered_bytes / stats.num_passes, stats.original_bytes / stats.num_passes,
+            stats.filtered_bytes * 100.0 / stats.original_bytes);
+        rf::console::print("Objects removed: {} of {}", stats.num_filtered_objects, stats.num_objects);
+        auto checks_us = std::chrono::duration_cast<std::chrono::microseconds>(stats.checks_time).count();
+        rf::console::print("Relevance checks: {}, {:.2f} us per check, {:.2f} us per packet", stats.num_checks,
+            static_cast<double>(checks_us) / std::max<size_t>(stats.num_checks, 1),
+            static_cast<double>(checks_us) / stats.num_passes);
+    },
+    "Prints statistics of area of interest filtering of object updates",
+};
+
+void obj_interest_do_patch()
+{
+    obj_interest_cmd.register_cmd();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "obj_interest_state.h"
+
+// Forward declarations
+namespace rf
+{
+    struct Player;
+}
+
+// Area of interest filtering of object updates. Server removes entities that are not relevant for a player from
+// obj_update packets sent to that player. An entity is relevant if it is close to the player, if its room is
+// connected with the player room or if the player can see it. CTF flag carriers are always relevant. Relevance is
+// re-evaluated periodically and an entity stays relevant for some time after it stopped being relevant so it does not
+// pop in and out when the player moves around a corner. When an entity leaves relevance its latest state is sent once
+// more and then refreshed at a low rate, so clients do not keep it frozen where it was last seen (see
+// ObjInterestState).
+
+void obj_interest_do_patch();
+// Rebuilds the room graph of the loaded level
+void obj_interest_level_init();
+// Removes irrelevant entities from obj_update packets in a buffer sent to the player. If the buffer contains any
+// obj_update packet, the new buffer is stored in out_buf and true is returned.
+bool obj_interest_filter_packets(rf::Player* player, std::span<const std::byte> buf, std::vector<std::byte>& out_buf);
@@ -0,0 +1,12 @@
+#include "obj_interest_state.h"
+
+void ObjInterestState::prune(int now_ms)
+{
+    if (now_ms - next_prune_ms_ < 0) {
+        return;
+    }
+    next_prune_ms_ = now_ms + obj_interest_prune_interval_ms;
+    std::erase_if(entities_, [=](const auto& p) {
+        return now_ms - p.second.last_update_ms > obj_interest_prune_interval_ms;
+    });
+}
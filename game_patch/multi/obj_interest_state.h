@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+
+// Per-client bookkeeping of area of interest filtering (see obj_interest.h). It decides when relevance of an entity is
+// re-evaluated and if its update is sent. The relevance check itself is done by the caller, so this code does not
+// depend on the game and can be tested natively.
+
+// How often relevance of an entity is checked
+constexpr int obj_interest_check_interval_ms = 250;
+// How long an entity stays relevant after it stopped being relevant
+constexpr int obj_interest_linger_ms = 1500;
+// How often an update of an irrelevant entity is sent, so it does not stay frozen on the client forever
+constexpr int obj_interest_refresh_interval_ms = 1000;
+// Entities without updates for this time are forgotten
+constexpr int obj_interest_prune_interval_ms = 5000;
+
+struct ObjInterestEntry
+{
+    bool relevant = true;
+    std::optional<int> next_check_ms;
+    int relevant_until_ms = 0;
+    int last_update_ms = 0;
+    int next_refresh_ms = 0;
+};
+
+class ObjInterestState
+{
+public:
+    // Returns true if an update of the entity should be sent. is_relevant(bool was_relevant) is called when relevance
+    // has to be re-evaluated - was_relevant allows using bigger distances for entities that are currently relevant.
+    // When an entity stops being relevant, its update is sent once more, so the client gets its latest state, and
+    // then once per obj_interest_refresh_interval_ms.
+    template<typename F>
+    bool should_send(int handle, int now_ms, F&& is_relevant)
+    {
+        auto& entry = entities_[handle];
+        entry.last_update_ms = now_ms;
+        if (!entry.next_check_ms || now_ms - entry.next_check_ms.value() >= 0) {
+            entry.next_check_ms = now_ms + obj_interest_check_interval_ms;
+            bool was_relevant = now_ms - entry.relevant_until_ms < 0;
+            if (is_relevant(was_relevant)) {
+                entry.relevant_until_ms = now_ms + obj_interest_linger_ms;
+            }
+            bool relevant = now_ms - entry.relevant_until_ms < 0;
+            if (entry.relevant && !relevant) {
+                entry.relevant = false;
+                entry.next_refresh_ms = now_ms + obj_interest_refresh_interval_ms;
+                return true;
+            }
+            entry.relevant = relevant;
+        }
+        if (entry.relevant) {
+            return true;
+        }
+        if (now_ms - entry.next_refresh_ms >= 0) {
+            entry.next_refresh_ms = now_ms + obj_interest_refresh_interval_ms;
+            return true;
+        }
+        return false;
+    }
+
+    // Forgets entities that were not in any update recently (e.g. destroyed ones)
+    void prune(int now_ms);
+
+    [[nodiscard]] size_t size() const
+    {
+        return entities_.size();
+    }
+
+private:
+    // key is entity handle
+    std::unordered_map<int, ObjInterestEntry> entities_;
+    int next_prune_ms_ = 0;
+};
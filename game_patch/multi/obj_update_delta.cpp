@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <common/rfproto.h>
+#include <common/rfproto-parser.h>
+#include <xlog/xlog.h>
+#include "obj_update_delta.h"
+#include "df_packets.h"
+#include "multi.h"
+#include "server_internal.h"
+#include "../misc/player.h"
+#include "../os/console.h"
+#include "../rf/multi.h"
+#include "../rf/level.h"
+#include "../rf/geometry.h"
+#include "../rf/player/player.h"
+
+struct ObjUpdateDeltaStats
+{
+    size_t original_bytes = 0;
+    size_t encoded_bytes = 0;
+};
+
+static ObjUpdateDeltaDecoder g_obj_update_delta_decoder;
+static std::chrono::steady_clock::time_point g_last_opt_in_time;
+static ObjUpdateDeltaStats g_obj_update_delta_stats;
+
+static bool is_obj_update_delta_supported_by_server()
+{
+    const auto& server_info = get_df_server_info();
+    return server_info && server_info.value().obj_update_delta;
+}
+
+static std::optional<PositionQuantizer> get_position_quantizer(float precision)
+{
+    if (precision <= 0.0f || !rf::level.geometry) {
+        return {};
+    }
+    PositionQuantizer quantizer{rf::level.geometry->bbox_min, rf::level.geometry->bbox_max, precision};
+    if (!quantizer.is_valid()) {
+        return {};
+    }
+    return {quantizer};
+}
+
+static void send_obj_update_ack(uint16_t seq, uint32_t received_bits)
+{
+    df_obj_update_ack_packet packet;
+    packet.header.type = static_cast<uint8_t>(df_packet_type::obj_update_ack);
+    packet.header.size = sizeof(packet) - sizeof(packet.header);
+    packet.seq = seq;
+    packet.received_bits = received_bits;
+    rf::net_send(rf::netgame.server_addr, &packet, sizeof(packet));
+}
+
+static void process_obj_update_ack_packet(std::span<const std::byte> payload, const rf::NetAddr& addr)
+{
+    rf::Player* player = rf::multi_find_player_by_addr(addr);
+    if (!player || !g_additional_server_config.obj_update_delta) {
+        return;
+    }
+    RfPacketReader reader{payload};
+    uint16_t seq = 0;
+    uint32_t received_bits = 0;
+    if (!reader.read(seq) || !reader.read(received_bits)) {
+        return;
+    }
+    auto& pdata = get_player_additional_data(player);
+    if (!pdata.obj_update_delta) {
+        xlog::debug("Enabling obj_update delta compression for {}", player->name);
+        pdata.obj_update_delta = std::make_unique<ObjUpdateDeltaEncoder>();
+    }
+    pdata.obj_update_delta->process_ack(seq, received_bits);
+}
+
+bool obj_update_delta_process_packets(std::span<const std::byte> buf, const rf::NetAddr& addr,
+                                      std::vector<std::byte>& out_buf)
+{
+    bool from_server = !rf::is_server && addr == rf::netgame.server_addr;
+    RfGamePacketParser parser{buf, rf::is_server ? RfPacketSource::client : RfPacketSource::server};
+    RfGamePacketView packet;
+    bool buf_changed = false;
+    bool received_delta = false;
+    bool received_legacy = false;
+    std::optional<PositionQuantizer> quantizer;
+    while (parser.next(packet)) {
+        auto packet_data = buf.subspan(parser.packet_offset(), sizeof(RF_GamePacketHeader) + packet.payload.size());
+        if (packet.type == static_cast<uint8_t>(df_packet_type::obj_update_ack) && rf::is_server) {
+            process_obj_update_ack_packet(packet.payload, addr);
+        }
+        else if (packet.type == static_cast<uint8_t>(df_packet_type::obj_update_delta) && from_server) {
+            if (!buf_changed) {
+                out_buf.assign(buf.begin(), buf.begin() + parser.packet_offset());
+                buf_changed = true;
+            }
+            const auto& server_info = get_df_server_info();
+            if (!quantizer && server_info) {
+                quantizer = get_position_quantizer(server_info.value().obj_update_pos_precision);
+            }
+            // Packets that cannot be decoded are dropped
+            auto quantizer_ptr = quantizer ? &quantizer.value() : nullptr;
+            if (g_obj_update_delta_decoder.decode(packet.payload, out_buf, quantizer_ptr)) {
+                received_delta = true;
+            }
+            continue;
+        }
+        else if (packet.type == RF_GPT_OBJECT_UPDATE && from_server) {
+            received_legacy = true;
+        }
+        if (buf_changed) {
+            out_buf.insert(out_buf.end(), packet_data.begin(), packet_data.end());
+        }
+    }
+    if (parser.error() != RfPacketError::none) {
+        // Let the validation reject the buffer
+        return false;
+    }
+
+    if (received_delta) {
+        send_obj_update_ack(g_obj_update_delta_decoder.get_last_seq(), g_obj_update_delta_decoder.get_received_bits());
+    }
+    else if (received_legacy && !g_obj_update_delta_decoder.has_received() &&
+        is_obj_update_delta_supported_by_server()) {
+        // Ask server to use delta compression. It is repeated because the packet can be lost.
+        auto now = std::chrono::steady_clock::now();
+        if (now - g_last_opt_in_time > std::chrono::seconds{1}) {
+            g_last_opt_in_time = now;
+            send_obj_update_ack(0, 0);
+        }
+    }
+    return buf_changed;
+}
+
+void obj_update_delta_reset_client()
+{
+    g_obj_update_delta_decoder.reset();
+    g_last_opt_in_time = {};
+}
+
+static bool encode_obj_update_packets(ObjUpdateDeltaEncoder& encoder, std::span<const std::byte> buf,
+                                      std::vector<std::byte>& out_buf, const PositionQuantizer* quantizer)
+{
+    RfGamePacketParser parser{buf, RfPacketSource::server};
+    RfGamePacketView packet;
+    bool has_obj_update = false;
+    while (parser.next(packet)) {
+        if (packet.type == RF_GPT_OBJECT_UPDATE) {
+            if (!encoder.encode(packet.payload, out_buf, quantizer)) {
+                return false;
+            }
+            has_obj_update = true;
+        }
+        else {
+            auto packet_size = sizeof(RF_GamePacketHeader) + packet.payload.size();
+            auto packet_data = buf.subspan(parser.packet_offset(), packet_size);
+            out_buf.insert(out_buf.end(), packet_data.begin(), packet_data.end());
+        }
+    }
+    return has_obj_update && parser.error() == RfPacketError::none;
+}
+
+bool obj_update_delta_encode_packets(rf::Player* player, std::span<const std::byte> buf,
+                                     std::vector<std::byte>& out_buf)
+{
+    if (!g_additional_server_config.obj_update_delta) {
+        return false;
+    }
+    auto& pdata = get_player_additional_data(player);
+    if (!pdata.obj_update_delta || !pdata.obj_update_delta->is_enabled()) {
+        return false;
+    }
+    out_buf.reserve(buf.size());
+    auto quantizer = get_position_quantizer(g_additional_server_config.obj_update_pos_precision);
+    if (!encode_obj_update_packets(*pdata.obj_update_delta, buf, out_buf, quantizer ? &quantizer.value() : nullptr)) {
+        return false;
+    }
+    if (out_buf.size() > std::max(buf.size(), rf::max_packet_size)) {
+        // Objects that are not delta-encoded take one byte more than in obj_update packet - send the original buffer
+        // so the datagram does not exceed the maximal size. The client treats skipped sequence number as a lost packet.
+        return false;
+    }
+    g_obj_update_delta_stats.original_bytes += buf.size();
+    g_obj_update_delta_stats.encoded_bytes += out_buf.size();
+    return true;
+}
+
+ConsoleCommand2 obj_update_delta_cmd{
+    "obj_update_delta",
+    []() {
+        if (!rf::is_server) {
+            rf::console::print("Delta compression of object updates is {} by the server",
+                is_obj_update_delta_supported_by_server() ? "supported" : "not supported");
+            return;
+        }
+        const auto& stats = g_obj_update_delta_stats;
+        rf::console::print("Delta compression of object updates is {}",
+            g_additional_server_config.obj_update_delta ? "enabled" : "disabled");
+        if (auto quantizer = get_position_quantizer(g_additional_server_config.obj_update_pos_precision)) {
+            rf::console::print("Positions are quantized to {} ({} bytes)",
+                g_additional_server_config.obj_update_pos_precision, quantizer.value().get_encoded_size());
+        }
+        if (stats.original_bytes > 0) {
+            rf::console::print("Sent {} bytes instead of {} bytes ({:.1f}%)", stats.encoded_bytes,
+                stats.original_bytes, stats.encoded_bytes * 100.0 / stats.original_bytes);
+        }
+    },
+    "Prints statistics of delta compression of object updates",
+};
+
+void obj_update_delta_do_patch()
+{
+    obj_update_delta_cmd.register_cmd();
+}
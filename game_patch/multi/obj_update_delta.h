@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "obj_update_delta_codec.h"
+
+// Forward declarations
+namespace rf
+{
+    struct Player;
+    struct NetAddr;
+}
+
+void obj_update_delta_do_patch();
+// Handles Dash Faction packets related to delta compression in a buffer passed to multi_io_process_packets. If the
+// buffer has to be changed before the game processes it, the new buffer is stored in out_buf and true is returned.
+bool obj_update_delta_process_packets(std::span<const std::byte> buf, const rf::NetAddr& addr,
+                                      std::vector<std::byte>& out_buf);
+void obj_update_delta_reset_client();
+// Converts obj_update packets in a buffer sent to the player to obj_update_delta packets if the player acknowledges
+// them. The new buffer is stored in out_buf and true is returned if anything was converted.
+bool obj_update_delta_encode_packets(rf::Player* player, std::span<const std::byte> buf,
+                                     std::vector<std::byte>& out_buf);
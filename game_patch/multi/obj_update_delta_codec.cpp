@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <cstring>
+#include <common/rfproto.h>
+#include <common/rfproto-parser.h>
+#include <xlog/xlog.h>
+#include "obj_update_delta_codec.h"
+#include "df_packets.h"
+
+// Fields of an object in obj_update packet in the order they are stored (see RF_ObjectUpdate)
+struct ObjUpdateField
+{
+    uint8_t flag;
+    uint8_t size; // 0 for variable size
+};
+
+// clang-format off
+constexpr std::array<ObjUpdateField, 9> obj_update_fields{{
+    {RF_OUF_POS_ROT_ANIM, 2},  // ticks
+    {RF_OUF_POS_ROT_ANIM, 12}, // position
+    {RF_OUF_POS_ROT_ANIM, 4},  // angles
+    {RF_OUF_POS_ROT_ANIM, 4},  // state flags and movement
+    {RF_OUF_AMP_FLAGS, 1},
+    {RF_OUF_WEAPON_TYPE, 1},
+    {RF_OUF_HEATH_ARMOR, 3},
+    {RF_OUF_UNKNOWN3, 0},      // count and count * 3 bytes
+    {RF_OUF_UNKNOWN4, 2},
+}};
+// clang-format on
+
+// Index of position in obj_update_fields
+constexpr size_t obj_update_pos_field = 1;
+
+using ObjUpdateFieldSpans = std::array<std::span<const std::byte>, obj_update_fields.size()>;
+
+static size_t get_field_size(const ObjUpdateField& field, std::span<const std::byte> data)
+{
+    if (field.size) {
+        return field.size;
+    }
+    if (data.empty()) {
+        return 1;
+    }
+    return 1 + 3 * static_cast<size_t>(data[0]);
+}
+
+// Splits data starting with object fields into individual fields. Returns total size of the fields.
+static std::optional<size_t> split_obj_update_fields(std::span<const std::byte> data, uint8_t flags,
+                                                     ObjUpdateFieldSpans& fields)
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < obj_update_fields.size(); ++i) {
+        fields[i] = {};
+        if (!(flags & obj_update_fields[i].flag)) {
+            continue;
+        }
+        size_t size = get_field_size(obj_update_fields[i], data.subspan(offset));
+        if (data.size() - offset < size) {
+            return {};
+        }
+        fields[i] = data.subspan(offset, size);
+        offset += size;
+    }
+    return {offset};
+}
+
+std::optional<size_t> obj_update_get_fields_size(std::span<const std::byte> data, uint8_t flags)
+{
+    ObjUpdateFieldSpans fields;
+    return split_obj_update_fields(data, flags, fields);
+}
+
+static size_t count_obj_update_fields(uint8_t flags)
+{
+    return std::count_if(obj_update_fields.begin(), obj_update_fields.end(),
+        [=](const ObjUpdateField& field) { return (flags & field.flag) != 0; });
+}
+
+// True if sequence number a is more recent than b
+static bool is_seq_newer(uint16_t a, uint16_t b)
+{
+    return static_cast<int16_t>(a - b) > 0;
+}
+
+template<typename T>
+static void append(std::vector<std::byte>& buf, const T& value)
+{
+    auto bytes = reinterpret_cast<const std::byte*>(&value);
+    buf.insert(buf.end(), bytes, bytes + sizeof(value));
+}
+
+static void append_bytes(std::vector<std::byte>& buf, std::span<const std::byte> data)
+{
+    buf.insert(buf.end(), data.begin(), data.end());
+}
+
+static void set_packet_size(std::vector<std::byte>& buf, size_t header_offset)
+{
+    auto size = static_cast<uint16_t>(buf.size() - header_offset - sizeof(RF_GamePacketHeader));
+    std::memcpy(buf.data() + header_offset + offsetof(RF_GamePacketHeader, size), &size, sizeof(size));
+}
+
+void ObjUpdateSnapshot::reset(uint16_t new_seq)
+{
+    seq = new_seq;
+    valid = true;
+    acked = false;
+    objects_.clear();
+    data_.clear();
+}
+
+void ObjUpdateSnapshot::add_object(uint32_t handle, uint8_t flags, std::span<const std::byte> fields)
+{
+    auto offset = static_cast<uint16_t>(data_.size());
+    objects_.push_back({handle, flags, offset, static_cast<uint16_t>(fields.size())});
+    append_bytes(data_, fields);
+}
+
+const ObjUpdateSnapshot::Object* ObjUpdateSnapshot::find(uint32_t handle) const
+{
+    auto it = std::find_if(objects_.begin(), objects_.end(), [=](const Object& obj) { return obj.handle == handle; });
+    return it != objects_.end() ? &*it : nullptr;
+}
+
+std::span<const std::byte> ObjUpdateSnapshot::get_fields(const Object& obj) const
+{
+    return std::span{data_}.subspan(obj.offset, obj.size);
+}
+
+bool ObjUpdateDeltaEncoder::encode(std::span<const std::byte> obj_update, std::vector<std::byte>& out,
+                                   const PositionQuantizer* quantizer)
+{
+    uint16_t seq = next_seq_;
+    auto& snapshot = sent_[seq % sent_.size()];
+    snapshot.reset(seq);
+
+    size_t header_offset = out.size();
+    append(out, RF_GamePacketHeader{static_cast<uint8_t>(df_packet_type::obj_update_delta), 0});
+    append(out, seq);
+    size_t count_offset = out.size();
+    append(out, uint8_t{0});
+
+    RfPacketReader reader{obj_update};
+    uint8_t object_count = 0;
+    while (true) {
+        uint32_t handle = 0;
+        uint8_t flags = 0;
+        if (!reader.read(handle)) {
+            snapshot.valid = false;
+            return false;
+        }
+        if (handle == 0xFFFFFFFF) {
+            break;
+        }
+        ObjUpdateFieldSpans fields;
+        auto rest = obj_update.subspan(reader.pos() + sizeof(flags));
+        auto fields_size = reader.read(flags) ? split_obj_update_fields(rest, flags, fields) : std::nullopt;
+        if (!fields_size || object_count == UINT8_MAX) {
+            snapshot.valid = false;
+            return false;
+        }
+        reader.skip(fields_size.value());
+        ++object_count;
+
+        // Fields as seen by the client - quantized position is replaced by its dequantized value
+        auto obj_fields = rest.first(fields_size.value());
+        std::array<std::byte, PositionQuantizer::max_encoded_size> quantized_pos;
+        uint8_t encoding = 0;
+        if (quantizer && (flags & RF_OUF_POS_ROT_ANIM)) {
+            rf::Vector3 pos;
+            rf::Vector3 dequantized_pos;
+            std::memcpy(&pos, fields[obj_update_pos_field].data(), sizeof(pos));
+            if (quantizer->quantize(pos, quantized_pos, dequantized_pos)) {
+                auto pos_offset = fields[obj_update_pos_field].data() - obj_fields.data();
+                obj_fields_buf_.assign(obj_fields.begin(), obj_fields.end());
+                std::memcpy(obj_fields_buf_.data() + pos_offset, &dequantized_pos, sizeof(dequantized_pos));
+                obj_fields = obj_fields_buf_;
+                split_obj_update_fields(obj_fields, flags, fields);
+                encoding |= obj_update_delta_quantized_pos;
+            }
+        }
+        auto get_sent_field = [&](size_t i) {
+            if (i == obj_update_pos_field && (encoding & obj_update_delta_quantized_pos)) {
+                return std::span<const std::byte>{quantized_pos}.first(quantizer->get_encoded_size());
+            }
+            return fields[i];
+        };
+        size_t full_size = 0;
+        for (size_t i = 0; i < obj_update_fields.size(); ++i) {
+            full_size += get_sent_field(i).size();
+        }
+
+        append(out, handle);
+        append(out, flags);
+
+        const ObjUpdateSnapshot* baseline = find_baseline(handle, seq);
+        const ObjUpdateSnapshot::Object* base_obj = baseline ? baseline->find(handle) : nullptr;
+        ObjUpdateFieldSpans base_fields;
+        std::array<std::byte, (obj_update_fields.size() + 7) / 8> sent_fields{};
+        size_t sent_fields_bytes = (count_obj_update_fields(flags) + 7) / 8;
+        bool use_delta = false;
+        if (base_obj && split_obj_update_fields(baseline->get_fields(*base_obj), base_obj->flags, base_fields)) {
+            // Send only fields that differ from the baseline
+            size_t delta_size = sent_fields_bytes;
+            size_t field_index = 0;
+            for (size_t i = 0; i < obj_update_fields.size(); ++i) {
+                if (!(flags & obj_update_fields[i].flag)) {
+                    continue;
+                }
+                bool same = base_fields[i].size() == fields[i].size() &&
+                    std::equal(fields[i].begin(), fields[i].end(), base_fields[i].begin());
+                if (!same) {
+                    sent_fields[field_index / 8] |= std::byte{1} << (field_index % 8);
+                    delta_size += get_sent_field(i).size();
+                }
+                ++field_index;
+            }
+            use_delta = delta_size < full_size;
+        }
+        if (use_delta) {
+            append(out, static_cast<uint8_t>(encoding | static_cast<uint8_t>(seq - baseline->seq)));
+            append_bytes(out, std::span{sent_fields}.first(sent_fields_bytes));
+        }
+        else {
+            // Send all fields
+            append(out, encoding);
+        }
+        size_t field_index = 0;
+        for (size_t i = 0; i < obj_update_fields.size(); ++i) {
+            if (!(flags & obj_update_fields[i].flag)) {
+                continue;
+            }
+            if (!use_delta || (sent_fields[field_index / 8] & (std::byte{1} << (field_index % 8))) != std::byte{0}) {
+                append_bytes(out, get_sent_field(i));
+            }
+            ++field_index;
+        }
+        snapshot.add_object(handle, flags, obj_fields);
+    }
+    if (reader.remaining() > 0) {
+        snapshot.valid = false;
+        return false;
+    }
+
+    out[count_offset] = static_cast<std::byte>(object_count);
+    set_packet_size(out, header_offset);
+    ++next_seq_;
+
+    // Forget objects that cannot be used as a baseline anymore
+    if (seq % ObjUpdateSnapshot::ring_size == 0) {
+        std::erase_if(acked_seqs_, [=](const auto& p) {
+            return static_cast<uint16_t>(seq - p.second) >= ObjUpdateSnapshot::ring_size;
+        });
+    }
+    return true;
+}
+
+const ObjUpdateSnapshot* ObjUpdateDeltaEncoder::find_baseline(uint32_t handle, uint16_t seq)
+{
+    auto it = acked_seqs_.find(handle);
+    if (it == acked_seqs_.end()) {
+        return nullptr;
+    }
+    uint16_t baseline_seq = it->second;
+    uint16_t age = seq - baseline_seq;
+    const auto& snapshot = sent_[baseline_seq % sent_.size()];
+    if (age == 0 || age >= sent_.size() || !snapshot.valid || snapshot.seq != baseline_seq) {
+        return nullptr;
+    }
+    return &snapshot;
+}
+
+void ObjUpdateDeltaEncoder::process_ack(uint16_t seq, uint32_t received_bits)
+{
+    enabled_ = true;
+    for (unsigned i = 0; i < 32; ++i) {
+        if (received_bits & (1u << i)) {
+            ack_snapshot(static_cast<uint16_t>(seq - i));
+        }
+    }
+}
+
+void ObjUpdateDeltaEncoder::ack_snapshot(uint16_t seq)
+{
+    auto& snapshot = sent_[seq % sent_.size()];
+    uint16_t age = next_seq_ - seq;
+    if (age == 0 || age > sent_.size() || !snapshot.valid || snapshot.seq != seq || snapshot.acked) {
+        return;
+    }
+    snapshot.acked = true;
+    for (const auto& obj : snapshot.objects()) {
+        auto [it, inserted] = acked_seqs_.try_emplace(obj.handle, seq);
+        if (!inserted && is_seq_newer(seq, it->second)) {
+            it->second = seq;
+        }
+    }
+}
+
+bool ObjUpdateDeltaDecoder::decode(std::span<const std::byte> obj_update_delta, std::vector<std::byte>& out,
+                                   const PositionQuantizer* quantizer)
+{
+    RfPacketReader reader{obj_update_delta};
+    uint16_t seq = 0;
+    uint8_t object_count = 0;
+    if (!reader.read(seq) || !reader.read(object_count)) {
+        return false;
+    }
+    if (has_received_ && static_cast<int16_t>(seq - last_seq_) <= -static_cast<int>(received_.size())) {
+        // Too old
+        return false;
+    }
+    auto& snapshot = received_[seq % received_.size()];
+    if (snapshot.valid && snapshot.seq == seq) {
+        // Duplicate
+        return false;
+    }
+    snapshot.reset(seq);
+    // Other packets from the same datagram may already be in the output buffer - on failure only the partially
+    // decoded obj_update packet is removed so they are still processed
+    size_t header_offset = out.size();
+    auto fail = [&]() {
+        snapshot.valid = false;
+        out.resize(header_offset);
+        return false;
+    };
+    append(out, RF_GamePacketHeader{RF_GPT_OBJECT_UPDATE, 0});
+    for (int obj_index = 0; obj_index < object_count; ++obj_index) {
+        uint32_t handle = 0;
+        uint8_t flags = 0;
+        uint8_t encoding = 0;
+        if (!reader.read(handle) || !reader.read(flags) || !reader.read(encoding)) {
+            return fail();
+        }
+        uint8_t baseline_age = encoding & obj_update_delta_baseline_age_mask;
+        bool quantized_pos = (encoding & obj_update_delta_quantized_pos) != 0;
+        if ((encoding & ~(obj_update_delta_baseline_age_mask | obj_update_delta_quantized_pos)) ||
+            (quantized_pos && (!quantizer || !quantizer->is_valid()))) {
+            return fail();
+        }
+        append(out, handle);
+        append(out, flags);
+        size_t fields_offset = out.size();
+
+        const ObjUpdateSnapshot::Object* base_obj = nullptr;
+        ObjUpdateFieldSpans base_fields;
+        std::array<std::byte, (obj_update_fields.size() + 7) / 8> sent_fields{};
+        if (baseline_age) {
+            uint16_t baseline_seq = seq - baseline_age;
+            const auto& baseline = received_[baseline_seq % received_.size()];
+            base_obj = baseline.valid && baseline.seq == baseline_seq ? baseline.find(handle) : nullptr;
+            if (!base_obj || !split_obj_update_fields(baseline.get_fields(*base_obj), base_obj->flags, base_fields)) {
+                xlog::trace("Missing baseline {} for object {:x} in obj_update_delta {}", baseline_seq, handle, seq);
+                return fail();
+            }
+            size_t sent_fields_bytes = (count_obj_update_fields(flags) + 7) / 8;
+            auto sent_fields_data = obj_update_delta.subspan(reader.pos());
+            if (!reader.skip(sent_fields_bytes)) {
+                return fail();
+            }
+            std::copy_n(sent_fields_data.begin(), sent_fields_bytes, sent_fields.begin());
+        }
+        size_t field_index = 0;
+        for (size_t i = 0; i < obj_update_fields.size(); ++i) {
+            if (!(flags & obj_update_fields[i].flag)) {
+                continue;
+            }
+            auto field_bit = std::byte{1} << (field_index % 8);
+            bool sent = !base_obj || (sent_fields[field_index / 8] & field_bit) != std::byte{0};
+            ++field_index;
+            if (!sent) {
+                if (!(base_obj->flags & obj_update_fields[i].flag)) {
+                    return fail();
+                }
+                append_bytes(out, base_fields[i]);
+                continue;
+            }
+            auto data = obj_update_delta.subspan(reader.pos());
+            if (i == obj_update_pos_field && quantized_pos) {
+                if (!reader.skip(quantizer->get_encoded_size())) {
+                    return fail();
+                }
+                append(out, quantizer->dequantize(data));
+                continue;
+            }
+            size_t size = get_field_size(obj_update_fields[i], data);
+            if (!reader.skip(size)) {
+                return fail();
+            }
+            append_bytes(out, data.first(size));
+        }
+        snapshot.add_object(handle, flags, std::span{out}.subspan(fields_offset));
+    }
+    append(out, uint32_t{0xFFFFFFFF});
+    set_packet_size(out, header_offset);
+    mark_received(seq);
+    return true;
+}
+
+void ObjUpdateDeltaDecoder::mark_received(uint16_t seq)
+{
+    if (!has_received_) {
+        has_received_ = true;
+        last_seq_ = seq;
+        received_bits_ = 1;
+        return;
+    }
+    int diff = static_cast<int16_t>(seq - last_seq_);
+    if (diff > 0) {
+        received_bits_ = (diff < 32 ? received_bits_ << diff : 0) | 1;
+        last_seq_ = seq;
+    }
+    else if (diff > -32) {
+        received_bits_ |= 1u << -diff;
+    }
+}
+
+void ObjUpdateDeltaDecoder::reset()
+{
+    has_received_ = false;
+    last_seq_ = 0;
+    received_bits_ = 0;
+    for (auto& snapshot : received_) {
+        snapshot.valid = false;
+    }
+}
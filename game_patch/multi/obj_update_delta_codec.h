@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "position_quantizer.h"
+
+// Delta compression of obj_update packets sent by the server. Every object in an update is encoded against the last
+// state of the same object that the client has acknowledged - fields that did not change are not sent. Clients opt in
+// by acknowledging updates (df_obj_update_ack_packet) after the server announces support in join_accept packet.
+// Other clients receive normal obj_update packets. Decoding restores the original obj_update packet, so the game code
+// processes the same data. The only difference are positions - they are quantized to a fixed step inside of the level
+// bounding box (see PositionQuantizer) and clients get positions rounded to that step.
+
+// Objects from a single obj_update packet in the original format
+class ObjUpdateSnapshot
+{
+public:
+    struct Object
+    {
+        uint32_t handle;
+        uint8_t flags;
+        uint16_t offset; // offset of object fields in data
+        uint16_t size;
+    };
+
+    static constexpr size_t ring_size = 32;
+
+    uint16_t seq = 0;
+    bool valid = false;
+    bool acked = false;
+
+    void reset(uint16_t new_seq);
+    void add_object(uint32_t handle, uint8_t flags, std::span<const std::byte> fields);
+    [[nodiscard]] const Object* find(uint32_t handle) const;
+    [[nodiscard]] std::span<const std::byte> get_fields(const Object& obj) const;
+
+    [[nodiscard]] const std::vector<Object>& objects() const
+    {
+        return objects_;
+    }
+
+private:
+    std::vector<Object> objects_;
+    std::vector<std::byte> data_;
+};
+
+// Server-side state kept for every client
+class ObjUpdateDeltaEncoder
+{
+public:
+    // Converts obj_update packet payload to obj_update_delta packet (with header). Positions are quantized if
+    // quantizer is provided. Returns false if the payload could not be parsed.
+    bool encode(std::span<const std::byte> obj_update, std::vector<std::byte>& out,
+                const PositionQuantizer* quantizer);
+    void process_ack(uint16_t seq, uint32_t received_bits);
+
+    [[nodiscard]] bool is_enabled() const
+    {
+        return enabled_;
+    }
+
+private:
+    bool enabled_ = false;
+    uint16_t next_seq_ = 0;
+    std::array<ObjUpdateSnapshot, ObjUpdateSnapshot::ring_size> sent_;
+    // The most recent acknowledged seq containing the object
+    std::unordered_map<uint32_t, uint16_t> acked_seqs_;
+    std::vector<std::byte> obj_fields_buf_;
+
+    void ack_snapshot(uint16_t seq);
+    const ObjUpdateSnapshot* find_baseline(uint32_t handle, uint16_t seq);
+};
+
+// Client-side state
+class ObjUpdateDeltaDecoder
+{
+public:
+    // Converts obj_update_delta packet payload to obj_update packet (with header) appended to out. Returns false if
+    // the packet is malformed or its baseline is not available - out is left unchanged in that case. Quantizer must
+    // be provided if the packet has quantized positions.
+    bool decode(std::span<const std::byte> obj_update_delta, std::vector<std::byte>& out,
+                const PositionQuantizer* quantizer);
+    void reset();
+
+    [[nodiscard]] bool has_received() const
+    {
+        return has_received_;
+    }
+
+    [[nodiscard]] uint16_t get_last_seq() const
+    {
+        return last_seq_;
+    }
+
+    [[nodiscard]] uint32_t get_received_bits() const
+    {
+        return received_bits_;
+    }
+
+private:
+    bool has_received_ = false;
+    uint16_t last_seq_ = 0;
+    uint32_t received_bits_ = 0;
+    std::array<ObjUpdateSnapshot, ObjUpdateSnapshot::ring_size> received_;
+
+    void mark_received(uint16_t seq);
+};
+
+// Returns size of object fields in obj_update packet (data starts after object flags) or nothing if data is truncated
+std::optional<size_t> obj_update_get_fields_size(std::span<const std::byte> data, uint8_t flags);
@@ -0,0 +1,130 @@
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <patch_common/FunHook.h>
+#include <xlog/xlog.h>
+#include "packet_capture.h"
+#include "packet_trace.h"
+#include "../os/console.h"
+#include "../rf/multi.h"
+
+static PacketTraceAddr to_trace_addr(const rf::NetAddr& addr)
+{
+    return {addr.ip_addr, addr.port};
+}
+
+static void replay_handler(const TraceRecord& record)
+{
+    rf::NetAddr addr{record.addr.ip_addr, record.addr.port};
+    // Players are created by replayed join requests so they can be found by the address from the trace
+    rf::Player* player = rf::multi_find_player_by_addr(addr);
+    rf::multi_io_process_packets(record.data.data(), record.data.size(), addr, player);
+}
+
+static std::optional<PacketTraceWriter> g_capture_writer;
+static std::optional<PacketReplay> g_replay;
+
+void packet_capture_on_recv(const void* data, size_t len, const rf::NetAddr& addr)
+{
+    if (g_capture_writer && !g_replay) {
+        g_capture_writer.value().write_recv(data, len, to_trace_addr(addr));
+    }
+}
+
+FunHook<int(const void*, unsigned, int, const rf::NetAddr*, int)> net_send_packet_hook{
+    0x00528820,
+    [](const void* packet, unsigned packet_len, int flags, const rf::NetAddr* addr, int packet_kind) {
+        if (g_replay && g_replay.value().is_trace_addr(to_trace_addr(*addr))) {
+            // Do not send anything to addresses from the trace
+            g_replay.value().on_send(packet_len);
+            return static_cast<int>(packet_len);
+        }
+        if (g_capture_writer) {
+            g_capture_writer.value().write_send(packet, packet_len, to_trace_addr(*addr),
+                static_cast<uint8_t>(packet_kind));
+        }
+        return net_send_packet_hook.call_target(packet, packet_len, flags, addr, packet_kind);
+    },
+};
+
+static void stop_replay()
+{
+    for (const auto& line : g_replay.value().get_stats()) {
+        rf::console::print("{}", line);
+    }
+    g_replay.reset();
+}
+
+void packet_capture_do_frame()
+{
+    if (g_replay && !g_replay.value().process()) {
+        stop_replay();
+    }
+}
+
+ConsoleCommand2 packet_capture_cmd{
+    "packet_capture",
+    [](std::optional<std::string> filename_opt) {
+        if (g_capture_writer) {
+            g_capture_writer.value().close();
+            rf::console::print("Packet capture stopped ({} received, {} sent)",
+                g_capture_writer.value().get_num_recv(), g_capture_writer.value().get_num_send());
+            g_capture_writer.reset();
+            return;
+        }
+        if (!rf::is_server) {
+            rf::console::print("Packet capture is only supported on a server");
+            return;
+        }
+        auto filename = filename_opt.value_or("packets.dfpt");
+        try {
+            g_capture_writer.emplace(filename);
+            rf::console::print("Capturing packets to {}", filename);
+        }
+        catch (const std::exception& e) {
+            rf::console::print("Failed to start packet capture: {}", e.what());
+        }
+    },
+    "Starts/stops capturing of all received and sent packets to a file",
+    "packet_capture [filename]",
+};
+
+ConsoleCommand2 packet_replay_cmd{
+    "packet_replay",
+    [](std::optional<std::string> filename_opt, std::optional<bool> realtime_opt) {
+        if (g_replay) {
+            stop_replay();
+            return;
+        }
+        if (!filename_opt) {
+            rf::console::print("Usage: packet_replay <filename> [realtime]");
+            return;
+        }
+        if (!rf::is_server) {
+            rf::console::print("Packet replay is only supported on a server");
+            return;
+        }
+        const auto& filename = filename_opt.value();
+        try {
+            auto trace = std::make_unique<PacketTrace>(filename);
+            rf::console::print("Replaying {} records from {}", trace->get_records().size(), filename);
+            g_replay.emplace(std::move(trace), realtime_opt.value_or(false), replay_handler);
+            // Without real-time timing all packets are processed at once
+            packet_capture_do_frame();
+        }
+        catch (const std::exception& e) {
+            rf::console::print("Failed to replay packets: {}", e.what());
+        }
+    },
+    "Feeds received packets from a packet capture file to the packet processing code as fast as possible or in "
+    "real time. Packets sent to addresses from the trace are dropped. Running it during replay stops it.",
+    "packet_replay <filename> [realtime]",
+};
+
+void packet_capture_init()
+{
+    net_send_packet_hook.install();
+    packet_capture_cmd.register_cmd();
+    packet_replay_cmd.register_cmd();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+// Forward declarations
+namespace rf
+{
+    struct NetAddr;
+}
+
+// Capture of network traffic into a binary trace and replay of received packets from the trace. Used for
+// benchmarking packet processing and for checking changes in packet handlers using a repeatable load.
+//
+// Trace format (little-endian):
+//   header: char magic[4] = "DFPT", uint16_t version, uint16_t reserved
+//   records: uint8_t record_type, followed by:
+//     addr: uint32_t ip, uint16_t port - defines address used by following records (indices start from 0)
+//     recv/send: varint time delta in microseconds from the previous record, varint address index, varint length,
+//                data; send records have additional uint8_t packet kind (RF_MainPacketType) before the length
+// Received records contain game packets passed to multi_io_process_packets (reliable and unreliable). Sent records
+// contain datagrams sent by the socket layer.
+
+void packet_capture_init();
+void packet_capture_on_recv(const void* data, size_t len, const rf::NetAddr& addr);
+void packet_capture_do_frame();
@@ -0,0 +1,222 @@
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <common/rfproto-parser.h>
+#include "packet_trace.h"
+
+constexpr char trace_magic[4] = {'D', 'F', 'P', 'T'};
+constexpr uint16_t trace_version = 1;
+
+static uint64_t addr_key(const PacketTraceAddr& addr)
+{
+    return (static_cast<uint64_t>(addr.ip_addr) << 16) | addr.port;
+}
+
+PacketTraceWriter::PacketTraceWriter(const std::string& filename) : file_{filename, std::ios_base::binary}
+{
+    if (!file_) {
+        throw std::runtime_error{"cannot open file " + filename};
+    }
+    file_.write(trace_magic, sizeof(trace_magic));
+    write_int(trace_version);
+    write_int(static_cast<uint16_t>(0));
+}
+
+void PacketTraceWriter::write_recv(const void* data, size_t len, const PacketTraceAddr& addr)
+{
+    write_record_header(TraceRecordType::recv, addr);
+    write_data(data, len);
+    ++num_recv_;
+}
+
+void PacketTraceWriter::write_send(const void* data, size_t len, const PacketTraceAddr& addr, uint8_t packet_kind)
+{
+    write_record_header(TraceRecordType::send, addr);
+    write_int(packet_kind);
+    write_data(data, len);
+    ++num_send_;
+}
+
+void PacketTraceWriter::write_varint(uint64_t value)
+{
+    char buf[10];
+    int len = 0;
+    while (value >= 0x80) {
+        buf[len++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buf[len++] = static_cast<char>(value);
+    file_.write(buf, len);
+}
+
+void PacketTraceWriter::write_data(const void* data, size_t len)
+{
+    write_varint(len);
+    file_.write(static_cast<const char*>(data), static_cast<std::streamsize>(len));
+}
+
+void PacketTraceWriter::write_record_header(TraceRecordType type, const PacketTraceAddr& addr)
+{
+    auto [it, inserted] = addr_indices_.try_emplace(addr_key(addr), static_cast<unsigned>(addr_indices_.size()));
+    if (inserted) {
+        write_int(TraceRecordType::addr);
+        write_int(addr.ip_addr);
+        write_int(addr.port);
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto delta = std::chrono::duration_cast<std::chrono::microseconds>(now - last_record_time_);
+    last_record_time_ = now;
+    write_int(type);
+    write_varint(static_cast<uint64_t>(delta.count()));
+    write_varint(it->second);
+}
+
+static uint64_t read_varint(RfPacketReader& reader)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = 0;
+        if (!reader.read(byte)) {
+            break;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error{"truncated packet trace"};
+}
+
+PacketTrace::PacketTrace(const std::string& filename)
+{
+    std::ifstream file{filename, std::ios_base::binary};
+    if (!file) {
+        throw std::runtime_error{"cannot open file " + filename};
+    }
+    buf_.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+    parse();
+}
+
+void PacketTrace::parse()
+{
+    RfPacketReader reader{std::as_bytes(std::span{buf_})};
+    char magic[4];
+    uint16_t version = 0;
+    uint16_t reserved = 0;
+    if (!reader.read(magic) || std::memcmp(magic, trace_magic, sizeof(magic)) != 0 || !reader.read(version)
+        || !reader.read(reserved)) {
+        throw std::runtime_error{"not a packet trace"};
+    }
+    if (version != trace_version) {
+        throw std::runtime_error{"unsupported packet trace version " + std::to_string(version)};
+    }
+
+    std::chrono::microseconds time{0};
+    TraceRecordType type;
+    while (reader.read(type)) {
+        if (type == TraceRecordType::addr) {
+            PacketTraceAddr addr{};
+            if (!reader.read(addr.ip_addr) || !reader.read(addr.port)) {
+                throw std::runtime_error{"truncated packet trace"};
+            }
+            addrs_.push_back(addr);
+            continue;
+        }
+        if (type != TraceRecordType::recv && type != TraceRecordType::send) {
+            throw std::runtime_error{"invalid record type in packet trace"};
+        }
+        auto delta = read_varint(reader);
+        auto addr_index = read_varint(reader);
+        if (type == TraceRecordType::send && !reader.skip(1)) {
+            throw std::runtime_error{"truncated packet trace"};
+        }
+        auto len = static_cast<size_t>(read_varint(reader));
+        auto data_offset = reader.pos();
+        if (addr_index >= addrs_.size() || !reader.skip(len)) {
+            throw std::runtime_error{"truncated packet trace"};
+        }
+        time += std::chrono::microseconds{static_cast<std::chrono::microseconds::rep>(delta)};
+        auto data = std::as_bytes(std::span{buf_}).subspan(data_offset, len);
+        records_.push_back({type, time, addrs_[addr_index], data});
+    }
+}
+
+PacketReplay::PacketReplay(std::unique_ptr<PacketTrace> trace, bool realtime, Handler handler) :
+    trace_{std::move(trace)}, realtime_{realtime}, handler_{std::move(handler)}
+{
+    for (const auto& addr : trace_->get_addrs()) {
+        trace_addr_keys_.insert(addr_key(addr));
+    }
+}
+
+bool PacketReplay::process()
+{
+    const auto& records = trace_->get_records();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_);
+    while (next_record_ < records.size()) {
+        const auto& record = records[next_record_];
+        if (realtime_ && record.time > elapsed) {
+            return true;
+        }
+        if (record.type == TraceRecordType::recv) {
+            process_record(record);
+        }
+        ++next_record_;
+    }
+    return false;
+}
+
+bool PacketReplay::is_trace_addr(const PacketTraceAddr& addr) const
+{
+    return trace_addr_keys_.contains(addr_key(addr));
+}
+
+std::string PacketReplay::get_summary() const
+{
+    std::string summary = std::format("datagrams {}\npackets {}\nrejected {}\nbytes {}\n", num_recv_, num_packets_,
+        num_rejected_, bytes_recv_);
+    for (const auto& [type, count] : packet_type_counts_) {
+        summary += std::format("type 0x{:02X} {}\n", type, count);
+    }
+    return summary;
+}
+
+std::vector<std::string> PacketReplay::get_stats() const
+{
+    auto duration = std::chrono::steady_clock::now() - start_;
+    auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    auto processing_us = processing_time_.count();
+    std::vector<std::string> stats;
+    stats.push_back(std::format("Replayed {} datagrams ({} packets, {} bytes) in {} ms, {} rejected",
+        num_recv_, num_packets_, bytes_recv_, duration_ms, num_rejected_));
+    if (num_recv_ > 0 && processing_us > 0) {
+        stats.push_back(std::format("Processing time: {} ms total, {:.2f} us per datagram, {:.0f} packets per second",
+            processing_us / 1000, static_cast<double>(processing_us) / num_recv_,
+            num_packets_ * 1000000.0 / processing_us));
+    }
+    stats.push_back(std::format("Suppressed {} datagrams ({} bytes) sent to addresses from the trace", num_sent_,
+        bytes_sent_));
+    return stats;
+}
+
+void PacketReplay::process_record(const TraceRecord& record)
+{
+    RfGamePacketParser parser{record.data, RfPacketSource::client};
+    RfGamePacketView packet;
+    while (parser.next(packet)) {
+        ++num_packets_;
+        ++packet_type_counts_[packet.type];
+    }
+    if (parser.error() != RfPacketError::none) {
+        ++num_rejected_;
+    }
+    ++num_recv_;
+    bytes_recv_ += record.data.size();
+
+    auto begin = std::chrono::steady_clock::now();
+    handler_(record);
+    processing_time_ += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - begin);
+}
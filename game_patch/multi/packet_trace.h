@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Reading and writing of packet traces (see packet_capture.h for the format) and the replay driver. The code does not
+// depend on the game so replay of a trace can be checked natively.
+
+struct PacketTraceAddr
+{
+    uint32_t ip_addr;
+    uint16_t port;
+
+    bool operator==(const PacketTraceAddr& other) const = default;
+};
+
+enum class TraceRecordType : uint8_t
+{
+    addr = 0,
+    recv = 1,
+    send = 2,
+};
+
+struct TraceRecord
+{
+    TraceRecordType type;
+    std::chrono::microseconds time;
+    PacketTraceAddr addr;
+    std::span<const std::byte> data;
+};
+
+class PacketTraceWriter
+{
+public:
+    PacketTraceWriter(const std::string& filename);
+
+    void write_recv(const void* data, size_t len, const PacketTraceAddr& addr);
+    void write_send(const void* data, size_t len, const PacketTraceAddr& addr, uint8_t packet_kind);
+
+    void close()
+    {
+        file_.close();
+    }
+
+    [[nodiscard]] unsigned get_num_recv() const
+    {
+        return num_recv_;
+    }
+
+    [[nodiscard]] unsigned get_num_send() const
+    {
+        return num_send_;
+    }
+
+private:
+    std::ofstream file_;
+    std::unordered_map<uint64_t, unsigned> addr_indices_;
+    std::chrono::steady_clock::time_point last_record_time_ = std::chrono::steady_clock::now();
+    unsigned num_recv_ = 0;
+    unsigned num_send_ = 0;
+
+    template<typename T>
+    void write_int(T value)
+    {
+        file_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void write_varint(uint64_t value);
+    void write_data(const void* data, size_t len);
+    void write_record_header(TraceRecordType type, const PacketTraceAddr& addr);
+};
+
+class PacketTrace
+{
+public:
+    // Throws std::runtime_error if the file cannot be read or is not a valid trace
+    PacketTrace(const std::string& filename);
+
+    [[nodiscard]] const std::vector<TraceRecord>& get_records() const
+    {
+        return records_;
+    }
+
+    [[nodiscard]] const std::vector<PacketTraceAddr>& get_addrs() const
+    {
+        return addrs_;
+    }
+
+private:
+    std::vector<char> buf_;
+    std::vector<TraceRecord> records_;
+    std::vector<PacketTraceAddr> addrs_;
+
+    void parse();
+};
+
+// Passes received records from a trace to a packet handler as fast as possible or with the timing from the trace
+class PacketReplay
+{
+public:
+    // Called with every received record (a buffer passed to multi_io_process_packets in the game)
+    using Handler = std::function<void(const TraceRecord& record)>;
+
+    PacketReplay(std::unique_ptr<PacketTrace> trace, bool realtime, Handler handler);
+
+    // Processes received packets that are due. Returns false when all records have been processed.
+    bool process();
+
+    // Players created by replayed packets have addresses from the trace. Other addresses belong to real clients.
+    [[nodiscard]] bool is_trace_addr(const PacketTraceAddr& addr) const;
+
+    void on_send(size_t len)
+    {
+        ++num_sent_;
+        bytes_sent_ += len;
+    }
+
+    // Lines with counts that do not depend on timing, usable as an expected result of a replay
+    [[nodiscard]] std::string get_summary() const;
+    [[nodiscard]] std::vector<std::string> get_stats() const;
+
+private:
+    std::unique_ptr<PacketTrace> trace_;
+    bool realtime_;
+    Handler handler_;
+    std::unordered_set<uint64_t> trace_addr_keys_;
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+    size_t next_record_ = 0;
+    std::chrono::microseconds processing_time_{0};
+    unsigned num_recv_ = 0;
+    unsigned num_packets_ = 0;
+    unsigned num_rejected_ = 0;
+    size_t bytes_recv_ = 0;
+    unsigned num_sent_ = 0;
+    size_t bytes_sent_ = 0;
+    // packet type -> number of packets
+    std::map<uint8_t, unsigned> packet_type_counts_;
+
+    void process_record(const TraceRecord& record);
+};
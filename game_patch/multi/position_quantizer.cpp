@@ -0,0 +1,59 @@
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include "position_quantizer.h"
+
+PositionQuantizer::PositionQuantizer(const rf::Vector3& bbox_min, const rf::Vector3& bbox_max, float step) :
+    min_{bbox_min.x - margin, bbox_min.y - margin, bbox_min.z - margin}, step_{step}
+{
+    std::array<float, 3> max{bbox_max.x + margin, bbox_max.y + margin, bbox_max.z + margin};
+    int total_bits = 0;
+    for (size_t i = 0; i < bits_.size(); ++i) {
+        float num_steps = std::ceil((max[i] - min_[i]) / step);
+        if (!(step > 0.0f) || !(num_steps >= 0.0f && num_steps < static_cast<float>(1u << max_axis_bits))) {
+            return;
+        }
+        bits_[i] = std::bit_width(static_cast<uint32_t>(num_steps));
+        total_bits += bits_[i];
+    }
+    encoded_size_ = (total_bits + 7) / 8;
+}
+
+bool PositionQuantizer::quantize(const rf::Vector3& pos, std::span<std::byte> out, rf::Vector3& dequantized) const
+{
+    std::array<float, 3> coords{pos.x, pos.y, pos.z};
+    std::array<float, 3> dequantized_coords;
+    uint64_t packed = 0;
+    int shift = 0;
+    for (size_t i = 0; i < coords.size(); ++i) {
+        float value = std::round((coords[i] - min_[i]) / step_);
+        // Note: it also handles NaN
+        if (!(value >= 0.0f && value < static_cast<float>(1u << bits_[i]))) {
+            return false;
+        }
+        auto quantized = static_cast<uint32_t>(value);
+        packed |= static_cast<uint64_t>(quantized) << shift;
+        shift += bits_[i];
+        dequantized_coords[i] = min_[i] + static_cast<float>(quantized) * step_;
+    }
+    for (size_t i = 0; i < encoded_size_; ++i) {
+        out[i] = static_cast<std::byte>(packed >> (i * 8));
+    }
+    dequantized = {dequantized_coords[0], dequantized_coords[1], dequantized_coords[2]};
+    return true;
+}
+
+rf::Vector3 PositionQuantizer::dequantize(std::span<const std::byte> data) const
+{
+    uint64_t packed = 0;
+    for (size_t i = 0; i < encoded_size_; ++i) {
+        packed |= static_cast<uint64_t>(data[i]) << (i * 8);
+    }
+    std::array<float, 3> coords;
+    for (size_t i = 0; i < coords.size(); ++i) {
+        auto quantized = static_cast<uint32_t>(packed & ((1u << bits_[i]) - 1));
+        packed >>= bits_[i];
+        coords[i] = min_[i] + static_cast<float>(quantized) * step_;
+    }
+    return {coords[0], coords[1], coords[2]};
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include "../rf/math/vector.h"
+
+// Quantization of positions to integer multiples of a step relative to the level bounding box. Each axis uses the
+// smallest number of bits that covers the bounding box extended by a margin.
+class PositionQuantizer
+{
+public:
+    static constexpr int max_axis_bits = 21;
+    static constexpr size_t max_encoded_size = (3 * max_axis_bits + 7) / 8;
+    static constexpr float margin = 10.0f;
+
+    PositionQuantizer(const rf::Vector3& bbox_min, const rf::Vector3& bbox_max, float step);
+
+    // Returns false if the step is too small for the level size
+    [[nodiscard]] bool is_valid() const
+    {
+        return encoded_size_ > 0;
+    }
+
+    [[nodiscard]] size_t get_encoded_size() const
+    {
+        return encoded_size_;
+    }
+
+    // Quantizes position into get_encoded_size() bytes. Returns false if position is outside of the quantized area.
+    bool quantize(const rf::Vector3& pos, std::span<std::byte> out, rf::Vector3& dequantized) const;
+    [[nodiscard]] rf::Vector3 dequantize(std::span<const std::byte> data) const;
+
+private:
+    std::array<float, 3> min_;
+    float step_;
+    std::array<int, 3> bits_{};
+    size_t encoded_size_ = 0;
+};
@@ -0,0 +1,27 @@
+#include <common/rfproto.h>
+#include "send_queue.h"
+
+SendPriority get_send_priority(std::span<const std::byte> data)
+{
+    if (data.empty()) {
+        return SendPriority::normal;
+    }
+    switch (static_cast<uint8_t>(data[0])) {
+        case RF_GPT_PING:
+        case RF_GPT_PONG:
+        case RF_GPT_WEAPON_FIRE:
+        case RF_GPT_SOUND:
+            return SendPriority::high;
+        case RF_GPT_OBJECT_UPDATE:
+            return SendPriority::low;
+        default:
+            return SendPriority::normal;
+    }
+}
+
+void SendQueue::refill_budget(int now_ms, float max_rate, float max_budget)
+{
+    int elapsed_ms = std::clamp(now_ms - last_refill_ms, 0, 1000);
+    last_refill_ms = now_ms;
+    budget = std::clamp(budget + max_rate * static_cast<float>(elapsed_ms) / 1000.0f, -max_budget, max_budget);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Per-client queue of the send scheduler (see send_scheduler.h). Message priorities and the byte budget do not depend
+// on the game so they can be tested natively.
+
+enum class SendPriority
+{
+    high,
+    normal,
+    low,
+};
+
+// Returns priority of a message based on its first packet
+SendPriority get_send_priority(std::span<const std::byte> data);
+
+// Server-side state kept for every client
+struct SendQueue
+{
+    struct Message
+    {
+        SendPriority priority;
+        std::vector<std::byte> data;
+    };
+
+    struct ReliableMessage
+    {
+        std::vector<std::byte> data;
+        bool not_limbo;
+        // sent alone in a reliable container
+        bool isolated;
+    };
+
+    std::vector<Message> messages;
+    std::vector<ReliableMessage> reliable_messages;
+    // bytes that can be sent before low priority messages start being dropped
+    float budget = 0.0f;
+    int last_refill_ms = 0;
+
+    // Adds budget for the time elapsed since the last refill (at most one second). The budget is kept in range
+    // [-max_budget, max_budget] so an idle client cannot save it forever and a client over the budget recovers.
+    void refill_budget(int now_ms, float max_rate, float max_budget);
+
+    // Passes queued messages to send in the order of their priority (messages with the same priority keep their
+    // order) and clears the queue. If has_budget is true, low priority messages that do not fit in the budget are
+    // passed to drop instead - the next object update replaces them anyway. send returns the number of bytes actually
+    // sent (messages can be filtered or compressed), which is taken from the budget.
+    template<typename S, typename D>
+    void flush_messages(bool has_budget, S&& send, D&& drop)
+    {
+        std::stable_sort(messages.begin(), messages.end(), [](const auto& a, const auto& b) {
+            return a.priority < b.priority;
+        });
+        for (const auto& msg : messages) {
+            if (has_budget && msg.priority == SendPriority::low && budget < static_cast<float>(msg.data.size())) {
+                drop(msg);
+                continue;
+            }
+            size_t sent_bytes = send(msg);
+            if (has_budget) {
+                budget -= static_cast<float>(sent_bytes);
+            }
+        }
+        messages.clear();
+    }
+};
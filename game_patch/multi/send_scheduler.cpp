@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <vector>
+#include <common/utils/list-utils.h>
+#include <patch_common/FunHook.h>
+#include <xlog/xlog.h>
+#include "send_scheduler.h"
+#include "obj_interest.h"
+#include "obj_update_delta.h"
+#include "net_stats.h"
+#include "server_internal.h"
+#include "../misc/player.h"
+#include "../os/console.h"
+#include "../rf/multi.h"
+#include "../rf/player/player.h"
+#include "../rf/os/timer.h"
+
+// Budget can be accumulated for this time when a client does not use it
+constexpr float max_budget_seconds = 0.1f;
+
+struct SendSchedulerStats
+{
+    size_t datagrams = 0;
+    size_t bytes = 0;
+    size_t messages = 0;
+    size_t dropped_messages = 0;
+    size_t dropped_bytes = 0;
+    size_t reliable_messages = 0;
+    size_t reliable_bytes = 0;
+    size_t reliable_containers = 0;
+    size_t reliable_container_bytes = 0;
+};
+
+static SendSchedulerStats g_send_scheduler_stats;
+
+// Applies area of interest filtering and delta compression to object updates in the message
+static std::span<const std::byte> prepare_unreliable_message(rf::Player* player, std::span<const std::byte> data,
+    std::vector<std::byte>& filtered_buf, std::vector<std::byte>& encoded_buf)
+{
+    if (obj_interest_filter_packets(player, data, filtered_buf)) {
+        data = filtered_buf;
+    }
+    if (obj_update_delta_encode_packets(player, data, encoded_buf)) {
+        data = encoded_buf;
+    }
+    return data;
+}
+
+static void send_datagram(rf::Player& player, std::vector<std::byte>& datagram)
+{
+    rf::net_send(player.net_data->addr, datagram.data(), static_cast<int>(datagram.size()));
+    ++g_send_scheduler_stats.datagrams;
+    g_send_scheduler_stats.bytes += datagram.size();
+    datagram.clear();
+}
+
+static unsigned get_max_client_rate()
+{
+    return g_additional_server_config.send_scheduler.max_client_rate * 1024;
+}
+
+static bool is_scheduled_client(rf::Player* player)
+{
+    return rf::is_server && player && player != rf::local_player && player->net_data;
+}
+
+static SendQueue& get_send_queue(rf::Player* player)
+{
+    auto& pdata = get_player_additional_data(player);
+    if (!pdata.send_queue) {
+        pdata.send_queue = std::make_unique<SendQueue>();
+        pdata.send_queue->last_refill_ms = rf::timer_get_milliseconds();
+    }
+    return *pdata.send_queue;
+}
+
+static void flush_reliable_messages(rf::Player& player, SendQueue& queue, bool has_budget);
+
+static void flush_send_queue(rf::Player& player, SendQueue& queue, int now_ms)
+{
+    bool has_budget = get_max_client_rate() > 0;
+    if (has_budget) {
+        float max_rate = static_cast<float>(get_max_client_rate());
+        float max_budget = std::max(max_rate * max_budget_seconds, static_cast<float>(rf::max_packet_size));
+        queue.refill_budget(now_ms, max_rate, max_budget);
+    }
+    flush_reliable_messages(player, queue, has_budget);
+
+    std::vector<std::byte> datagram;
+    std::vector<std::byte> filtered_buf;
+    std::vector<std::byte> encoded_buf;
+    datagram.reserve(rf::max_packet_size);
+    auto send = [&](const SendQueue::Message& msg) {
+        filtered_buf.clear();
+        encoded_buf.clear();
+        auto data = prepare_unreliable_message(&player, msg.data, filtered_buf, encoded_buf);
+        net_stats_on_send(&player, data);
+        if (!datagram.empty() && datagram.size() + data.size() > rf::max_packet_size) {
+            send_datagram(player, datagram);
+        }
+        datagram.insert(datagram.end(), data.begin(), data.end());
+        ++g_send_scheduler_stats.messages;
+        return data.size();
+    };
+    auto drop = [&](const SendQueue::Message& msg) {
+        ++g_send_scheduler_stats.dropped_messages;
+        g_send_scheduler_stats.dropped_bytes += msg.data.size();
+        net_stats_on_send_dropped(&player, msg.data);
+    };
+    queue.flush_messages(has_budget, send, drop);
+    if (!datagram.empty()) {
+        send_datagram(player, datagram);
+    }
+}
+
+void send_scheduler_flush()
+{
+    if (!rf::is_server) {
+        return;
+    }
+    int now_ms = rf::timer_get_milliseconds();
+    auto player_list = SinglyLinkedList{rf::player_list};
+    for (auto& player : player_list) {
+        auto& pdata = get_player_additional_data(&player);
+        if (pdata.send_queue && player.net_data &&
+            (!pdata.send_queue->messages.empty() || !pdata.send_queue->reliable_messages.empty())) {
+            flush_send_queue(player, *pdata.send_queue, now_ms);
+        }
+    }
+}
+
+FunHook<void(rf::Player*, const void*, int)> multi_io_send_hook{
+    0x00479370,
+    [](rf::Player* player, const void* packet, int len) {
+        std::span data{static_cast<const std::byte*>(packet), static_cast<size_t>(len)};
+        if (!is_scheduled_client(player)) {
+            net_stats_on_send(player, data);
+            multi_io_send_hook.call_target(player, packet, len);
+            return;
+        }
+        if (!g_additional_server_config.send_scheduler.enabled) {
+            std::vector<std::byte> filtered_buf;
+            std::vector<std::byte> encoded_buf;
+            data = prepare_unreliable_message(player, data, filtered_buf, encoded_buf);
+            net_stats_on_send(player, data);
+            multi_io_send_hook.call_target(player, data.data(), static_cast<int>(data.size()));
+            return;
+        }
+        get_send_queue(player).messages.push_back({get_send_priority(data), {data.begin(), data.end()}});
+    },
+};
+
+FunHook<void(rf::Player*, const void*, int, int)> multi_io_send_reliable_hook{
+    0x00479480,
+    [](rf::Player* player, const void* data, int len, int not_limbo) {
+        std::span bytes{static_cast<const std::byte*>(data), static_cast<size_t>(len)};
+        if (!is_scheduled_client(player) || !g_additional_server_config.send_scheduler.enabled) {
+            net_stats_on_send(player, bytes);
+            multi_io_send_reliable_hook.call_target(player, data, len, not_limbo);
+            return;
+        }
+        // Messages sent to all players by multi_io_send_reliable_to_all also end up here
+        get_send_queue(player).reliable_messages.push_back({{bytes.begin(), bytes.end()}, not_limbo != 0, false});
+    },
+};
+
+FunHook<void(rf::Player*)> multi_io_send_buffered_reliable_packets_hook{
+    0x004796C0,
+    [](rf::Player* player) {
+        if (is_scheduled_client(player) && player->net_data->reliable_buffer_size > 0) {
+            ++g_send_scheduler_stats.reliable_containers;
+            g_send_scheduler_stats.reliable_container_bytes += player->net_data->reliable_buffer_size;
+        }
+        multi_io_send_buffered_reliable_packets_hook.call_target(player);
+    },
+};
+
+static void flush_reliable_messages(rf::Player& player, SendQueue& queue, bool has_budget)
+{
+    if (queue.reliable_messages.empty()) {
+        return;
+    }
+    for (const auto& msg : queue.reliable_messages) {
+        net_stats_on_send(&player, msg.data);
+        ++g_send_scheduler_stats.reliable_messages;
+        g_send_scheduler_stats.reliable_bytes += msg.data.size();
+        if (has_budget) {
+            queue.budget -= static_cast<float>(msg.data.size());
+        }
+        if (msg.isolated) {
+            rf::multi_io_send_buffered_reliable_packets(&player);
+        }
+        multi_io_send_reliable_hook.call_target(&player, msg.data.data(), static_cast<int>(msg.data.size()),
+            msg.not_limbo);
+        if (msg.isolated) {
+            rf::multi_io_send_buffered_reliable_packets(&player);
+        }
+    }
+    // Do not wait for the game to send the last container in the next frame
+    rf::multi_io_send_buffered_reliable_packets(&player);
+    queue.reliable_messages.clear();
+}
+
+bool send_scheduler_send_isolated_reliable(rf::Player* player, const void* data, int len)
+{
+    if (!is_scheduled_client(player) || !g_additional_server_config.send_scheduler.enabled) {
+        return false;
+    }
+    auto bytes = static_cast<const std::byte*>(data);
+    get_send_queue(player).reliable_messages.push_back({{bytes, bytes + len}, false, true});
+    return true;
+}
+
+ConsoleCommand2 send_scheduler_cmd{
+    "send_scheduler",
+    []() {
+        const auto& config = g_additional_server_config.send_scheduler;
+        const auto& stats = g_send_scheduler_stats;
+        rf::console::print("Send scheduler is {}", config.enabled ? "enabled" : "disabled");
+        if (config.max_client_rate > 0) {
+            rf::console::print("Client budget: {} KB/s", config.max_client_rate);
+        }
+        rf::console::print("Unreliable: {} messages in {} datagrams, {} bytes, average fill {:.1f}%",
+            stats.messages, stats.datagrams, stats.bytes,
+            stats.datagrams ? stats.bytes * 100.0 / (stats.datagrams * rf::max_packet_size) : 0.0);
+        rf::console::print("Dropped: {} messages, {} bytes", stats.dropped_messages, stats.dropped_bytes);
+        constexpr size_t container_size = sizeof(rf::PlayerNetData::reliable_buffer);
+        rf::console::print("Reliable: {} messages, {} bytes in {} containers, average fill {:.1f}%",
+            stats.reliable_messages, stats.reliable_bytes, stats.reliable_containers,
+            stats.reliable_containers
+                ? stats.reliable_container_bytes * 100.0 / (stats.reliable_containers * container_size)
+                : 0.0);
+    },
+    "Prints statistics of the server send scheduler",
+};
+
+void send_scheduler_do_patch()
+{
+    multi_io_send_hook.install();
+    multi_io_send_reliable_hook.install();
+    multi_io_send_buffered_reliable_packets_hook.install();
+    send_scheduler_cmd.register_cmd();
+}
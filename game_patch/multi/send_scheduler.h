@@ -0,0 +1,20 @@
+#pragma once
+
+#include "send_queue.h"
+
+namespace rf
+{
+    struct Player;
+}
+
+// Scheduler of messages sent by the server. Messages passed to multi_io_send are queued per client and sent once per
+// frame, packed into datagrams of up to rf::max_packet_size bytes in the order of their priority. If clients have a
+// byte budget, low priority messages (object updates) that do not fit in it are dropped - the next update replaces them
+// anyway. Reliable messages (chat, Pure Faction packets) are queued too and written to the game reliable buffer at the
+// end of the frame in their original order (changing it could break dependencies between them), so messages from the
+// whole frame share reliable containers. They are only counted in the budget.
+
+void send_scheduler_do_patch();
+void send_scheduler_flush();
+// Returns false if the scheduler is not used for the player and the caller has to send the packet itself
+bool send_scheduler_send_isolated_reliable(rf::Player* player, const void* data, int len);
@@ -15,6 +15,9 @@
 #include "server.h"
 #include "server_internal.h"
 #include "multi.h"
+#include "level_transfer_server.h"
+#include "packet_capture.h"
+#include "send_scheduler.h"
 #include "../os/console.h"
 #include "../misc/player.h"
 #include "../main/main.h"
@@ -192,6 +195,52 @@ void load_additional_server_config(rf::Parser& parser)
         }
     }
 
+    if (parser.parse_optional("$DF Level Transfer:")) {
+        auto& config = g_additional_server_config.level_transfer;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Max Client Rate:")) {
+            config.max_client_rate = parser.parse_uint();
+        }
+        if (parser.parse_optional("+Max Total Rate:")) {
+            config.max_total_rate = parser.parse_uint();
+        }
+        if (parser.parse_optional("+Max Connections:")) {
+            config.max_connections = std::max(parser.parse_uint(), 1u);
+        }
+        if (parser.parse_optional("+Max Client Connections:")) {
+            config.max_client_connections = std::max(parser.parse_uint(), 1u);
+        }
+    }
+
+    if (parser.parse_optional("$DF Delta Object Updates:")) {
+        g_additional_server_config.obj_update_delta = parser.parse_bool();
+        if (parser.parse_optional("+Position Precision:")) {
+            g_additional_server_config.obj_update_pos_precision = std::max(parser.parse_float(), 0.0f);
+        }
+    }
+
+    if (parser.parse_optional("$DF Interest Management:")) {
+        auto& config = g_additional_server_config.interest_management;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Always Relevant Distance:")) {
+            config.always_relevant_distance = parser.parse_float();
+        }
+        if (parser.parse_optional("+Max Distance:")) {
+            config.max_distance = parser.parse_float();
+        }
+        if (parser.parse_optional("+Room Depth:")) {
+            config.room_depth = parser.parse_uint();
+        }
+    }
+
+    if (parser.parse_optional("$DF Send Scheduler:")) {
+        auto& config = g_additional_server_config.send_scheduler;
+        config.enabled = parser.parse_bool();
+        if (parser.parse_optional("+Max Client Rate:")) {
+            config.max_client_rate = parser.parse_uint();
+        }
+    }
+
     if (!parser.parse_optional("$Name:") && !parser.parse_optional("#End")) {
         parser.error("end of server configuration");
     }
@@ -730,6 +779,13 @@ void server_do_frame()
 {
     server_vote_do_frame();
     process_delayed_kicks();
+    level_transfer_server_do_frame();
+    packet_capture_do_frame();
+}
+
+void server_do_frame_post()
+{
+    send_scheduler_flush();
 }
 
 void server_on_limbo_state_enter()
@@ -26,6 +26,34 @@ struct HitSoundsConfig
     int rate_limit = 10;
 };
 
+struct LevelTransferConfig
+{
+    bool enabled = false;
+    // in KB/s, 0 means no limit
+    unsigned max_client_rate = 1024;
+    unsigned max_total_rate = 4096;
+    unsigned max_connections = 8;
+    unsigned max_client_connections = 4;
+};
+
+struct InterestManagementConfig
+{
+    bool enabled = false;
+    // entities closer than this are always sent
+    float always_relevant_distance = 20.0f;
+    // entities further than this are not sent (0 means no limit)
+    float max_distance = 0.0f;
+    // number of room boundaries an entity can be behind and still be sent
+    int room_depth = 2;
+};
+
+struct SendSchedulerConfig
+{
+    bool enabled = false;
+    // in KB/s, 0 means no limit
+    unsigned max_client_rate = 0;
+};
+
 struct ServerAdditionalConfig
 {
     VoteConfig vote_kick;
@@ -56,6 +84,11 @@ struct ServerAdditionalConfig
     float kill_reward_effective_health = 0.0f;
     bool kill_reward_health_super = false;
     bool kill_reward_armor_super = false;
+    LevelTransferConfig level_transfer;
+    bool obj_update_delta = false;
+    float obj_update_pos_precision = 0.0f;
+    InterestManagementConfig interest_management;
+    SendSchedulerConfig send_scheduler;
 };
 
 extern ServerAdditionalConfig g_additional_server_config;
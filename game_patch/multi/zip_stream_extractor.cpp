@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <xlog/xlog.h>
+#include "zip_stream_extractor.h"
+
+constexpr std::uint32_t zip_local_file_header_sig = 0x04034B50;
+constexpr std::uint32_t zip_data_descriptor_sig = 0x08074B50;
+constexpr std::uint32_t zip_central_dir_header_sig = 0x02014B50;
+constexpr std::uint32_t zip_end_of_central_dir_sig = 0x06054B50;
+constexpr std::size_t zip_local_file_header_size = 30;
+constexpr std::uint16_t zip_flag_encrypted = 1;
+constexpr std::uint16_t zip_flag_data_descriptor = 8;
+constexpr std::uint16_t zip_method_stored = 0;
+constexpr std::uint16_t zip_method_deflated = 8;
+
+template<typename T>
+static T read_le(const char* ptr)
+{
+    T val = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        val |= static_cast<T>(static_cast<unsigned char>(ptr[i])) << (i * 8);
+    }
+    return val;
+}
+
+std::string get_archive_entry_output_name(std::string_view entry_name)
+{
+    if (entry_name.empty() || entry_name.front() == '/' || entry_name.front() == '\\' ||
+        entry_name.find_first_of(std::string_view{":\0", 2}) != std::string_view::npos) {
+        return {};
+    }
+    std::size_t component_start = 0;
+    while (true) {
+        auto component_end = entry_name.find_first_of("/\\", component_start);
+        auto component = entry_name.substr(component_start, component_end - component_start);
+        if (component == "..") {
+            return {};
+        }
+        if (component_end == std::string_view::npos) {
+            return component == "." ? std::string{} : std::string{component};
+        }
+        component_start = component_end + 1;
+    }
+}
+
+ZipStreamExtractor::ZipStreamExtractor(std::string output_dir, std::function<bool(const char*)> filename_filter,
+    DataObserver data_observer) :
+    output_dir_{std::move(output_dir)}, filename_filter_{std::move(filename_filter)},
+    data_observer_{std::move(data_observer)}
+{
+    output_buf_.resize(64 * 1024);
+}
+
+ZipStreamExtractor::~ZipStreamExtractor()
+{
+    discard_file();
+    if (zstream_initialized_) {
+        inflateEnd(&zstream_);
+    }
+}
+
+std::string ZipStreamExtractor::get_output_path() const
+{
+    return (std::filesystem::path{output_dir_} / file_name_).string();
+}
+
+std::string ZipStreamExtractor::get_part_path() const
+{
+    return get_output_path() + ".part";
+}
+
+// Returns number of bytes consumed from data. Header is complete if header_buf_ has the needed size.
+std::size_t ZipStreamExtractor::buffer_header(const char* data, std::size_t len, std::size_t needed)
+{
+    std::size_t num_copied = std::min(len, needed - header_buf_.size());
+    header_buf_.insert(header_buf_.end(), data, data + num_copied);
+    return num_copied;
+}
+
+void ZipStreamExtractor::feed(const char* data, std::size_t len)
+{
+    while (len > 0 && state_ != State::finished) {
+        std::size_t consumed = 0;
+        if (state_ == State::local_header) {
+            // Signature tells if it is a file or the central directory that follows the last file
+            std::size_t needed = header_buf_.size() < 4 ? 4 : zip_local_file_header_size;
+            consumed = buffer_header(data, len, needed);
+            if (header_buf_.size() == 4) {
+                auto sig = read_le<std::uint32_t>(header_buf_.data());
+                if (sig == zip_central_dir_header_sig || sig == zip_end_of_central_dir_sig) {
+                    state_ = State::finished;
+                }
+                else if (sig != zip_local_file_header_sig) {
+                    throw std::runtime_error{"not a zip archive"};
+                }
+            }
+            else if (header_buf_.size() == zip_local_file_header_size) {
+                state_ = State::name_and_extra;
+            }
+        }
+        else if (state_ == State::name_and_extra) {
+            auto name_len = read_le<std::uint16_t>(&header_buf_[26]);
+            auto extra_len = read_le<std::uint16_t>(&header_buf_[28]);
+            consumed = buffer_header(data, len, zip_local_file_header_size + name_len + extra_len);
+            if (header_buf_.size() == zip_local_file_header_size + name_len + extra_len) {
+                begin_file();
+            }
+        }
+        else if (state_ == State::file_data) {
+            consumed = process_file_data(data, len);
+        }
+        else if (state_ == State::data_descriptor) {
+            // Signature of the data descriptor is optional
+            auto get_descriptor_size = [this]() -> std::size_t {
+                if (header_buf_.size() < 4) {
+                    return 4;
+                }
+                return read_le<std::uint32_t>(header_buf_.data()) == zip_data_descriptor_sig ? 16 : 12;
+            };
+            consumed = buffer_header(data, len, get_descriptor_size());
+            std::size_t needed = get_descriptor_size();
+            if (header_buf_.size() == needed && needed != 4) {
+                std::size_t offset = needed - 12;
+                expected_crc_ = read_le<std::uint32_t>(&header_buf_[offset]);
+                uncompressed_size_ = read_le<std::uint32_t>(&header_buf_[offset + 8]);
+                header_buf_.clear();
+                finish_file(expected_crc_);
+            }
+        }
+        data += consumed;
+        len -= consumed;
+    }
+}
+
+void ZipStreamExtractor::begin_file()
+{
+    flags_ = read_le<std::uint16_t>(&header_buf_[6]);
+    method_ = read_le<std::uint16_t>(&header_buf_[8]);
+    expected_crc_ = read_le<std::uint32_t>(&header_buf_[14]);
+    compressed_size_ = read_le<std::uint32_t>(&header_buf_[18]);
+    uncompressed_size_ = read_le<std::uint32_t>(&header_buf_[22]);
+    auto name_len = read_le<std::uint16_t>(&header_buf_[26]);
+    std::string_view name{&header_buf_[zip_local_file_header_size], name_len};
+    header_buf_.clear();
+
+    if (flags_ & zip_flag_encrypted) {
+        throw std::runtime_error{"encrypted zip entries are not supported"};
+    }
+    if (method_ != zip_method_stored && method_ != zip_method_deflated) {
+        throw std::runtime_error{"unsupported zip compression method"};
+    }
+    if (method_ == zip_method_stored && (flags_ & zip_flag_data_descriptor)) {
+        // End of data cannot be found without knowing its size
+        throw std::runtime_error{"stored zip entry without size"};
+    }
+    if (compressed_size_ == UINT32_MAX || uncompressed_size_ == UINT32_MAX) {
+        throw std::runtime_error{"zip64 archives are not supported"};
+    }
+
+    // Do not allow writing outside of the output directory
+    file_name_ = get_archive_entry_output_name(name);
+    extracting_ = !file_name_.empty() && filename_filter_(file_name_.c_str());
+    if (extracting_) {
+        xlog::trace("Unpacking {}", file_name_);
+        output_file_.open(get_part_path(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        if (!output_file_) {
+            xlog::error("Cannot open file: {}", get_part_path());
+            throw std::runtime_error{"cannot open output file"};
+        }
+    }
+
+    if (method_ == zip_method_deflated) {
+        if (!zstream_initialized_) {
+            if (inflateInit2(&zstream_, -MAX_WBITS) != Z_OK) {
+                throw std::runtime_error{"inflateInit2 failed"};
+            }
+            zstream_initialized_ = true;
+        }
+        else {
+            inflateReset(&zstream_);
+        }
+    }
+    crc_ = crc32(0, nullptr, 0);
+    compressed_read_ = 0;
+    uncompressed_written_ = 0;
+    state_ = State::file_data;
+    // Empty file
+    if (method_ == zip_method_stored && compressed_size_ == 0) {
+        end_file_data();
+    }
+}
+
+// Returns number of bytes consumed from data
+std::size_t ZipStreamExtractor::process_file_data(const char* data, std::size_t len)
+{
+    if (method_ == zip_method_stored) {
+        std::size_t chunk_len = std::min<std::size_t>(len, compressed_size_ - compressed_read_);
+        write_output(data, chunk_len);
+        compressed_read_ += chunk_len;
+        if (compressed_read_ == compressed_size_) {
+            end_file_data();
+        }
+        return chunk_len;
+    }
+
+    // Deflate stream has an end marker so it can be decompressed even if the compressed size is not known
+    zstream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zstream_.avail_in = static_cast<uInt>(len);
+    int result = Z_OK;
+    while (zstream_.avail_in > 0 && result != Z_STREAM_END) {
+        zstream_.next_out = reinterpret_cast<Bytef*>(output_buf_.data());
+        zstream_.avail_out = static_cast<uInt>(output_buf_.size());
+        result = inflate(&zstream_, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END) {
+            throw std::runtime_error{"zip entry data is corrupted"};
+        }
+        write_output(output_buf_.data(), output_buf_.size() - zstream_.avail_out);
+    }
+    std::size_t consumed = len - zstream_.avail_in;
+    compressed_read_ += consumed;
+    if (result == Z_STREAM_END) {
+        end_file_data();
+    }
+    return consumed;
+}
+
+void ZipStreamExtractor::write_output(const char* data, std::size_t len)
+{
+    if (!extracting_ || len == 0) {
+        return;
+    }
+    crc_ = crc32(crc_, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(len));
+    if (!output_file_.write(data, static_cast<std::streamsize>(len))) {
+        throw std::runtime_error{"cannot write output file"};
+    }
+    if (data_observer_) {
+        data_observer_(file_name_, uncompressed_written_, data, len);
+    }
+    uncompressed_written_ += len;
+}
+
+void ZipStreamExtractor::end_file_data()
+{
+    if (flags_ & zip_flag_data_descriptor) {
+        state_ = State::data_descriptor;
+    }
+    else {
+        if (method_ == zip_method_deflated && compressed_read_ != compressed_size_) {
+            throw std::runtime_error{"zip entry size mismatch"};
+        }
+        finish_file(expected_crc_);
+    }
+}
+
+void ZipStreamExtractor::finish_file(std::uint32_t crc)
+{
+    state_ = State::local_header;
+    if (!extracting_) {
+        return;
+    }
+    if (crc != crc_ || uncompressed_written_ != uncompressed_size_) {
+        throw std::runtime_error{"zip entry checksum mismatch"};
+    }
+    output_file_.close();
+    std::error_code ec;
+    auto output_path = get_output_path();
+    std::filesystem::rename(get_part_path(), output_path, ec);
+    if (ec) {
+        xlog::error("Cannot rename {} to {}: {}", get_part_path(), output_path, ec.message());
+        throw std::runtime_error{"cannot rename output file"};
+    }
+    extracting_ = false;
+    extracted_files_.push_back(file_name_);
+}
+
+void ZipStreamExtractor::discard_file()
+{
+    if (extracting_) {
+        output_file_.close();
+        std::remove(get_part_path().c_str());
+        extracting_ = false;
+    }
+}
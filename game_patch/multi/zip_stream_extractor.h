@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <zlib.h>
+
+// Returns name of the file an archive entry is extracted to - the last component of the entry path. Returns an empty
+// string if the entry name is absolute, contains a drive, a ".." component or a null character. Archives can come
+// from untrusted servers so files must never be written outside of the output directory.
+std::string get_archive_entry_output_name(std::string_view entry_name);
+
+// Extracts files from a zip archive while it is being received. Only local file headers are used so the central
+// directory at the end of the archive is not needed. Files are written to output_dir (without subdirectories in
+// their names) when they are fully extracted and their CRC has been checked.
+class ZipStreamExtractor
+{
+public:
+    // Called with uncompressed contents of every extracted file in order (offset is 0 for the first call)
+    using DataObserver = std::function<void(std::string_view name, std::size_t offset, const char* data,
+        std::size_t len)>;
+
+    ZipStreamExtractor(std::string output_dir, std::function<bool(const char*)> filename_filter,
+        DataObserver data_observer = {});
+    ~ZipStreamExtractor();
+    ZipStreamExtractor(const ZipStreamExtractor&) = delete;
+    ZipStreamExtractor& operator=(const ZipStreamExtractor&) = delete;
+
+    // Throws std::runtime_error if the archive is corrupted or uses features that cannot be streamed (e.g. it is
+    // not a zip file at all)
+    void feed(const char* data, std::size_t len);
+
+    // Returns true if all files have been processed (central directory has been reached)
+    [[nodiscard]] bool finished() const
+    {
+        return state_ == State::finished;
+    }
+
+    [[nodiscard]] const std::vector<std::string>& get_extracted_files() const
+    {
+        return extracted_files_;
+    }
+
+private:
+    enum class State
+    {
+        local_header,
+        name_and_extra,
+        file_data,
+        data_descriptor,
+        finished,
+    };
+
+    std::string output_dir_;
+    std::function<bool(const char*)> filename_filter_;
+    DataObserver data_observer_;
+    State state_ = State::local_header;
+    std::vector<char> header_buf_;
+    std::vector<char> output_buf_;
+    std::vector<std::string> extracted_files_;
+
+    // current file
+    std::uint16_t flags_ = 0;
+    std::uint16_t method_ = 0;
+    std::uint32_t expected_crc_ = 0;
+    std::uint32_t compressed_size_ = 0;
+    std::uint32_t uncompressed_size_ = 0;
+    std::uint32_t crc_ = 0;
+    std::size_t compressed_read_ = 0;
+    std::size_t uncompressed_written_ = 0;
+    std::string file_name_;
+    bool extracting_ = false;
+    std::ofstream output_file_;
+    z_stream zstream_{};
+    bool zstream_initialized_ = false;
+
+    std::size_t buffer_header(const char* data, std::size_t len, std::size_t needed);
+    void begin_file();
+    std::size_t process_file_data(const char* data, std::size_t len);
+    void write_output(const char* data, std::size_t len);
+    void end_file_data();
+    void finish_file(std::uint32_t crc);
+    void discard_file();
+    [[nodiscard]] std::string get_output_path() const;
+    [[nodiscard]] std::string get_part_path() const;
+};
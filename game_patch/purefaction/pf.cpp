@@ -6,6 +6,7 @@
 #include <xlog/xlog.h>
 #include "../rf/multi.h"
 #include "../multi/multi.h"
+#include "../multi/send_scheduler.h"
 #include "pf.h"
 #include "pf_packets.h"
 #include "pf_ac.h"
@@ -13,6 +14,10 @@
 void pf_send_reliable_packet(rf::Player* player, const void* data, int len)
 {
 #if 1 // reliable
+    // Send scheduler sends the packet at the end of the frame in a separate container
+    if (send_scheduler_send_isolated_reliable(player, data, len)) {
+        return;
+    }
     // PF improperly handles custom packets if they are not the first ones in a reliable packets container so flush
     // buffer before sending
     rf::multi_io_send_buffered_reliable_packets(player);
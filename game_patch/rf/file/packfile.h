@@ -2,6 +2,12 @@
 
 #include <cstdint>
 #include <vector>
+#ifdef DASH_FACTION
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vpp/MappedFile.h>
+#endif
 
 namespace rf
 {
@@ -21,6 +27,12 @@ namespace rf
         uint32_t file_size;
 #ifdef DASH_FACTION
         bool is_user_maps;
+        // names of all entries
+        std::vector<std::unique_ptr<char[]>> name_buffers;
+        // mapped lazily when file contents are accessed through vpackfile_get_file_view
+        std::unique_ptr<vpp::MappedFile> mapped_file;
+        // indices of entries in files vector grouped by lower-case extension (without the dot)
+        std::unordered_map<std::string, std::vector<uint32_t>> entries_by_ext;
 #endif
     };
 #ifndef DASH_FACTION
@@ -37,7 +49,8 @@ namespace rf
         VPackfile* parent;
         std::FILE* raw_file;
     };
-    static_assert(sizeof(VPackfileEntry) == 0x18);
+    // Note: native tests include this header in 64-bit builds
+    static_assert(sizeof(void*) != 4 || sizeof(VPackfileEntry) == 0x18);
 
     static auto& vpackfile_add = addr_as_ref<int(const char *file_name, const char *dir)>(0x0052C070);
     static auto& vpackfile_set_loading_user_maps = addr_as_ref<void(bool loading_user_maps)>(0x0052BB50);
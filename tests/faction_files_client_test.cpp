@@ -0,0 +1,100 @@
+// Downloads levels with FactionFilesClient built with the socket HTTP backend from tools/mock_factionfiles.py
+// configured to drop connections in the middle of the body and to ignore Range headers, using one and multiple
+// connections. Checks that the archive is passed to the consumer unchanged and that parts spilled to temporary
+// files are removed.
+// Usage: faction_files_client_test python mock_factionfiles_script
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../game_patch/multi/faction_files.h"
+#include "mock_factionfiles.h"
+#include "test_utils.h"
+
+static std::string g_python;
+static std::string g_script;
+
+static unsigned count_temp_files(const std::filesystem::path& dir)
+{
+    unsigned count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator{dir}) {
+        if (entry.path().extension() == ".tmp") {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Returns the maximal number of temporary files seen during the download
+static unsigned download_and_check(const std::string& archive_path, const std::vector<char>& archive,
+    std::vector<std::string> mock_args, unsigned num_connections)
+{
+    mock_args.insert(mock_args.end(), {"--map", "dm-test.rfl=" + archive_path});
+    MockFactionFiles mock{g_python, g_script, mock_args};
+    FactionFilesClient client{mock.url()};
+
+    auto info = client.find_map("dm-test.rfl");
+    CHECK(info && info->name == "dm-test" && info->ticket_id == 1);
+    CHECK(!client.find_map("missing.rfl"));
+
+    auto temp_dir = std::filesystem::temp_directory_path();
+    std::vector<char> received;
+    unsigned max_temp_files = 0;
+    client.download_map(info->ticket_id, num_connections,
+        [&](const char* data, std::size_t len) {
+            received.insert(received.end(), data, data + len);
+        },
+        [&](unsigned bytes_received, std::chrono::milliseconds) {
+            CHECK(bytes_received <= archive.size());
+            max_temp_files = std::max(max_temp_files, count_temp_files(temp_dir));
+            return true;
+        });
+    CHECK(received.size() == archive.size());
+    CHECK(std::memcmp(received.data(), archive.data(), archive.size()) == 0);
+    CHECK(count_temp_files(temp_dir) == 0);
+    return max_temp_files;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s python mock_factionfiles_script\n", argv[0]);
+        return 1;
+    }
+    g_python = argv[1];
+    g_script = argv[2];
+
+    TempDir temp_dir;
+    // Temporary files of the download go to the test directory
+    std::filesystem::create_directories(temp_dir.file("tmp"));
+    setenv("TMPDIR", temp_dir.file("tmp").c_str(), 1);
+
+    std::vector<char> archive(24 * 1024 * 1024);
+    std::mt19937 rng{1};
+    for (auto& b : archive) {
+        b = static_cast<char>(rng());
+    }
+    auto archive_path = temp_dir.file("test.zip");
+    std::ofstream{archive_path, std::ios_base::binary}.write(archive.data(), archive.size());
+
+    // Single connection
+    download_and_check(archive_path, archive, {}, 1);
+    // Connection dropped in the middle of the body twice - download is resumed with a range request
+    download_and_check(archive_path, archive, {"--drop-after", "1000000", "--drop-count", "2"}, 1);
+    // Server ignoring ranges - resumed download skips data received before
+    download_and_check(archive_path, archive, {"--no-ranges", "--drop-after", "1000000"}, 1);
+    // Multiple connections - parts bigger than the memory limit are spilled to temporary files
+    unsigned max_temp_files = download_and_check(archive_path, archive, {"--bandwidth", "20000"}, 4);
+    CHECK(max_temp_files > 0);
+    // Multiple connections with some of them dropped
+    download_and_check(archive_path, archive, {"--drop-after", "1000000", "--drop-count", "3"}, 4);
+    // Multiple connections requested from a server ignoring ranges - a single connection is used
+    download_and_check(archive_path, archive, {"--no-ranges"}, 4);
+
+    std::printf("faction_files_client_test: OK\n");
+    return 0;
+}
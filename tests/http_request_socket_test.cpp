@@ -0,0 +1,144 @@
+// Checks the socket HTTP backend: responses end at Content-Length even if the server keeps the connection open and
+// requests made against tools/mock_factionfiles.py (level info, range and whole resource downloads).
+// Usage: http_request_socket_test python mock_factionfiles_script
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <common/HttpRequest.h>
+#include "mock_factionfiles.h"
+#include "test_utils.h"
+
+static std::string read_all(HttpRequest& req)
+{
+    std::string result;
+    char buf[7];
+    std::size_t len;
+    while ((len = req.read(buf, sizeof(buf))) > 0) {
+        result.append(buf, len);
+    }
+    return result;
+}
+
+// Server that sends the response in two parts, then more data than declared in Content-Length and does not close the
+// connection until the client does
+static void test_content_length()
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(listen_fd >= 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    CHECK(listen(listen_fd, 1) == 0);
+    socklen_t addr_len = sizeof(addr);
+    CHECK(getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0);
+
+    std::thread server_thread{[listen_fd]() {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        char buf[1024];
+        std::string request;
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t len = recv(fd, buf, sizeof(buf), 0);
+            if (len <= 0) {
+                break;
+            }
+            request.append(buf, static_cast<std::size_t>(len));
+        }
+        std::string_view part1 = "HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\nhello";
+        std::string_view part2 = " worldEXTRA DATA";
+        send(fd, part1.data(), part1.size(), MSG_NOSIGNAL);
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        send(fd, part2.data(), part2.size(), MSG_NOSIGNAL);
+        // Wait until the client closes the connection
+        while (recv(fd, buf, sizeof(buf), 0) > 0) {
+        }
+        close(fd);
+    }};
+
+    {
+        HttpSession session{"test"};
+        session.set_receive_timeout(5000);
+        HttpRequest req{"http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/", "GET", session};
+        req.send();
+        CHECK(req.get_content_length() == 11u);
+        auto start = std::chrono::steady_clock::now();
+        CHECK(read_all(req) == "hello world");
+        // Must not wait for the receive timeout
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds{2});
+    }
+    server_thread.join();
+    close(listen_fd);
+}
+
+static void test_mock_server(const std::string& python, const std::string& script)
+{
+    TempDir temp_dir;
+    std::vector<char> archive(300000);
+    std::mt19937 rng{1};
+    for (auto& b : archive) {
+        b = static_cast<char>(rng());
+    }
+    auto archive_path = temp_dir.file("test.zip");
+    std::ofstream{archive_path, std::ios_base::binary}.write(archive.data(), archive.size());
+    MockFactionFiles mock{python, script, {"--map", "dm-test.rfl=" + archive_path}};
+
+    HttpSession session{"test"};
+    session.set_receive_timeout(5000);
+    {
+        HttpRequest req{mock.url() + "/findmap.php?rflName=" + encode_uri_component("DM-Test.rfl"), "GET", session};
+        req.send();
+        auto body = read_all(req);
+        CHECK(body.starts_with("found\nDM-Test\n"));
+        CHECK(body.ends_with("\n1\n"));
+    }
+    {
+        HttpRequest req{mock.url() + "/downloadmap.php?ticketid=1", "GET", session};
+        req.send();
+        CHECK(req.get_status_code() == 200);
+        CHECK(req.get_content_length() == archive.size());
+        CHECK(req.get_header("accept-ranges") == "bytes");
+        auto body = read_all(req);
+        CHECK(body.size() == archive.size() && std::memcmp(body.data(), archive.data(), archive.size()) == 0);
+    }
+    {
+        HttpRequest req{mock.url() + "/downloadmap.php?ticketid=1", "GET", session};
+        req.set_range(1000, 2000);
+        req.send();
+        CHECK(req.get_status_code() == 206);
+        CHECK(req.get_header("Content-Range") == "bytes 1000-1999/300000");
+        auto body = read_all(req);
+        CHECK(body.size() == 1000 && std::memcmp(body.data(), archive.data() + 1000, 1000) == 0);
+    }
+    {
+        HttpRequest req{mock.url() + "/downloadmap.php?ticketid=2", "GET", session};
+        bool thrown = false;
+        try {
+            req.send();
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        CHECK(thrown && req.get_status_code() == 404);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s python mock_factionfiles_script\n", argv[0]);
+        return 1;
+    }
+    test_content_length();
+    test_mock_server(argv[1], argv[2]);
+    std::printf("http_request_socket_test: OK\n");
+    return 0;
+}
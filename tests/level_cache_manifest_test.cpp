@@ -0,0 +1,97 @@
+// Checks level cache statistics, LRU eviction, that saving the manifest replaces it without leaving a temporary
+// file behind and that packfiles missing from the manifest are adopted on load
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../game_patch/multi/level_cache_manifest.h"
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+static LevelCacheEntry store_packfile(const TempDir& dir, const std::string& filename,
+    const std::string& level_filename, std::int64_t last_used)
+{
+    auto files = make_synthetic_files(20, 1000, static_cast<unsigned>(last_used));
+    files.push_back({level_filename, std::vector<std::byte>(100)});
+    auto path = dir.file(filename);
+    write_synthetic_vpp(path, files);
+    return {filename, std::filesystem::file_size(path), 1000 + static_cast<std::uint64_t>(last_used), last_used,
+        {level_filename}};
+}
+
+int main()
+{
+    TempDir dir;
+    LevelCacheManifest manifest{dir.file("")};
+    manifest.load();
+    CHECK(manifest.entries().empty());
+
+    CHECK(is_level_cache_packfile_name("0123456789abcdef.vpp"));
+    CHECK(!is_level_cache_packfile_name("dm-level.vpp"));
+    CHECK(!is_level_cache_packfile_name("0123456789abcdef.vpp.part"));
+
+    auto a = store_packfile(dir, "000000000000000a.vpp", "a.rfl", 10);
+    auto b = store_packfile(dir, "000000000000000b.vpp", "b.rfl", 20);
+    auto c = store_packfile(dir, "000000000000000c.vpp", "c.rfl", 30);
+    manifest.add(a);
+    manifest.add(b);
+    manifest.add(c);
+    // Adding the same packfile again replaces the entry
+    manifest.add(c);
+    CHECK(manifest.entries().size() == 3);
+    CHECK(manifest.get_total_size() == a.size + b.size + c.size);
+
+    // Statistics
+    CHECK(!manifest.find_level("missing.rfl"));
+    manifest.record_miss();
+    auto* entry = manifest.find_level("A.RFL");
+    CHECK(entry && entry->filename == a.filename);
+    manifest.record_hit(*entry, 40);
+    CHECK(entry->last_used == 40);
+    CHECK(manifest.num_hits() == 1 && manifest.num_misses() == 1 && manifest.bytes_saved() == a.download_size);
+
+    CHECK(manifest.save());
+    CHECK(!std::filesystem::exists(dir.file("manifest.txt.tmp")));
+
+    // Least recently used packfiles are removed first unless they are in use: b is the oldest but in use, then c is
+    // removed and a (used most recently) is kept
+    manifest.evict(a.size + b.size, {b.filename});
+    CHECK(manifest.entries().size() == 2);
+    CHECK(manifest.find_level("a.rfl") && manifest.find_level("b.rfl") && !manifest.find_level("c.rfl"));
+    CHECK(!std::filesystem::exists(dir.file(c.filename)));
+    CHECK(std::filesystem::exists(dir.file(b.filename)));
+
+    // Manifest saved before eviction still lists c which no longer exists - it stays until the next eviction
+    LevelCacheManifest loaded{dir.file("")};
+    loaded.load();
+    CHECK(loaded.entries().size() == 3);
+    auto* loaded_a = loaded.find_level("a.rfl");
+    CHECK(loaded_a && loaded_a->last_used == 40 && loaded_a->size == a.size &&
+        loaded_a->download_size == a.download_size);
+    CHECK(loaded.num_hits() == 0 && loaded.num_misses() == 0);
+
+    // Packfiles missing from the manifest (e.g. the game crashed before saving it) are adopted with levels read
+    // from their directories, and they are evicted first. Other files in the directory are ignored.
+    auto d = store_packfile(dir, "000000000000000d.vpp", "d.rfl", 50);
+    std::ofstream{dir.file("dm-level.vpp")} << "not a cached packfile";
+    std::ofstream{dir.file("00000000000000ff.vpp")} << "corrupted";
+    LevelCacheManifest adopted{dir.file("")};
+    adopted.load();
+    auto* adopted_d = adopted.find_level("d.rfl");
+    CHECK(adopted_d && adopted_d->size == d.size && adopted_d->last_used == 0);
+    CHECK(adopted.entries().size() == 5);
+    adopted.evict(adopted.get_total_size() - 1, {});
+    CHECK(!std::filesystem::exists(dir.file("000000000000000d.vpp")) ||
+        !std::filesystem::exists(dir.file("00000000000000ff.vpp")));
+    CHECK(std::filesystem::exists(dir.file("dm-level.vpp")));
+    CHECK(adopted.find_level("a.rfl"));
+
+    // Interrupted save leaves the old manifest intact
+    std::ofstream{dir.file("manifest.txt.tmp")} << "partial";
+    LevelCacheManifest after_crash{dir.file("")};
+    after_crash.load();
+    CHECK(after_crash.find_level("a.rfl") && after_crash.find_level("b.rfl"));
+
+    std::printf("level_cache_manifest_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Runs the level transfer service in a child process and downloads a level from it over loopback the way clients do:
+// FactionFilesClient built with the socket HTTP backend and ZipStreamExtractor. Checks that the extracted packfile
+// matches the served one, that connections over the per-address limit are refused and that a packfile replaced while
+// the server is running is served with its new contents.
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../game_patch/multi/faction_files.h"
+#include "../game_patch/multi/level_transfer_service.h"
+#include "../game_patch/multi/zip_stream_extractor.h"
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+// download_and_check makes three requests in a row and the server can see a connection as active for a moment after
+// the client got the response
+constexpr unsigned max_client_connections = 3;
+
+static std::vector<char> read_file(const std::string& path)
+{
+    std::ifstream file{path, std::ios_base::in | std::ios_base::binary};
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+// Serves the packfile until the parent closes the control pipe
+[[noreturn]] static void run_server(const std::string& packfile_path, int port_fd, int control_fd)
+{
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    LevelTransferService::Limits limits;
+    limits.max_client_connections = max_client_connections;
+    {
+        LevelTransferService service{0, limits};
+        if (!service.start()) {
+            _exit(1);
+        }
+        service.set_levels({{"dm-test.rfl", packfile_path}});
+        unsigned short port = service.get_port();
+        if (write(port_fd, &port, sizeof(port)) != sizeof(port)) {
+            _exit(1);
+        }
+        char buf;
+        while (read(control_fd, &buf, 1) > 0) {
+        }
+    }
+    // Do not run destructors of the parent's objects
+    _exit(0);
+}
+
+static void download_and_check(const std::string& url, const std::string& packfile_path, const std::string& output_dir)
+{
+    FactionFilesClient client{url};
+    auto info = client.find_map("DM-Test.rfl");
+    CHECK(info && info->name == "DM-Test" && info->ticket_id == 1);
+    CHECK(!client.find_map("missing.rfl"));
+
+    std::filesystem::remove_all(output_dir);
+    std::filesystem::create_directories(output_dir);
+    ZipStreamExtractor extractor{output_dir, [](const char*) { return true; }};
+    client.download_map(info->ticket_id, 1,
+        [&](const char* data, std::size_t len) { extractor.feed(data, len); },
+        [](unsigned, std::chrono::milliseconds) { return true; });
+    CHECK(extractor.finished());
+    CHECK(extractor.get_extracted_files().size() == 1);
+    CHECK(read_file(output_dir + "/dm-test.vpp") == read_file(packfile_path));
+}
+
+static int connect_to(unsigned short port)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(sock >= 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    CHECK(connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    return sock;
+}
+
+static void check_client_connection_limit(unsigned short port)
+{
+    // Let the server finish previous connections
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+    // Idle connections wait for the request in the server
+    std::vector<int> idle_socks;
+    for (unsigned i = 0; i < max_client_connections; ++i) {
+        idle_socks.push_back(connect_to(port));
+    }
+    int sock = connect_to(port);
+    std::string_view request = "GET /findmap.php?rflName=dm-test.rfl HTTP/1.0\r\n\r\n";
+    send(sock, request.data(), request.size(), MSG_NOSIGNAL);
+    std::string response;
+    char buf[256];
+    ssize_t len;
+    while ((len = recv(sock, buf, sizeof(buf), 0)) > 0) {
+        response.append(buf, static_cast<std::size_t>(len));
+    }
+    close(sock);
+    CHECK(response.starts_with("HTTP/1.0 503 "));
+    for (int idle_sock : idle_socks) {
+        close(idle_sock);
+    }
+    // Let the server remove closed connections
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+}
+
+int main()
+{
+    TempDir temp_dir;
+    auto packfile_path = temp_dir.file("dm-test.vpp");
+    write_synthetic_vpp(packfile_path, make_synthetic_files(64, 65536, 1));
+
+    int port_pipe[2];
+    int control_pipe[2];
+    CHECK(pipe(port_pipe) == 0 && pipe(control_pipe) == 0);
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        close(port_pipe[0]);
+        close(control_pipe[1]);
+        run_server(packfile_path, port_pipe[1], control_pipe[0]);
+    }
+    close(port_pipe[1]);
+    close(control_pipe[0]);
+    unsigned short port = 0;
+    CHECK(read(port_pipe[0], &port, sizeof(port)) == sizeof(port));
+    close(port_pipe[0]);
+    auto url = "http://127.0.0.1:" + std::to_string(port);
+
+    auto output_dir = temp_dir.file("out");
+    download_and_check(url, packfile_path, output_dir);
+    check_client_connection_limit(port);
+
+    // Server must not keep serving the checksum and size of the old packfile
+    write_synthetic_vpp(packfile_path, make_synthetic_files(80, 65536, 2));
+    download_and_check(url, packfile_path, output_dir);
+
+    close(control_pipe[1]);
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::printf("level_transfer_loopback_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <csignal>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Runs tools/mock_factionfiles.py on a free port for the lifetime of the object. Tests get paths of the Python
+// interpreter and of the script as command line arguments from CMake.
+class MockFactionFiles
+{
+public:
+    MockFactionFiles(const std::string& python, const std::string& script, std::vector<std::string> args)
+    {
+        args.insert(args.begin(), {python, script, "--port", "0"});
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0) {
+            throw std::runtime_error{"pipe failed"};
+        }
+        pid_ = fork();
+        if (pid_ < 0) {
+            throw std::runtime_error{"fork failed"};
+        }
+        if (pid_ == 0) {
+            // CHECK exits without running destructors - make sure the server does not outlive the test
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            dup2(pipe_fds[1], STDOUT_FILENO);
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+            std::vector<char*> argv;
+            for (auto& arg : args) {
+                argv.push_back(arg.data());
+            }
+            argv.push_back(nullptr);
+            execv(python.c_str(), argv.data());
+            _exit(127);
+        }
+        close(pipe_fds[1]);
+        // Wait for the line with the server URL printed when the server is ready
+        std::FILE* output = fdopen(pipe_fds[0], "r");
+        char line[256];
+        bool ready = output && std::fgets(line, sizeof(line), output);
+        if (output) {
+            std::fclose(output);
+        }
+        std::string line_str = ready ? line : "";
+        auto url_pos = line_str.find("http://");
+        if (url_pos == std::string::npos) {
+            stop();
+            throw std::runtime_error{"mock server did not start"};
+        }
+        url_ = line_str.substr(url_pos);
+        while (!url_.empty() && (url_.back() == '\n' || url_.back() == '\r')) {
+            url_.pop_back();
+        }
+    }
+
+    ~MockFactionFiles()
+    {
+        stop();
+    }
+
+    MockFactionFiles(const MockFactionFiles&) = delete;
+    MockFactionFiles& operator=(const MockFactionFiles&) = delete;
+
+    [[nodiscard]] const std::string& url() const
+    {
+        return url_;
+    }
+
+private:
+    pid_t pid_ = -1;
+    std::string url_;
+
+    void stop()
+    {
+        if (pid_ > 0) {
+            kill(pid_, SIGTERM);
+            waitpid(pid_, nullptr, 0);
+            pid_ = -1;
+        }
+    }
+};
@@ -0,0 +1,126 @@
+// Checks histogram bucketing and percentiles of network statistics and counting of packets in buffers by type and by
+// client. Also measures the counting cost per packet, which is paid for every sent and received packet.
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <common/rfproto.h>
+#include "../game_patch/multi/net_stats_counters.h"
+#include "test_utils.h"
+
+static void append_packet(std::vector<std::byte>& buf, uint8_t type, uint16_t payload_size)
+{
+    RF_GamePacketHeader header{type, payload_size};
+    auto header_bytes = reinterpret_cast<const std::byte*>(&header);
+    buf.insert(buf.end(), header_bytes, header_bytes + sizeof(header));
+    buf.resize(buf.size() + payload_size);
+}
+
+static void check_histogram_buckets()
+{
+    struct
+    {
+        uint32_t value;
+        int bucket;
+    } cases[] = {
+        {0, 0}, {1, 1}, {2, 2}, {3, 2}, {4, 3}, {7, 3}, {8, 4}, {1000, 10}, {16383, 14}, {16384, 15}, {32768, 15},
+        {UINT32_MAX, 15},
+    };
+    for (const auto& c : cases) {
+        NetStatsHistogram histogram;
+        histogram.add(c.value);
+        for (int i = 0; i < NetStatsHistogram::num_buckets; ++i) {
+            CHECK(histogram.buckets[i] == (i == c.bucket ? 1u : 0u));
+        }
+    }
+}
+
+static void check_histogram_percentiles()
+{
+    NetStatsHistogram histogram;
+    CHECK(histogram.percentile(0.5f) == 0);
+    for (int i = 0; i < 99; ++i) {
+        histogram.add(100);
+    }
+    histogram.add(5000);
+    // Percentiles are upper bounds of buckets: 100 is in [64, 128) and 5000 in [4096, 8192)
+    CHECK(histogram.percentile(0.0f) == 127);
+    CHECK(histogram.percentile(0.5f) == 127);
+    CHECK(histogram.percentile(0.99f) == 127);
+    CHECK(histogram.percentile(1.0f) == 8191);
+
+    NetStatsHistogram zeros;
+    zeros.add(0);
+    CHECK(zeros.percentile(1.0f) == 0);
+    NetStatsHistogram big;
+    big.add(UINT32_MAX);
+    CHECK(big.percentile(0.5f) == 32767);
+}
+
+static void check_counting()
+{
+    NetPacketTypeStatsTable type_stats{};
+    NetClientStats client_stats;
+    std::vector<std::byte> buf;
+    append_packet(buf, RF_GPT_OBJECT_UPDATE, 97);
+    append_packet(buf, RF_GPT_SOUND, 10);
+    append_packet(buf, RF_GPT_OBJECT_UPDATE, 0);
+    net_stats_count_sent(type_stats, &client_stats, buf);
+    const auto& obj_update = type_stats[RF_GPT_OBJECT_UPDATE];
+    CHECK(obj_update.sent.count == 2 && obj_update.sent.bytes == 100 + 3);
+    CHECK(obj_update.sent_size.buckets[7] == 1 && obj_update.sent_size.buckets[2] == 1);
+    CHECK(type_stats[RF_GPT_SOUND].sent.count == 1 && type_stats[RF_GPT_SOUND].sent.bytes == 13);
+    CHECK(obj_update.recv.count == 0);
+    CHECK(client_stats.sent.count == 3 && client_stats.sent.bytes == buf.size());
+
+    // Truncated packet is counted with the bytes left in the buffer
+    std::vector<std::byte> truncated;
+    append_packet(truncated, RF_GPT_ENTITY_CREATE, 50);
+    truncated.resize(20);
+    net_stats_count_recv(type_stats, nullptr, truncated);
+    CHECK(type_stats[RF_GPT_ENTITY_CREATE].recv.count == 1);
+    CHECK(type_stats[RF_GPT_ENTITY_CREATE].recv.bytes == 20);
+    // Incomplete header at the end is ignored
+    std::vector<std::byte> partial_header;
+    append_packet(partial_header, RF_GPT_SOUND, 5);
+    partial_header.push_back(static_cast<std::byte>(RF_GPT_SOUND));
+    partial_header.push_back(std::byte{0});
+    net_stats_count_recv(type_stats, nullptr, partial_header);
+    CHECK(type_stats[RF_GPT_SOUND].recv.count == 1 && type_stats[RF_GPT_SOUND].recv.bytes == 8);
+
+    net_stats_count_sent_dropped(type_stats, &client_stats, buf);
+    CHECK(obj_update.sent_dropped == 2 && type_stats[RF_GPT_SOUND].sent_dropped == 1);
+    CHECK(client_stats.sent_dropped == 3);
+    // Dropped packets are not sent
+    CHECK(client_stats.sent.count == 3);
+}
+
+// Datagrams like the ones sent by a server: object update, sounds and a few small packets
+static void measure_overhead()
+{
+    std::vector<std::byte> buf;
+    append_packet(buf, RF_GPT_OBJECT_UPDATE, 300);
+    append_packet(buf, RF_GPT_SOUND, 17);
+    append_packet(buf, RF_GPT_WEAPON_FIRE, 21);
+    append_packet(buf, RF_GPT_PING, 0);
+    constexpr int packets_per_buf = 4;
+    constexpr int num_rounds = 2000000;
+    NetPacketTypeStatsTable type_stats{};
+    NetClientStats client_stats;
+    double seconds = measure_seconds([&]() {
+        for (int i = 0; i < num_rounds; ++i) {
+            net_stats_count_sent(type_stats, &client_stats, buf);
+        }
+    });
+    CHECK(client_stats.sent.count == static_cast<uint64_t>(num_rounds) * packets_per_buf);
+    std::printf("%.1f ns per counted packet\n", seconds * 1e9 / (static_cast<double>(num_rounds) * packets_per_buf));
+}
+
+int main()
+{
+    check_histogram_buckets();
+    check_histogram_percentiles();
+    check_counting();
+    measure_overhead();
+    std::printf("net_stats_counters_test: OK\n");
+    return 0;
+}
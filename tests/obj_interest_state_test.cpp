@@ -0,0 +1,132 @@
+// Checks when ObjInterestState re-evaluates relevance of entities and which updates it lets through: relevant
+// entities are always sent, an entity stays relevant for the linger time, its latest state is sent when it leaves
+// relevance and then refreshed at a low rate. Also measures the bookkeeping cost per object update (without the
+// relevance check itself, which needs the level geometry).
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../game_patch/multi/obj_interest_state.h"
+#include "test_utils.h"
+
+// Server sends object updates at this interval
+constexpr int frame_ms = 50;
+
+static void check_transitions()
+{
+    ObjInterestState state;
+    constexpr int handle = 1;
+    bool relevant = true;
+    int num_checks = 0;
+    bool last_was_relevant = false;
+    auto is_relevant = [&](bool was_relevant) {
+        ++num_checks;
+        last_was_relevant = was_relevant;
+        return relevant;
+    };
+
+    // Relevant entity is always sent and checked once per interval
+    int now_ms = 0;
+    for (; now_ms < 1000; now_ms += frame_ms) {
+        CHECK(state.should_send(handle, now_ms, is_relevant));
+    }
+    CHECK(num_checks == 1000 / obj_interest_check_interval_ms);
+    CHECK(last_was_relevant);
+
+    // Entity stays relevant for the linger time after the last positive check
+    relevant = false;
+    int last_relevant_check_ms = now_ms - frame_ms - (now_ms - frame_ms) % obj_interest_check_interval_ms;
+    int left_ms = -1;
+    for (; now_ms < 5000; now_ms += frame_ms) {
+        if (!state.should_send(handle, now_ms, is_relevant)) {
+            break;
+        }
+        if (left_ms < 0 && now_ms - last_relevant_check_ms >= obj_interest_linger_ms) {
+            // The update sent when the entity leaves relevance
+            left_ms = now_ms;
+        }
+    }
+    CHECK(left_ms >= 0);
+    CHECK(left_ms - last_relevant_check_ms < obj_interest_linger_ms + obj_interest_check_interval_ms);
+    CHECK(now_ms == left_ms + frame_ms);
+
+    // Irrelevant entity is refreshed once per interval
+    int num_sent = 0;
+    int start_ms = now_ms;
+    for (; now_ms < start_ms + 10 * obj_interest_refresh_interval_ms; now_ms += frame_ms) {
+        if (state.should_send(handle, now_ms, is_relevant)) {
+            ++num_sent;
+        }
+    }
+    CHECK(num_sent == 10);
+    CHECK(!last_was_relevant);
+
+    // Entity that becomes relevant again is sent after the next check
+    relevant = true;
+    int became_relevant_ms = now_ms;
+    while (!state.should_send(handle, now_ms, is_relevant)) {
+        now_ms += frame_ms;
+    }
+    CHECK(now_ms - became_relevant_ms <= obj_interest_check_interval_ms);
+    for (int i = 0; i < 20; ++i) {
+        now_ms += frame_ms;
+        CHECK(state.should_send(handle, now_ms, is_relevant));
+    }
+}
+
+static void check_prune()
+{
+    ObjInterestState state;
+    auto is_relevant = [](bool) { return false; };
+    for (int handle = 0; handle < 100; ++handle) {
+        state.should_send(handle, 0, is_relevant);
+    }
+    state.should_send(1000, obj_interest_prune_interval_ms, is_relevant);
+    state.prune(obj_interest_prune_interval_ms);
+    CHECK(state.size() == 101);
+    state.prune(obj_interest_prune_interval_ms + 1);
+    // Next prune is not due yet
+    CHECK(state.size() == 101);
+    state.prune(2 * obj_interest_prune_interval_ms);
+    CHECK(state.size() == 1);
+}
+
+// 32 clients with 32 entities each, updated every frame, half of the entities relevant
+static void measure_overhead()
+{
+    constexpr int num_clients = 32;
+    constexpr int num_entities = 32;
+    constexpr int num_frames = 2000;
+    std::vector<ObjInterestState> states(num_clients);
+    std::mt19937 rng{1};
+    std::vector<bool> relevance(num_clients * num_entities);
+    for (auto&& r : relevance) {
+        r = rng() % 2 == 0;
+    }
+    size_t num_sent = 0;
+    double seconds = measure_seconds([&]() {
+        for (int frame = 0; frame < num_frames; ++frame) {
+            int now_ms = frame * frame_ms;
+            for (int client = 0; client < num_clients; ++client) {
+                auto& state = states[client];
+                state.prune(now_ms);
+                for (int entity = 0; entity < num_entities; ++entity) {
+                    bool relevant = relevance[client * num_entities + entity];
+                    num_sent += state.should_send(entity, now_ms, [=](bool) { return relevant; });
+                }
+            }
+        }
+    });
+    double num_updates = static_cast<double>(num_clients) * num_entities * num_frames;
+    CHECK(num_sent > num_updates / 2 && num_sent < num_updates * 3 / 5);
+    std::printf("%.0f object updates, %zu sent, %.1f ns per object update\n", num_updates, num_sent,
+        seconds * 1e9 / num_updates);
+}
+
+int main()
+{
+    check_transitions();
+    check_prune();
+    measure_overhead();
+    std::printf("obj_interest_state_test: OK\n");
+    return 0;
+}
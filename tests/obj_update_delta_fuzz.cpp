@@ -0,0 +1,74 @@
+// Fuzz target for the obj_update_delta decoder. It is built the same way as rfproto_parser_fuzz (libFuzzer binary with
+// Clang, a driver running inputs from files or stdin otherwise).
+// Input: one byte selecting quantized positions, then packets fed to a single decoder, each prefixed with its length
+// byte, so later packets can use objects from earlier ones as baselines.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <vector>
+#include <common/rfproto.h>
+#include <common/rfproto-parser.h>
+#include "../game_patch/multi/obj_update_delta_codec.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    std::span input{reinterpret_cast<const std::byte*>(data), size};
+    if (input.empty()) {
+        return 0;
+    }
+    PositionQuantizer quantizer{{-150.0f, -40.0f, -150.0f}, {150.0f, 60.0f, 150.0f}, 0.005f};
+    const PositionQuantizer* quantizer_ptr = (static_cast<uint8_t>(input[0]) & 1) ? &quantizer : nullptr;
+    input = input.subspan(1);
+    ObjUpdateDeltaDecoder decoder;
+    std::vector<std::byte> out;
+    while (!input.empty()) {
+        auto len = std::min<size_t>(static_cast<uint8_t>(input[0]), input.size() - 1);
+        auto packet = input.subspan(1, len);
+        input = input.subspan(1 + len);
+        out.assign(3, std::byte{0x55});
+        if (decoder.decode(packet, out, quantizer_ptr)) {
+            // Decoded packet is processed by the game code - it must be a valid obj_update
+            auto restored = std::span{out}.subspan(3);
+            if (restored.empty() || static_cast<uint8_t>(restored[0]) != RF_GPT_OBJECT_UPDATE
+                || rf_validate_game_packets(restored, RfPacketSource::server) != RfPacketError::none) {
+                std::abort();
+            }
+        }
+        else if (out.size() != 3) {
+            // Output must not be changed when the packet is rejected
+            std::abort();
+        }
+    }
+    return 0;
+}
+
+#ifndef RFPROTO_FUZZ_LIBFUZZER
+static void run_input(std::istream& input)
+{
+    std::vector<char> data{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        run_input(std::cin);
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file{argv[i], std::ios_base::binary};
+        if (!file) {
+            std::fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        run_input(file);
+    }
+    return 0;
+}
+#endif
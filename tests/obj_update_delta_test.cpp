@@ -0,0 +1,214 @@
+// Sends a stream of obj_update packets for moving players through ObjUpdateDeltaEncoder and ObjUpdateDeltaDecoder
+// with lost packets and lost or late acknowledgements. Every received packet must be restored exactly (or with
+// positions rounded to the quantization step) and invalid input must be rejected without changing the output.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <utility>
+#include <vector>
+#include <common/rfproto.h>
+#include <common/rfproto-parser.h>
+#include "../game_patch/multi/obj_update_delta_codec.h"
+#include "test_utils.h"
+
+constexpr unsigned num_frames = 5000;
+const rf::Vector3 level_min{-150.0f, -40.0f, -150.0f};
+const rf::Vector3 level_max{150.0f, 60.0f, 150.0f};
+constexpr float pos_step = 0.005f;
+
+struct TestObject
+{
+    uint32_t handle;
+    float pos[3];
+    uint16_t angle;
+    uint8_t weapon;
+    uint8_t health;
+    uint8_t armor;
+    bool moving;
+};
+
+template<typename T>
+static void append(std::vector<std::byte>& buf, T value)
+{
+    auto bytes = reinterpret_cast<const std::byte*>(&value);
+    buf.insert(buf.end(), bytes, bytes + sizeof(value));
+}
+
+// Moves objects and returns obj_update payload describing them like the game does for players
+static std::vector<std::byte> make_obj_update(std::vector<TestObject>& objects, uint16_t ticks, std::mt19937& rng)
+{
+    std::vector<std::byte> payload;
+    for (auto& obj : objects) {
+        if (obj.moving) {
+            obj.pos[0] += static_cast<float>(rng() % 100) / 100.0f - 0.495f;
+            obj.pos[2] += static_cast<float>(rng() % 100) / 300.0f - 0.16f;
+            obj.angle += static_cast<uint16_t>(rng() % 7);
+        }
+        if (rng() % 50 == 0) {
+            --obj.health;
+        }
+        if (rng() % 200 == 0) {
+            obj.weapon = static_cast<uint8_t>(rng() % 10);
+        }
+        uint8_t flags = RF_OUF_POS_ROT_ANIM | RF_OUF_WEAPON_TYPE | RF_OUF_HEATH_ARMOR;
+        if (rng() % 10 == 0) {
+            flags |= RF_OUF_UNKNOWN3;
+        }
+        if (obj.moving) {
+            flags |= RF_OUF_AMP_FLAGS;
+        }
+        append(payload, obj.handle);
+        append(payload, flags);
+        append(payload, ticks);
+        for (float coord : obj.pos) {
+            append(payload, coord);
+        }
+        append(payload, obj.angle);
+        append(payload, static_cast<uint16_t>(0));
+        append(payload, static_cast<uint32_t>(obj.moving ? 5 : 0));
+        if (flags & RF_OUF_AMP_FLAGS) {
+            append(payload, static_cast<uint8_t>(0));
+        }
+        append(payload, obj.weapon);
+        append(payload, obj.health);
+        append(payload, obj.armor);
+        append(payload, static_cast<uint8_t>(0));
+        if (flags & RF_OUF_UNKNOWN3) {
+            auto count = static_cast<uint8_t>(rng() % 3);
+            append(payload, count);
+            for (int i = 0; i < count * 3; ++i) {
+                append(payload, static_cast<uint8_t>(rng()));
+            }
+        }
+    }
+    append(payload, UINT32_MAX);
+    CHECK(rf_validate_game_packet(RF_GPT_OBJECT_UPDATE, payload, RfPacketSource::server));
+    return payload;
+}
+
+// Compares restored payload with the original one. Positions can differ by half of the step if they are quantized.
+static void check_restored(std::span<const std::byte> original, std::span<const std::byte> restored, bool quantized)
+{
+    CHECK(restored.size() == original.size());
+    if (!quantized) {
+        CHECK(std::equal(original.begin(), original.end(), restored.begin()));
+        return;
+    }
+    RfPacketReader reader{original};
+    while (true) {
+        uint32_t handle = 0;
+        uint8_t flags = 0;
+        CHECK(reader.read(handle));
+        if (handle == UINT32_MAX) {
+            break;
+        }
+        CHECK(reader.read(flags));
+        auto fields_offset = reader.pos();
+        auto fields_size = obj_update_get_fields_size(original.subspan(fields_offset), flags);
+        CHECK(fields_size);
+        // Object header and ticks
+        CHECK(std::equal(original.begin() + fields_offset - 5, original.begin() + fields_offset + 2,
+            restored.begin() + fields_offset - 5));
+        for (int i = 0; i < 3; ++i) {
+            float original_coord = 0.0f;
+            float restored_coord = 0.0f;
+            std::memcpy(&original_coord, original.data() + fields_offset + 2 + i * 4, sizeof(float));
+            std::memcpy(&restored_coord, restored.data() + fields_offset + 2 + i * 4, sizeof(float));
+            CHECK(std::abs(original_coord - restored_coord) <= pos_step / 2 + 1e-4f);
+        }
+        // Fields after position
+        CHECK(std::equal(original.begin() + fields_offset + 14, original.begin() + fields_offset + fields_size.value(),
+            restored.begin() + fields_offset + 14));
+        CHECK(reader.skip(fields_size.value()));
+    }
+}
+
+static void check_stream(bool quantized)
+{
+    PositionQuantizer quantizer{level_min, level_max, pos_step};
+    CHECK(quantizer.is_valid());
+    const PositionQuantizer* quantizer_ptr = quantized ? &quantizer : nullptr;
+
+    std::mt19937 rng{1};
+    std::vector<TestObject> objects;
+    for (uint32_t i = 0; i < 16; ++i) {
+        objects.push_back({0x1000 + i, {}, 0, 1, 100, 50, i % 4 != 0});
+    }
+    ObjUpdateDeltaEncoder encoder;
+    ObjUpdateDeltaDecoder decoder;
+    // Acknowledgements arrive a few frames later
+    std::deque<std::pair<unsigned, std::pair<uint16_t, uint32_t>>> acks;
+    std::size_t original_bytes = 0;
+    std::size_t encoded_bytes = 0;
+    unsigned num_lost = 0;
+    uint16_t ticks = 0;
+    for (unsigned frame = 0; frame < num_frames; ++frame) {
+        ticks += 50;
+        auto payload = make_obj_update(objects, ticks, rng);
+        std::vector<std::byte> encoded;
+        CHECK(encoder.encode(payload, encoded, quantizer_ptr));
+        CHECK(encoded.size() > sizeof(RF_GamePacketHeader));
+        original_bytes += sizeof(RF_GamePacketHeader) + payload.size();
+        encoded_bytes += encoded.size();
+
+        if (rng() % 10 == 0) {
+            ++num_lost;
+        }
+        else {
+            std::vector<std::byte> restored;
+            std::span<const std::byte> encoded_payload{encoded.data() + sizeof(RF_GamePacketHeader),
+                encoded.size() - sizeof(RF_GamePacketHeader)};
+            // Baselines are only objects from acknowledged packets so every received packet can be decoded
+            CHECK(decoder.decode(encoded_payload, restored, quantizer_ptr));
+            CHECK(static_cast<uint8_t>(restored[0]) == RF_GPT_OBJECT_UPDATE);
+            check_restored(payload, std::span{restored}.subspan(sizeof(RF_GamePacketHeader)), quantized);
+            if (rng() % 10 != 0) {
+                acks.push_back({frame + 3, {decoder.get_last_seq(), decoder.get_received_bits()}});
+            }
+        }
+        while (!acks.empty() && acks.front().first <= frame) {
+            encoder.process_ack(acks.front().second.first, acks.front().second.second);
+            acks.pop_front();
+        }
+    }
+    CHECK(encoder.is_enabled());
+    // Most objects change only some fields in every frame
+    CHECK(encoded_bytes < original_bytes * 3 / 4);
+    std::printf("%s positions: %zu -> %zu bytes (%.1f%%), %u of %u packets lost\n", quantized ? "quantized" : "exact",
+        original_bytes, encoded_bytes, encoded_bytes * 100.0 / original_bytes, num_lost, num_frames);
+}
+
+// Decoder parses data from the network - random input must not change the output unless it is accepted
+static void check_invalid_input()
+{
+    PositionQuantizer quantizer{level_min, level_max, pos_step};
+    std::mt19937 rng{2};
+    ObjUpdateDeltaDecoder decoder;
+    for (int i = 0; i < 200000; ++i) {
+        std::vector<std::byte> input(rng() % 64);
+        for (auto& b : input) {
+            b = static_cast<std::byte>(rng());
+        }
+        std::vector<std::byte> out(7, std::byte{0x55});
+        if (decoder.decode(input, out, &quantizer)) {
+            std::span<const std::byte> restored{out.begin() + 7, out.end()};
+            CHECK(rf_validate_game_packets(restored, RfPacketSource::server) == RfPacketError::none);
+        }
+        else {
+            CHECK(out.size() == 7);
+        }
+    }
+}
+
+int main()
+{
+    check_stream(false);
+    check_stream(true);
+    check_invalid_input();
+    std::printf("obj_update_delta_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Replays a checked-in packet trace with PacketReplay and compares the replay summary (number of datagrams, packets
+// by type and rejected buffers) with the recorded expected result. A change of the summary means that packet
+// handlers would get different input than before. Also checks that traces are read back as they were written.
+// Usage: packet_replay_test trace.dfpt expected.txt
+//        packet_replay_test --record trace.dfpt expected.txt (writes the summary of a trace, e.g. a captured one)
+//        packet_replay_test --generate trace.dfpt expected.txt (writes a synthetic trace and its summary)
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../game_patch/multi/packet_trace.h"
+#include "rfproto_test_packets.h"
+#include "test_utils.h"
+
+static std::string read_text_file(const std::string& path)
+{
+    std::ifstream file{path, std::ios_base::binary};
+    CHECK(file);
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+// Client packets from three addresses, server packets sent back and a truncated buffer that must be rejected
+static void generate_trace(const std::string& path)
+{
+    PacketTraceWriter writer{path};
+    const PacketTraceAddr addrs[] = {{0x0100007F, 7755}, {0x0200007F, 7755}, {0x0300007F, 7756}};
+    auto packets = make_known_good_packets();
+    unsigned i = 0;
+    for (const auto& packet : packets) {
+        const auto& addr = addrs[i++ % std::size(addrs)];
+        if (packet.source == RfPacketSource::client) {
+            writer.write_recv(packet.data.data(), packet.data.size(), addr);
+        }
+        else {
+            writer.write_send(packet.data.data(), packet.data.size(), addr, 0);
+        }
+    }
+    std::vector<std::byte> combined;
+    for (const auto& packet : packets) {
+        if (packet.source == RfPacketSource::client) {
+            combined.insert(combined.end(), packet.data.begin(), packet.data.end());
+        }
+    }
+    writer.write_recv(combined.data(), combined.size(), addrs[0]);
+    writer.write_recv(combined.data(), combined.size() - 1, addrs[1]);
+    writer.close();
+}
+
+static std::string replay(const std::string& path)
+{
+    auto trace = std::make_unique<PacketTrace>(path);
+    std::vector<const TraceRecord*> expected_records;
+    for (const auto& record : trace->get_records()) {
+        if (record.type == TraceRecordType::recv) {
+            expected_records.push_back(&record);
+        }
+    }
+    auto addrs = trace->get_addrs();
+    std::size_t num_handled = 0;
+    PacketReplay replay{std::move(trace), false, [&](const TraceRecord& record) {
+        // Received records are passed to the handler in order and send records are skipped
+        CHECK(num_handled < expected_records.size() && &record == expected_records[num_handled]);
+        ++num_handled;
+    }};
+    CHECK(!replay.process());
+    CHECK(num_handled == expected_records.size());
+    for (const auto& addr : addrs) {
+        CHECK(replay.is_trace_addr(addr));
+    }
+    CHECK(!replay.is_trace_addr({0x0100007F, 1}));
+    return replay.get_summary();
+}
+
+// Records must be read back with the data, addresses and order they were written with
+static void check_write_read(const TempDir& temp_dir)
+{
+    auto path = temp_dir.file("write_read.dfpt");
+    std::vector<std::byte> data(300);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<std::byte>(i);
+    }
+    {
+        PacketTraceWriter writer{path};
+        writer.write_recv(data.data(), 0, {1, 2});
+        writer.write_send(data.data(), 200, {3, 4}, 5);
+        writer.write_recv(data.data(), data.size(), {1, 2});
+        CHECK(writer.get_num_recv() == 2 && writer.get_num_send() == 1);
+    }
+    PacketTrace trace{path};
+    const auto& records = trace.get_records();
+    CHECK(trace.get_addrs().size() == 2);
+    CHECK(records.size() == 3);
+    CHECK(records[0].type == TraceRecordType::recv && records[0].data.empty());
+    CHECK((records[0].addr == PacketTraceAddr{1, 2}));
+    CHECK(records[1].type == TraceRecordType::send && records[1].data.size() == 200);
+    CHECK((records[1].addr == PacketTraceAddr{3, 4}));
+    CHECK(records[2].data.size() == data.size());
+    CHECK(std::memcmp(records[2].data.data(), data.data(), data.size()) == 0);
+    CHECK(records[0].time <= records[1].time && records[1].time <= records[2].time);
+
+    // Truncated trace must be rejected
+    auto trace_data = read_text_file(path);
+    auto truncated_path = temp_dir.file("truncated.dfpt");
+    std::ofstream{truncated_path, std::ios_base::binary}.write(trace_data.data(),
+        static_cast<std::streamsize>(trace_data.size() - 1));
+    bool thrown = false;
+    try {
+        PacketTrace truncated{truncated_path};
+    }
+    catch (const std::exception&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main(int argc, char** argv)
+{
+    bool generate = argc == 4 && std::strcmp(argv[1], "--generate") == 0;
+    bool record = generate || (argc == 4 && std::strcmp(argv[1], "--record") == 0);
+    if (argc != 3 && !record) {
+        std::fprintf(stderr, "Usage: %s [--record|--generate] trace.dfpt expected.txt\n", argv[0]);
+        return 1;
+    }
+    std::string trace_path = argv[argc - 2];
+    std::string expected_path = argv[argc - 1];
+    try {
+        if (record) {
+            if (generate) {
+                generate_trace(trace_path);
+            }
+            std::ofstream{expected_path, std::ios_base::binary} << replay(trace_path);
+            std::printf("Written %s\n", expected_path.c_str());
+            return 0;
+        }
+        TempDir temp_dir;
+        check_write_read(temp_dir);
+        auto summary = replay(trace_path);
+        auto expected = read_text_file(expected_path);
+        if (summary != expected) {
+            std::fprintf(stderr, "Replay summary differs from %s:\n%s", expected_path.c_str(), summary.c_str());
+            return 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    std::printf("packet_replay_test: OK\n");
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Checks that positions quantized for delta-compressed object updates are restored with an error of at most half
+// of the step and that invalid configurations and positions are rejected
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include "../game_patch/multi/position_quantizer.h"
+#include "test_utils.h"
+
+static void check_round_trip(const rf::Vector3& bbox_min, const rf::Vector3& bbox_max, float step)
+{
+    PositionQuantizer quantizer{bbox_min, bbox_max, step};
+    CHECK(quantizer.is_valid());
+    CHECK(quantizer.get_encoded_size() > 0 && quantizer.get_encoded_size() <= PositionQuantizer::max_encoded_size);
+
+    std::mt19937 rng{1};
+    auto margin = PositionQuantizer::margin;
+    std::uniform_real_distribution<float> dist_x{bbox_min.x - margin, bbox_max.x + margin};
+    std::uniform_real_distribution<float> dist_y{bbox_min.y - margin, bbox_max.y + margin};
+    std::uniform_real_distribution<float> dist_z{bbox_min.z - margin, bbox_max.z + margin};
+    // Allow float rounding errors relative to the level size
+    float max_coord = std::max({std::abs(bbox_min.x), std::abs(bbox_min.y), std::abs(bbox_min.z),
+        std::abs(bbox_max.x), std::abs(bbox_max.y), std::abs(bbox_max.z)}) + margin;
+    float max_error = step / 2 + max_coord * 4e-7f;
+    std::array<std::byte, PositionQuantizer::max_encoded_size> buf;
+    for (int i = 0; i < 100000; ++i) {
+        // Include positions at the edges of the bounding box
+        rf::Vector3 pos = i == 0 ? bbox_min : i == 1 ? bbox_max : rf::Vector3{dist_x(rng), dist_y(rng), dist_z(rng)};
+        rf::Vector3 dequantized;
+        CHECK(quantizer.quantize(pos, buf, dequantized));
+        rf::Vector3 restored = quantizer.dequantize(std::span{buf}.first(quantizer.get_encoded_size()));
+        CHECK(restored == dequantized);
+        CHECK(std::abs(restored.x - pos.x) <= max_error);
+        CHECK(std::abs(restored.y - pos.y) <= max_error);
+        CHECK(std::abs(restored.z - pos.z) <= max_error);
+    }
+}
+
+int main()
+{
+    check_round_trip({-100.0f, -20.0f, -100.0f}, {100.0f, 30.0f, 100.0f}, 0.005f);
+    check_round_trip({-1500.0f, -200.0f, -1500.0f}, {1500.0f, 400.0f, 1500.0f}, 0.01f);
+    check_round_trip({5.0f, 5.0f, 5.0f}, {6.0f, 6.0f, 6.0f}, 0.25f);
+
+    // Step too small for the level size or not positive
+    CHECK(!PositionQuantizer({-5000.0f, -5000.0f, -5000.0f}, {5000.0f, 5000.0f, 5000.0f}, 0.001f).is_valid());
+    CHECK(!PositionQuantizer({-10.0f, -10.0f, -10.0f}, {10.0f, 10.0f, 10.0f}, 0.0f).is_valid());
+    CHECK(!PositionQuantizer({-10.0f, -10.0f, -10.0f}, {10.0f, 10.0f, 10.0f}, -1.0f).is_valid());
+    CHECK(!PositionQuantizer({-10.0f, -10.0f, -10.0f}, {10.0f, 10.0f, 10.0f}, NAN).is_valid());
+
+    // Positions outside of the quantized area are not quantized
+    PositionQuantizer quantizer{{-10.0f, -10.0f, -10.0f}, {10.0f, 10.0f, 10.0f}, 0.01f};
+    std::array<std::byte, PositionQuantizer::max_encoded_size> buf;
+    rf::Vector3 dequantized;
+    CHECK(!quantizer.quantize({0.0f, 100.0f, 0.0f}, buf, dequantized));
+    CHECK(!quantizer.quantize({-25.0f, 0.0f, 0.0f}, buf, dequantized));
+    CHECK(!quantizer.quantize({NAN, 0.0f, 0.0f}, buf, dequantized));
+    std::printf("position_quantizer_test: OK\n");
+    return 0;
+}
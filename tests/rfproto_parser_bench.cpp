@@ -0,0 +1,59 @@
+// Measures throughput of game packet validation done for every received buffer. Buffers are built from known-good
+// packets with a mix similar to in-game server traffic (mostly obj_update and weapon_fire).
+// Usage: rfproto_parser_bench [num_buffers] [num_rounds]
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <vector>
+#include "rfproto_test_packets.h"
+#include "test_utils.h"
+
+int main(int argc, char** argv)
+{
+    std::size_t num_buffers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    int num_rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    std::vector<const TestPacket*> pool;
+    auto packets = make_known_good_packets();
+    for (const auto& packet : packets) {
+        if (packet.source != RfPacketSource::server) {
+            continue;
+        }
+        // Weight packets sent every frame higher
+        int weight = std::string_view{packet.name} == "obj_update" ? 20 :
+            std::string_view{packet.name}.starts_with("weapon_fire") || std::string_view{packet.name} == "sound" ? 5 : 1;
+        pool.insert(pool.end(), weight, &packet);
+    }
+
+    std::mt19937 rng{1};
+    std::vector<std::vector<std::byte>> buffers(num_buffers);
+    std::size_t num_packets = 0;
+    std::size_t num_bytes = 0;
+    for (auto& buf : buffers) {
+        // Fill buffers up to the size of a typical datagram
+        while (true) {
+            const auto& packet = *pool[rng() % pool.size()];
+            if (!buf.empty() && buf.size() + packet.data.size() > 400) {
+                break;
+            }
+            buf.insert(buf.end(), packet.data.begin(), packet.data.end());
+            ++num_packets;
+        }
+        num_bytes += buf.size();
+    }
+
+    std::size_t num_errors = 0;
+    double time = measure_seconds([&] {
+        for (int round = 0; round < num_rounds; ++round) {
+            for (const auto& buf : buffers) {
+                num_errors += rf_validate_game_packets(buf, RfPacketSource::server) != RfPacketError::none;
+            }
+        }
+    });
+    CHECK(num_errors == 0);
+    std::printf("%zu buffers, %zu packets, %zu KB\n", buffers.size(), num_packets, num_bytes / 1024);
+    std::printf("%.1f M packets/s, %.1f MB/s\n", num_packets * num_rounds / time / 1e6,
+        num_bytes * num_rounds / time / 1e6);
+    return 0;
+}
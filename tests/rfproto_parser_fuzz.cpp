@@ -0,0 +1,63 @@
+// Fuzz target for the game packet parser. With Clang it is built as a libFuzzer binary, e.g.:
+//   CXX=clang++ cmake -S tests -B build-fuzz && cmake --build build-fuzz --target rfproto_parser_fuzz
+//   build-fuzz/rfproto_parser_fuzz corpus_dir
+// Other compilers get a driver that runs inputs from files passed as arguments (or stdin) so the target can be used
+// with AFL or to reproduce crashes.
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <common/rfproto-parser.h>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    std::span buf{reinterpret_cast<const std::byte*>(data), size};
+    for (auto source : {RfPacketSource::client, RfPacketSource::server}) {
+        RfGamePacketParser parser{buf, source};
+        RfGamePacketView packet;
+        std::size_t end_offset = 0;
+        while (parser.next(packet)) {
+            // Views must point inside of the input and packets must follow each other
+            if (packet.payload.data() < buf.data() || packet.payload.data() + packet.payload.size() > buf.data() + size
+                || parser.packet_offset() != end_offset) {
+                std::abort();
+            }
+            end_offset = packet.payload.data() + packet.payload.size() - buf.data();
+        }
+        std::size_t error_offset = 0;
+        auto error = rf_validate_game_packets(buf, source, &error_offset);
+        if (error != parser.error() || (error != RfPacketError::none && error_offset != parser.packet_offset())) {
+            std::abort();
+        }
+    }
+    return 0;
+}
+
+#ifndef RFPROTO_FUZZ_LIBFUZZER
+static void run_input(std::istream& input)
+{
+    std::vector<char> data{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        run_input(std::cin);
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file{argv[i], std::ios_base::binary};
+        if (!file) {
+            std::fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        run_input(file);
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,84 @@
+// Checks that the game packet parser accepts known-good packets and rejects every truncated prefix of them. Packet
+// traces recorded by the packet_capture command can be passed as arguments - their received buffers are checked
+// the same way (traces recorded on a server contain client packets, use --from-server for client traces).
+// Usage: rfproto_parser_test [--from-server] [trace.dfpt...]
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+#include "rfproto_test_packets.h"
+#include "test_utils.h"
+
+// Every prefix of a valid buffer must be rejected unless it ends exactly at a packet boundary
+static void check_buffer_prefixes(std::span<const std::byte> buf, RfPacketSource source)
+{
+    CHECK(rf_validate_game_packets(buf, source) == RfPacketError::none);
+    std::vector<std::size_t> packet_ends;
+    RfGamePacketParser parser{buf, source};
+    RfGamePacketView packet;
+    while (parser.next(packet)) {
+        packet_ends.push_back(packet.payload.data() + packet.payload.size() - buf.data());
+    }
+    CHECK(parser.error() == RfPacketError::none);
+    for (std::size_t len = 0; len < buf.size(); ++len) {
+        bool at_boundary = len == 0 || std::find(packet_ends.begin(), packet_ends.end(), len) != packet_ends.end();
+        auto error = rf_validate_game_packets(buf.first(len), source);
+        CHECK((error == RfPacketError::none) == at_boundary);
+    }
+}
+
+// Packet with a shorter payload and a header matching it must be rejected as malformed
+static void check_payload_prefixes(const TestPacket& packet)
+{
+    for (std::size_t payload_len = 0; payload_len + sizeof(RF_GamePacketHeader) < packet.data.size(); ++payload_len) {
+        std::vector<std::byte> truncated{packet.data.begin(), packet.data.begin() + sizeof(RF_GamePacketHeader) +
+            payload_len};
+        auto size = static_cast<uint16_t>(payload_len);
+        std::memcpy(&truncated[1], &size, sizeof(size));
+        std::size_t error_offset = 1;
+        auto error = rf_validate_game_packets(truncated, packet.source, &error_offset);
+        if (error != RfPacketError::malformed_payload) {
+            std::fprintf(stderr, "%s: payload of %zu bytes accepted\n", packet.name, payload_len);
+        }
+        CHECK(error == RfPacketError::malformed_payload);
+        CHECK(error_offset == 0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto packets = make_known_good_packets();
+    for (const auto& source : {RfPacketSource::client, RfPacketSource::server}) {
+        std::vector<std::byte> combined;
+        for (const auto& packet : packets) {
+            if (packet.source == source) {
+                check_buffer_prefixes(packet.data, source);
+                check_payload_prefixes(packet);
+                combined.insert(combined.end(), packet.data.begin(), packet.data.end());
+            }
+        }
+        check_buffer_prefixes(combined, source);
+    }
+
+    auto trace_source = RfPacketSource::client;
+    std::size_t num_trace_buffers = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--from-server") == 0) {
+            trace_source = RfPacketSource::server;
+            continue;
+        }
+        try {
+            for (const auto& buf : read_trace_recv_buffers(argv[i])) {
+                check_buffer_prefixes(buf, trace_source);
+                ++num_trace_buffers;
+            }
+        }
+        catch (const std::exception& e) {
+            std::fprintf(stderr, "%s: %s\n", argv[i], e.what());
+            return 1;
+        }
+    }
+    std::printf("rfproto_parser_test: OK (%zu packets, %zu trace buffers)\n", packets.size(), num_trace_buffers);
+    return 0;
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <common/rfproto.h>
+#include <common/rfproto-parser.h>
+
+// Assembles a game packet field by field. Header size is set by finish().
+class TestPacketBuilder
+{
+public:
+    TestPacketBuilder(uint8_t type)
+    {
+        buf_.resize(sizeof(RF_GamePacketHeader));
+        buf_[0] = static_cast<std::byte>(type);
+    }
+
+    template<typename T>
+    TestPacketBuilder& put(T value)
+    {
+        auto bytes = reinterpret_cast<const std::byte*>(&value);
+        buf_.insert(buf_.end(), bytes, bytes + sizeof(value));
+        return *this;
+    }
+
+    TestPacketBuilder& put_string(const char* str)
+    {
+        auto bytes = reinterpret_cast<const std::byte*>(str);
+        buf_.insert(buf_.end(), bytes, bytes + std::strlen(str) + 1);
+        return *this;
+    }
+
+    TestPacketBuilder& put_zeros(std::size_t len)
+    {
+        buf_.insert(buf_.end(), len, std::byte{0});
+        return *this;
+    }
+
+    std::vector<std::byte> finish()
+    {
+        auto size = static_cast<uint16_t>(buf_.size() - sizeof(RF_GamePacketHeader));
+        std::memcpy(&buf_[1], &size, sizeof(size));
+        return std::move(buf_);
+    }
+
+private:
+    std::vector<std::byte> buf_;
+};
+
+struct TestPacket
+{
+    const char* name;
+    RfPacketSource source;
+    std::vector<std::byte> data;
+};
+
+// Valid packets of types with a fully known layout. Packets do not have trailing data so every shorter payload is
+// malformed.
+inline std::vector<TestPacket> make_known_good_packets()
+{
+    constexpr auto client = RfPacketSource::client;
+    constexpr auto server = RfPacketSource::server;
+    std::vector<TestPacket> packets;
+    packets.push_back({"game_info", server, TestPacketBuilder{RF_GPT_GAME_INFO}
+        .put<uint8_t>(RF_VER_12).put_string("Dash Faction server").put<uint8_t>(1).put<uint8_t>(4).put<uint8_t>(32)
+        .put_string("dm02.rfl").put_string("").put<uint8_t>(0).finish()});
+    packets.push_back({"join_request", client, TestPacketBuilder{RF_GPT_JOIN_REQUEST}
+        .put<uint8_t>(RF_VER_12).put_string("Player").put<uint32_t>(5).put_string("password").put<uint32_t>(100000)
+        .put_zeros(16).finish()});
+    packets.push_back({"join_request 1.0", client, TestPacketBuilder{RF_GPT_JOIN_REQUEST}
+        .put<uint8_t>(RF_VER_10_11).put_string("Player").put<uint32_t>(5).put_string("").put<uint32_t>(100000)
+        .put_zeros(32).finish()});
+    packets.push_back({"join_accept", server, TestPacketBuilder{RF_GPT_JOIN_ACCEPT}
+        .put_string("dm02.rfl").put_zeros(sizeof(RF_JoinAcceptRest)).finish()});
+    packets.push_back({"join_deny", server, TestPacketBuilder{RF_GPT_JOIN_DENY}.put<uint8_t>(RF_JDR_SERVER_IS_FULL)
+        .finish()});
+    packets.push_back({"new_player", server, TestPacketBuilder{RF_GPT_NEW_PLAYER}
+        .put_zeros(sizeof(RF_NewPlayerPacket) - sizeof(RF_GamePacketHeader)).put_string("Player").finish()});
+    packets.push_back({"left_game", server, TestPacketBuilder{RF_GPT_LEFT_GAME}.put<uint8_t>(3).put<uint8_t>(0)
+        .finish()});
+    packets.push_back({"state_info_request", client, TestPacketBuilder{RF_GPT_STATE_INFO_REQUEST}
+        .put_string("dm02.rfl").finish()});
+    packets.push_back({"chat_line", client, TestPacketBuilder{RF_GPT_CHAT_LINE}.put<uint8_t>(3).put<uint8_t>(0)
+        .put_string("hello").finish()});
+    packets.push_back({"name_change", client, TestPacketBuilder{RF_GPT_NAME_CHANGE}.put<uint8_t>(3)
+        .put_string("Player2").finish()});
+    packets.push_back({"respawn_request", client, TestPacketBuilder{RF_GPT_RESPAWN_REQUEST}.put<uint32_t>(0)
+        .put<uint8_t>(3).finish()});
+    packets.push_back({"leave_limbo", server, TestPacketBuilder{RF_GPT_LEAVE_LIMBO}.put_string("dm02.rfl")
+        .put<uint32_t>(0x12345678).finish()});
+    packets.push_back({"team_change", client, TestPacketBuilder{RF_GPT_TEAM_CHANGE}.put<uint8_t>(3).put<uint8_t>(1)
+        .finish()});
+    packets.push_back({"netgame_update", server, TestPacketBuilder{RF_GPT_NETGAME_UPDATE}.put<uint8_t>(7)
+        .put<uint8_t>(2).put_zeros(2 * sizeof(RF_PlayerStats)).put<float>(10.0f).put<float>(600.0f).finish()});
+    packets.push_back({"ctf_flag_update", server, TestPacketBuilder{RF_GPT_CTF_FLAG_UPDATE}
+        .put<uint8_t>(0xFF).put<uint8_t>(0).put_zeros(sizeof(RF_Vector) + sizeof(RF_Matrix))
+        .put<uint8_t>(0xFF).put<uint8_t>(1).finish()});
+    packets.push_back({"obj_update", server, TestPacketBuilder{RF_GPT_OBJECT_UPDATE}
+        .put<uint32_t>(0x10).put<uint8_t>(RF_OUF_POS_ROT_ANIM | RF_OUF_HEATH_ARMOR | RF_OUF_AMP_FLAGS)
+        .put_zeros(2 + sizeof(RF_Vector) + 2 + 2 + 4).put_zeros(1).put_zeros(3)
+        .put<uint32_t>(0x11).put<uint8_t>(RF_OUF_WEAPON_TYPE | RF_OUF_UNKNOWN3 | RF_OUF_UNKNOWN4)
+        .put_zeros(1).put<uint8_t>(2).put_zeros(6).put_zeros(2)
+        .put<uint32_t>(0xFFFFFFFF).finish()});
+    packets.push_back({"obj_kill", server, TestPacketBuilder{RF_GPT_OBJECT_KILL}
+        .put_zeros(sizeof(RF_ObjectKillPacket) - sizeof(RF_GamePacketHeader)).finish()});
+    packets.push_back({"entity_create", server, TestPacketBuilder{RF_GPT_ENTITY_CREATE}.put_string("Player")
+        .put_zeros(sizeof(RF_EntityCreatePacketRest)).finish()});
+    packets.push_back({"item_create", server, TestPacketBuilder{RF_GPT_ITEM_CREATE}.put_string("")
+        .put_zeros(1 + 4 + 4 + 4 + 4 + 2 + 1 + sizeof(RF_Vector) + sizeof(RF_Matrix)).finish()});
+    packets.push_back({"weapon_fire (server)", server, TestPacketBuilder{RF_GPT_WEAPON_FIRE}.put<uint8_t>(1)
+        .put<uint8_t>(RF_WFF_UNKNOWN).put<uint8_t>(3).put_zeros(sizeof(RF_Vector) + 6).put<uint8_t>(0).finish()});
+    packets.push_back({"weapon_fire (client)", client, TestPacketBuilder{RF_GPT_WEAPON_FIRE}.put<uint8_t>(1)
+        .put<uint8_t>(0).put_zeros(sizeof(RF_Vector) + 6).finish()});
+    packets.push_back({"weapon_fire (no pos)", client, TestPacketBuilder{RF_GPT_WEAPON_FIRE}.put<uint8_t>(1)
+        .put<uint8_t>(RF_WFF_NO_POS_ROT).finish()});
+    packets.push_back({"rcon_request", client, TestPacketBuilder{RF_GPT_RCON_REQUEST}.put_string("password")
+        .finish()});
+    packets.push_back({"sound", server, TestPacketBuilder{RF_GPT_SOUND}.put<uint16_t>(10)
+        .put_zeros(sizeof(RF_Vector)).finish()});
+    packets.push_back({"glass_kill", server, TestPacketBuilder{RF_GPT_GLASS_KILL}
+        .put_zeros(sizeof(RF_GlassKillPacket) - sizeof(RF_GamePacketHeader)).finish()});
+    return packets;
+}
+
+// Returns data of received records from a packet trace written by the packet_capture command (see
+// game_patch/multi/packet_capture.h for the format)
+inline std::vector<std::vector<std::byte>> read_trace_recv_buffers(const char* filename)
+{
+    std::ifstream file{filename, std::ios_base::binary};
+    if (!file) {
+        throw std::runtime_error{std::string{"cannot open file "} + filename};
+    }
+    std::vector<char> trace{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    RfPacketReader reader{std::as_bytes(std::span{trace})};
+    auto read_varint = [&]() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = 0;
+            if (!reader.read(byte)) {
+                break;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error{"truncated packet trace"};
+    };
+
+    char magic[4];
+    uint16_t version = 0;
+    if (!reader.read(magic) || std::memcmp(magic, "DFPT", 4) != 0 || !reader.read(version) || version != 1 ||
+        !reader.skip(2)) {
+        throw std::runtime_error{"not a supported packet trace"};
+    }
+    std::vector<std::vector<std::byte>> buffers;
+    uint8_t record_type = 0;
+    while (reader.read(record_type)) {
+        if (record_type == 0) { // addr
+            if (!reader.skip(6)) {
+                throw std::runtime_error{"truncated packet trace"};
+            }
+            continue;
+        }
+        read_varint(); // time delta
+        read_varint(); // address index
+        if (record_type == 2 && !reader.skip(1)) { // send: packet kind
+            throw std::runtime_error{"truncated packet trace"};
+        }
+        auto len = static_cast<std::size_t>(read_varint());
+        auto data = reinterpret_cast<const std::byte*>(trace.data()) + reader.pos();
+        if (record_type > 2 || !reader.skip(len)) {
+            throw std::runtime_error{"invalid packet trace"};
+        }
+        if (record_type == 1) { // recv
+            buffers.emplace_back(data, data + len);
+        }
+    }
+    return buffers;
+}
@@ -0,0 +1,161 @@
+// Checks message priorities and the byte budget of the send scheduler queue: messages are sent in the order of their
+// priority, only low priority messages are dropped when they do not fit in the budget and the budget is refilled at
+// the client rate within its limits. Also measures the scheduling cost per message.
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+#include <common/rfproto.h>
+#include "../game_patch/multi/send_queue.h"
+#include "test_utils.h"
+
+static SendQueue::Message make_message(uint8_t type, size_t size)
+{
+    std::vector<std::byte> data(size);
+    data[0] = static_cast<std::byte>(type);
+    return {get_send_priority(data), std::move(data)};
+}
+
+static void check_priorities()
+{
+    CHECK(get_send_priority({}) == SendPriority::normal);
+    CHECK(make_message(RF_GPT_PING, 3).priority == SendPriority::high);
+    CHECK(make_message(RF_GPT_WEAPON_FIRE, 20).priority == SendPriority::high);
+    CHECK(make_message(RF_GPT_SOUND, 10).priority == SendPriority::high);
+    CHECK(make_message(RF_GPT_OBJECT_UPDATE, 100).priority == SendPriority::low);
+    CHECK(make_message(RF_GPT_ENTITY_CREATE, 50).priority == SendPriority::normal);
+}
+
+static void flush(SendQueue& queue, bool has_budget, std::vector<size_t>& sent, std::vector<size_t>& dropped)
+{
+    sent.clear();
+    dropped.clear();
+    queue.flush_messages(has_budget,
+        [&](const SendQueue::Message& msg) {
+            sent.push_back(msg.data.size());
+            return msg.data.size();
+        },
+        [&](const SendQueue::Message& msg) { dropped.push_back(msg.data.size()); });
+}
+
+static void queue_mixed_messages(SendQueue& queue)
+{
+    queue.messages.push_back(make_message(RF_GPT_OBJECT_UPDATE, 101));
+    queue.messages.push_back(make_message(RF_GPT_ENTITY_CREATE, 51));
+    queue.messages.push_back(make_message(RF_GPT_OBJECT_UPDATE, 102));
+    queue.messages.push_back(make_message(RF_GPT_PING, 3));
+    queue.messages.push_back(make_message(RF_GPT_ENTITY_CREATE, 52));
+    queue.messages.push_back(make_message(RF_GPT_OBJECT_UPDATE, 103));
+}
+
+// Message sizes identify messages in the sent and dropped lists
+static void check_flush_order_and_drops()
+{
+    SendQueue queue;
+    std::vector<size_t> sent;
+    std::vector<size_t> dropped;
+
+    // High and normal priority messages are never dropped, even if the budget gets negative
+    queue_mixed_messages(queue);
+    queue.budget = 40.0f;
+    flush(queue, true, sent, dropped);
+    CHECK((sent == std::vector<size_t>{3, 51, 52}));
+    CHECK((dropped == std::vector<size_t>{101, 102, 103}));
+    CHECK(queue.budget == -66.0f);
+    CHECK(queue.messages.empty());
+
+    // Object updates are sent while they fit in the budget left by other messages
+    queue_mixed_messages(queue);
+    queue.budget = 320.0f;
+    flush(queue, true, sent, dropped);
+    CHECK((sent == std::vector<size_t>{3, 51, 52, 101, 102}));
+    CHECK((dropped == std::vector<size_t>{103}));
+    CHECK(queue.budget == 11.0f);
+
+    // Budget is charged with the bytes actually sent, e.g. after delta compression
+    queue.budget = 250.0f;
+    for (size_t size : {101, 102, 103}) {
+        queue.messages.push_back(make_message(RF_GPT_OBJECT_UPDATE, size));
+    }
+    sent.clear();
+    queue.flush_messages(true,
+        [&](const SendQueue::Message& msg) {
+            sent.push_back(msg.data.size());
+            return msg.data.size() / 2;
+        },
+        [&](const SendQueue::Message&) { CHECK(false); });
+    CHECK((sent == std::vector<size_t>{101, 102, 103}));
+    CHECK(queue.budget == 98.0f);
+
+    // Without a budget nothing is dropped
+    queue.budget = -1000.0f;
+    for (size_t size : {101, 102}) {
+        queue.messages.push_back(make_message(RF_GPT_OBJECT_UPDATE, size));
+    }
+    flush(queue, false, sent, dropped);
+    CHECK(sent.size() == 2 && dropped.empty());
+    CHECK(queue.budget == -1000.0f);
+}
+
+static void check_refill()
+{
+    SendQueue queue;
+    constexpr float max_rate = 10000.0f;
+    constexpr float max_budget = 1000.0f;
+    queue.refill_budget(50, max_rate, max_budget);
+    CHECK(queue.budget == 500.0f);
+    // Unused budget is capped
+    queue.refill_budget(1050, max_rate, max_budget);
+    CHECK(queue.budget == max_budget);
+    // Client far over the budget recovers in max_budget / max_rate seconds
+    queue.budget = -1e6f;
+    queue.refill_budget(1050, max_rate, max_budget);
+    CHECK(queue.budget == -max_budget);
+    // Time going back does not remove budget and long pauses count as one second
+    queue.budget = 0.0f;
+    queue.refill_budget(1000, max_rate, max_budget);
+    CHECK(queue.budget == 0.0f);
+    queue.refill_budget(100000, max_rate, 1e6f);
+    CHECK(queue.budget == max_rate);
+}
+
+// Client receiving object updates of 32 players and other messages every frame with a budget that fits only some
+// of them. Message allocation is included because the scheduler copies every queued message.
+static void measure_overhead()
+{
+    constexpr int num_frames = 20000;
+    constexpr int messages_per_frame = 40;
+    constexpr float max_rate = 80000.0f;
+    SendQueue queue;
+    size_t num_sent = 0;
+    size_t num_dropped = 0;
+    double seconds = measure_seconds([&]() {
+        for (int frame = 0; frame < num_frames; ++frame) {
+            for (int i = 0; i < messages_per_frame; ++i) {
+                uint8_t type = i % 4 == 0 ? RF_GPT_SOUND : (i % 4 == 1 ? RF_GPT_ENTITY_CREATE : RF_GPT_OBJECT_UPDATE);
+                queue.messages.push_back(make_message(type, 20 + i));
+            }
+            queue.refill_budget(frame * 16, max_rate, max_rate * 0.1f);
+            queue.flush_messages(true,
+                [&](const SendQueue::Message& msg) {
+                    ++num_sent;
+                    return msg.data.size();
+                },
+                [&](const SendQueue::Message&) { ++num_dropped; });
+        }
+    });
+    CHECK(num_sent + num_dropped == static_cast<size_t>(num_frames) * messages_per_frame);
+    CHECK(num_dropped > 0 && num_sent > num_dropped);
+    std::printf("%zu messages sent, %zu dropped, %.1f ns per message\n", num_sent, num_dropped,
+        seconds * 1e9 / (num_sent + num_dropped));
+}
+
+int main()
+{
+    check_priorities();
+    check_flush_order_and_drops();
+    check_refill();
+    measure_overhead();
+    std::printf("send_queue_test: OK\n");
+    return 0;
+}
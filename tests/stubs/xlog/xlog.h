@@ -0,0 +1,75 @@
+#pragma once
+
+// Replacement of xlog for game code compiled natively in tests (the library itself depends on Windows).
+// Warnings and errors are printed to stderr, other messages are discarded.
+
+#include <cstdio>
+#include <format>
+#include <string>
+#include <utility>
+
+namespace xlog
+{
+    struct NullStream
+    {
+        template<typename T>
+        NullStream& operator<<(const T&)
+        {
+            return *this;
+        }
+    };
+
+    inline void print(const char* level, const std::string& msg)
+    {
+        std::fprintf(stderr, "[%s] %s\n", level, msg.c_str());
+    }
+
+    template<typename... Args>
+    void error(std::format_string<Args...> fmt, Args&&... args)
+    {
+        print("error", std::format(fmt, std::forward<Args>(args)...));
+    }
+
+    template<typename... Args>
+    void warn(std::format_string<Args...> fmt, Args&&... args)
+    {
+        print("warn", std::format(fmt, std::forward<Args>(args)...));
+    }
+
+    template<typename... Args>
+    void info(std::format_string<Args...>, Args&&...)
+    {}
+
+    template<typename... Args>
+    void debug(std::format_string<Args...>, Args&&...)
+    {}
+
+    template<typename... Args>
+    void trace(std::format_string<Args...>, Args&&...)
+    {}
+
+    inline NullStream error()
+    {
+        return {};
+    }
+
+    inline NullStream warn()
+    {
+        return {};
+    }
+
+    inline NullStream info()
+    {
+        return {};
+    }
+
+    inline NullStream debug()
+    {
+        return {};
+    }
+
+    inline NullStream trace()
+    {
+        return {};
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Aborts the test if the condition is false (unlike assert it is not disabled in release builds)
+#define CHECK(cond)                                                                    \
+    do {                                                                               \
+        if (!(cond)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                              \
+        }                                                                              \
+    } while (false)
+
+// Directory removed with its contents when the object is destroyed
+class TempDir
+{
+public:
+    TempDir()
+    {
+        path_ = std::filesystem::temp_directory_path() / ("df_test_" + std::to_string(getpid()));
+        std::filesystem::create_directories(path_);
+    }
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    [[nodiscard]] std::string file(const std::string& name) const
+    {
+        return (path_ / name).string();
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+template<typename F>
+double measure_seconds(F fun)
+{
+    auto start = std::chrono::steady_clock::now();
+    fun();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Removes file contents from the page cache so the next read comes from the disk (Linux only)
+inline void drop_page_cache(const char* path)
+{
+#ifdef POSIX_FADV_DONTNEED
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+}
@@ -0,0 +1,71 @@
+// Compares getting directories of packfiles loaded on startup by parsing them (no index cache, e.g. the first start)
+// with looking them up in a warm index cache. Cold runs drop packfiles and the cache from the page cache first
+// (Linux only).
+// Usage: vpackfile_index_cache_bench [num_packfiles] [num_files_per_packfile]
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include "../game_patch/misc/vpackfile_directory_parser.h"
+#include "../game_patch/misc/vpackfile_index_cache.h"
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+int main(int argc, char** argv)
+{
+    std::size_t num_packfiles = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20;
+    std::size_t num_files = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 3000;
+
+    TempDir temp_dir;
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < num_packfiles; ++i) {
+        paths.push_back(temp_dir.file("bench" + std::to_string(i) + ".vpp"));
+        write_synthetic_vpp(paths.back(), make_synthetic_files(num_files, 256, static_cast<unsigned>(i)));
+    }
+    auto cache_path = temp_dir.file("index.bin");
+    // Same number of workers as vpackfile_add_batch
+    std::size_t max_workers = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, 4);
+
+    VPackfileIndexCache cache;
+    for (auto& result : vpackfile_parse_directories(paths, max_workers)) {
+        CHECK(result.index);
+    }
+    for (const auto& path : paths) {
+        cache.add(path, vpackfile_parse_directory(path));
+    }
+    CHECK(cache.save(cache_path.c_str()));
+    std::printf("%zu packfiles, %zu files each, index cache %zu KB\n", num_packfiles, num_files,
+        static_cast<std::size_t>(std::filesystem::file_size(cache_path) >> 10));
+
+    auto drop_all = [&]() {
+        for (const auto& path : paths) {
+            drop_page_cache(path.c_str());
+        }
+        drop_page_cache(cache_path.c_str());
+    };
+    for (bool cold : {true, false}) {
+        if (cold) {
+            drop_all();
+        }
+        double parse_time = measure_seconds([&] {
+            for (auto& result : vpackfile_parse_directories(paths, max_workers)) {
+                CHECK(result.index);
+            }
+        });
+        if (cold) {
+            drop_all();
+        }
+        double cache_time = measure_seconds([&] {
+            VPackfileIndexCache warm_cache;
+            CHECK(warm_cache.load(cache_path.c_str()));
+            for (const auto& path : paths) {
+                CHECK(warm_cache.find(path));
+            }
+        });
+        std::printf("%s: no cache %.2f ms, warm index cache %.2f ms\n", cold ? "cold" : "warm", parse_time * 1e3,
+            cache_time * 1e3);
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Checks that packfile directories stored in the index cache are restored unchanged, that modified packfiles are
+// not matched and that saving replaces the cache file without leaving a temporary file behind
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../game_patch/misc/vpackfile_directory_parser.h"
+#include "../game_patch/misc/vpackfile_index_cache.h"
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+static bool is_same_index(const VPackfileIndexCache::Index& a, const VPackfileIndexCache::Index& b)
+{
+    return a.total_size == b.total_size && a.file_infos.size() == b.file_infos.size() &&
+        std::memcmp(a.file_infos.data(), b.file_infos.data(), a.file_infos.size() * sizeof(vpp::FileInfo)) == 0;
+}
+
+int main()
+{
+    TempDir temp_dir;
+    std::vector<std::string> paths;
+    for (unsigned i = 0; i < 3; ++i) {
+        paths.push_back(temp_dir.file("test" + std::to_string(i) + ".vpp"));
+        write_synthetic_vpp(paths.back(), make_synthetic_files(100 + 50 * i, 1000, i));
+    }
+    auto cache_path = temp_dir.file("index.bin");
+
+    VPackfileIndexCache cache;
+    CHECK(!cache.load(cache_path.c_str()));
+    std::vector<VPackfileIndexCache::Index> indices;
+    for (const auto& path : paths) {
+        CHECK(!cache.find(path));
+        indices.push_back(vpackfile_parse_directory(path));
+        cache.add(path, indices.back());
+    }
+    cache.set_checksum(paths[0], 0x12345678);
+    CHECK(cache.is_dirty());
+    CHECK(cache.save(cache_path.c_str()));
+    CHECK(!cache.is_dirty());
+    CHECK(!std::filesystem::exists(cache_path + ".tmp"));
+
+    // Replace one packfile with a different one
+    write_synthetic_vpp(paths[1], make_synthetic_files(10, 1000, 100));
+
+    VPackfileIndexCache loaded_cache;
+    CHECK(loaded_cache.load(cache_path.c_str()));
+    const auto* index0 = loaded_cache.find(paths[0]);
+    CHECK(index0 && is_same_index(*index0, indices[0]));
+    CHECK(loaded_cache.get_checksum(paths[0]) == 0x12345678u);
+    CHECK(!loaded_cache.find(paths[1]));
+    const auto* index2 = loaded_cache.find(paths[2]);
+    CHECK(index2 && is_same_index(*index2, indices[2]));
+    CHECK(!loaded_cache.get_checksum(paths[2]));
+    CHECK(loaded_cache.num_hits() == 2 && loaded_cache.num_misses() == 1);
+
+    // Saving over an existing cache keeps only packfiles used in this session
+    CHECK(loaded_cache.save(cache_path.c_str()));
+    VPackfileIndexCache resaved_cache;
+    CHECK(resaved_cache.load(cache_path.c_str()));
+    CHECK(resaved_cache.find(paths[0]) && !resaved_cache.find(paths[1]));
+
+    // Truncated cache is rejected as a whole
+    std::filesystem::resize_file(cache_path, std::filesystem::file_size(cache_path) - 100);
+    VPackfileIndexCache truncated_cache;
+    CHECK(!truncated_cache.load(cache_path.c_str()));
+    CHECK(!truncated_cache.find(paths[0]));
+
+    std::printf("vpackfile_index_cache_test: OK\n");
+    return 0;
+}
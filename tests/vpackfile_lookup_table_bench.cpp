@@ -0,0 +1,100 @@
+// Compares VPackfileLookupTable with a std::unordered_map keyed by lower-case copies of names (the approach used
+// before the table was introduced) on a set of names similar to the ones found in game packfiles
+// Usage: vpackfile_lookup_table_bench [num_names] [num_rounds]
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <patch_common/MemUtils.h>
+#include "../game_patch/misc/vpackfile_lookup_table.h"
+#include "test_utils.h"
+
+static std::string to_lower(std::string str)
+{
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char ch) { return std::tolower(ch); });
+    return str;
+}
+
+static std::vector<std::string> make_names(std::size_t num_names, unsigned seed)
+{
+    static const char* prefixes[] = {"", "Edf_", "ult_", "Merc_", "Tech_", "Cave_", "Rock_", "weapon_", "Mp_"};
+    static const char* exts[] = {".tga", ".v3d", ".vfx", ".mvf", ".wav", ".tbl", ".rfl", ".vbm"};
+    std::mt19937 rng{seed};
+    std::vector<std::string> names;
+    names.reserve(num_names);
+    for (std::size_t i = 0; i < num_names; ++i) {
+        names.push_back(std::string{prefixes[rng() % std::size(prefixes)]} + "file" + std::to_string(i) +
+            exts[rng() % std::size(exts)]);
+    }
+    return names;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t num_names = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 30000;
+    int num_rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    auto names = make_names(num_names, 1);
+    std::vector<rf::VPackfileEntry> entries(names.size());
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        entries[i].name = names[i].c_str();
+    }
+    // Game code often requests files using different case than the one stored in packfiles
+    std::vector<std::string> queries;
+    std::mt19937 rng{2};
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        queries.push_back(rng() % 2 ? to_lower(names[rng() % names.size()]) : names[rng() % names.size()]);
+        queries.push_back("missing" + std::to_string(i) + ".tga");
+    }
+
+    VPackfileLookupTable table;
+    std::unordered_map<std::string, rf::VPackfileEntry*> map;
+    double table_insert_time = measure_seconds([&] {
+        for (int round = 0; round < num_rounds; ++round) {
+            table.clear();
+            for (auto& entry : entries) {
+                table.insert(&entry);
+            }
+        }
+    });
+    double map_insert_time = measure_seconds([&] {
+        for (int round = 0; round < num_rounds; ++round) {
+            map.clear();
+            for (auto& entry : entries) {
+                map.emplace(to_lower(entry.name), &entry);
+            }
+        }
+    });
+    CHECK(table.size() == map.size());
+
+    std::size_t table_hits = 0;
+    std::size_t map_hits = 0;
+    double table_find_time = measure_seconds([&] {
+        for (int round = 0; round < num_rounds; ++round) {
+            for (const auto& query : queries) {
+                table_hits += table.find(query.c_str()) != nullptr;
+            }
+        }
+    });
+    double map_find_time = measure_seconds([&] {
+        for (int round = 0; round < num_rounds; ++round) {
+            for (const auto& query : queries) {
+                map_hits += map.find(to_lower(query)) != map.end();
+            }
+        }
+    });
+    CHECK(table_hits == map_hits);
+
+    std::size_t num_inserts = entries.size() * num_rounds;
+    std::size_t num_finds = queries.size() * num_rounds;
+    std::printf("%zu names, %zu queries (half of them missing)\n", names.size(), queries.size());
+    std::printf("insert: lookup table %.1f ns, unordered_map %.1f ns\n", table_insert_time * 1e9 / num_inserts,
+        map_insert_time * 1e9 / num_inserts);
+    std::printf("find: lookup table %.1f ns, unordered_map %.1f ns\n", table_find_time * 1e9 / num_finds,
+        map_find_time * 1e9 / num_finds);
+    return 0;
+}
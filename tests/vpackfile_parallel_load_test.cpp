@@ -0,0 +1,128 @@
+// Checks that packfile directories parsed by multiple workers (as done by vpackfile_add_batch) produce the same
+// indices and the same lookup table as directories parsed one by one on the calling thread
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <vpp/ArchiveView.h>
+#include <patch_common/MemUtils.h>
+#include "../game_patch/misc/vpackfile_directory_parser.h"
+#include "../game_patch/misc/vpackfile_lookup_table.h"
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+struct LoadedPackfiles
+{
+    std::vector<std::unique_ptr<rf::VPackfile>> packfiles;
+    std::vector<std::unique_ptr<std::string[]>> names;
+    VPackfileLookupTable lookup_table;
+};
+
+// Packfiles loaded from the game root directory can always override entries of earlier packfiles (see
+// is_lookup_table_entry_override_allowed)
+static bool is_root_packfile_override_allowed(rf::VPackfileEntry*, rf::VPackfileEntry*)
+{
+    return true;
+}
+
+// Adds entries in load order through the same lookup table merge as vpackfile_add_to_lookup_table
+static void load_packfiles(LoadedPackfiles& loaded, const std::vector<VPackfileParseResult>& results)
+{
+    for (const auto& result : results) {
+        if (!result.index) {
+            continue;
+        }
+        const auto& file_infos = result.index->file_infos;
+        auto packfile = std::make_unique<rf::VPackfile>();
+        packfile->num_files = file_infos.size();
+        packfile->files.resize(file_infos.size());
+        auto names = std::make_unique<std::string[]>(file_infos.size());
+        for (std::size_t i = 0; i < file_infos.size(); ++i) {
+            names[i] = vpp::ArchiveView::entry_name(file_infos[i]);
+            auto& entry = packfile->files[i];
+            entry.name = names[i].c_str();
+            entry.size = file_infos[i].size;
+            entry.parent = packfile.get();
+            loaded.lookup_table.insert_or_override(&entry, is_root_packfile_override_allowed);
+        }
+        loaded.packfiles.push_back(std::move(packfile));
+        loaded.names.push_back(std::move(names));
+    }
+}
+
+// Maps names to packfile index and entry index so tables built from different packfile objects can be compared
+static std::map<std::string, std::tuple<std::size_t, std::size_t>> describe_lookup_table(const LoadedPackfiles& loaded)
+{
+    std::map<std::string, std::tuple<std::size_t, std::size_t>> result;
+    loaded.lookup_table.for_each([&](const rf::VPackfileEntry* entry) {
+        for (std::size_t i = 0; i < loaded.packfiles.size(); ++i) {
+            const auto& files = loaded.packfiles[i]->files;
+            if (entry->parent == loaded.packfiles[i].get()) {
+                result[entry->name] = {i, static_cast<std::size_t>(entry - files.data())};
+            }
+        }
+    });
+    return result;
+}
+
+int main()
+{
+    TempDir temp_dir;
+    std::vector<std::string> paths;
+    for (unsigned i = 0; i < 12; ++i) {
+        // Packfiles share names like file_0.tga so later packfiles override some entries of earlier ones
+        auto files = make_synthetic_files(300 + 100 * i, 256, i);
+        files.push_back({"shared.tbl", {}});
+        paths.push_back(temp_dir.file("test" + std::to_string(i) + ".vpp"));
+        write_synthetic_vpp(paths.back(), files);
+    }
+    // Errors must be reported for the same packfiles
+    paths.insert(paths.begin() + 3, temp_dir.file("missing.vpp"));
+    paths.push_back(temp_dir.file("invalid.vpp"));
+    std::FILE* invalid_file = std::fopen(paths.back().c_str(), "wb");
+    CHECK(invalid_file);
+    std::fputs("not a packfile", invalid_file);
+    std::fclose(invalid_file);
+
+    auto serial_results = vpackfile_parse_directories(paths, 1);
+    LoadedPackfiles serial_loaded;
+    load_packfiles(serial_loaded, serial_results);
+    auto serial_table = describe_lookup_table(serial_loaded);
+    CHECK(serial_table.size() == serial_loaded.lookup_table.size());
+    CHECK(std::get<0>(serial_table.at("shared.tbl")) == serial_loaded.packfiles.size() - 1);
+
+    // Denied override keeps the entry of the earlier packfile
+    rf::VPackfileEntry denied_entry{};
+    denied_entry.name = "SHARED.TBL";
+    const auto* shared_entry = serial_loaded.lookup_table.find("shared.tbl");
+    CHECK(!serial_loaded.lookup_table.insert_or_override(&denied_entry, [](auto*, auto*) { return false; }));
+    CHECK(serial_loaded.lookup_table.find("shared.tbl") == shared_entry);
+
+    // Repeat a few times because results could depend on the order in which workers pick packfiles
+    for (int iteration = 0; iteration < 20; ++iteration) {
+        auto parallel_results = vpackfile_parse_directories(paths, 4);
+        CHECK(parallel_results.size() == serial_results.size());
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            const auto& serial = serial_results[i];
+            const auto& parallel = parallel_results[i];
+            CHECK(serial.index.has_value() == parallel.index.has_value());
+            CHECK(serial.error == parallel.error);
+            if (serial.index) {
+                CHECK(serial.index->total_size == parallel.index->total_size);
+                CHECK(serial.index->file_infos.size() == parallel.index->file_infos.size());
+                CHECK(std::memcmp(serial.index->file_infos.data(), parallel.index->file_infos.data(),
+                    serial.index->file_infos.size() * sizeof(vpp::FileInfo)) == 0);
+            }
+        }
+        CHECK(!parallel_results[3].index && !parallel_results.back().index);
+
+        LoadedPackfiles parallel_loaded;
+        load_packfiles(parallel_loaded, parallel_results);
+        CHECK(describe_lookup_table(parallel_loaded) == serial_table);
+    }
+    std::printf("vpackfile_parallel_load_test: OK (%zu names)\n", serial_table.size());
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Measures packing throughput of ArchiveWriter and unpacking throughput of ArchiveView (extracting all entries to
+// separate files like vpp_tool extract) on synthetic files
+// Usage: vpp_archive_writer_bench [num_files] [max_file_size]
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <vpp/ArchiveView.h>
+#include <vpp/MappedFile.h>
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+int main(int argc, char** argv)
+{
+    std::size_t num_files = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    std::size_t max_file_size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 65536;
+
+    TempDir temp_dir;
+    auto files = make_synthetic_files(num_files, max_file_size, 1);
+    std::size_t total_size = 0;
+    for (const auto& file : files) {
+        total_size += file.data.size();
+    }
+    auto path = temp_dir.file("bench.vpp");
+    auto output_dir = temp_dir.file("extracted");
+    std::filesystem::create_directories(output_dir);
+
+    double pack_time = measure_seconds([&] { write_synthetic_vpp(path, files); });
+    double unpack_time = measure_seconds([&] {
+        vpp::MappedFile mapped_file{path.c_str()};
+        vpp::ArchiveView archive{mapped_file.bytes()};
+        archive.for_each_entry([&](const vpp::Entry& entry) {
+            auto data = archive.entry_data(entry);
+            CHECK(data.size() == entry.size);
+            std::ofstream file{output_dir + "/" + std::string{entry.name}, std::ios_base::binary};
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            CHECK(file);
+        });
+    });
+    double total_mb = static_cast<double>(total_size) / (1024 * 1024);
+    std::printf("%zu files, %.1f MB: pack %.1f ms (%.0f MB/s), unpack %.1f ms (%.0f MB/s)\n", num_files, total_mb,
+        pack_time * 1e3, total_mb / pack_time, unpack_time * 1e3, total_mb / unpack_time);
+    return 0;
+}
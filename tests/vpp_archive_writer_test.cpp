@@ -0,0 +1,103 @@
+// Checks that packfiles written by ArchiveWriter are read back by ArchiveView with the same names and contents
+// (empty files, files spanning many blocks, names of maximal length) and that invalid input is rejected
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <vpp/ArchiveView.h>
+#include <vpp/ArchiveWriter.h>
+#include <vpp/MappedFile.h>
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+static void check_read_back(const std::string& path, const std::vector<SyntheticFile>& files)
+{
+    vpp::MappedFile mapped_file{path.c_str()};
+    vpp::ArchiveView archive{mapped_file.bytes()};
+    CHECK(archive.num_files() == files.size());
+    CHECK(archive.header().total_size == mapped_file.size());
+    CHECK(mapped_file.size() % vpp::block_size == 0);
+    std::size_t idx = 0;
+    archive.for_each_entry([&](const vpp::Entry& entry) {
+        const auto& file = files[idx++];
+        CHECK(entry.name == file.name);
+        CHECK(entry.size == file.data.size());
+        auto data = archive.entry_data(entry);
+        CHECK(data.size() == file.data.size());
+        CHECK(std::memcmp(data.data(), file.data.data(), data.size()) == 0);
+    });
+    CHECK(idx == files.size());
+}
+
+template<typename F>
+static bool throws_runtime_error(F fun)
+{
+    try {
+        fun();
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    TempDir temp_dir;
+
+    // Directory spanning several blocks, empty files, files of exactly one block and files of many blocks
+    auto files = make_synthetic_files(100, 5 * vpp::block_size, 1);
+    files[0].data.clear();
+    files[1].data.resize(vpp::block_size);
+    files[2].data.resize(vpp::block_size + 1);
+    files[3].data.resize(100 * vpp::block_size + 7);
+    files.back().data.clear();
+    files[4].name = std::string(vpp::max_name_len - 1, 'n');
+    auto path = temp_dir.file("test.vpp");
+    write_synthetic_vpp(path, files);
+    check_read_back(path, files);
+
+    // Packfile without files
+    auto empty_path = temp_dir.file("empty.vpp");
+    write_synthetic_vpp(empty_path, {});
+    check_read_back(empty_path, {});
+
+    // Names can use all 60 bytes of the directory record without a terminating zero. The writer does not create such
+    // names (other tools may expect the terminator) but they must be read correctly.
+    std::string long_name(vpp::max_name_len, 'x');
+    long_name.replace(long_name.size() - 4, 4, ".tga");
+    {
+        std::fstream file{path, std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+        file.seekp(static_cast<std::streamoff>(vpp::block_offset(1) + 5 * sizeof(vpp::FileInfo)));
+        file.write(long_name.data(), static_cast<std::streamsize>(long_name.size()));
+        CHECK(file);
+    }
+    files[5].name = long_name;
+    check_read_back(path, files);
+
+    // Invalid input
+    auto invalid_path = temp_dir.file("invalid.vpp");
+    CHECK(throws_runtime_error([&] {
+        vpp::ArchiveWriter writer{invalid_path.c_str(), 1};
+        writer.add_file(long_name, std::vector<std::byte>(1));
+    }));
+    CHECK(throws_runtime_error([&] {
+        vpp::ArchiveWriter writer{invalid_path.c_str(), 1};
+        writer.add_file("", std::vector<std::byte>(1));
+    }));
+    CHECK(throws_runtime_error([&] {
+        vpp::ArchiveWriter writer{invalid_path.c_str(), 1};
+        writer.add_file("a.tga", std::vector<std::byte>(1));
+        writer.add_file("b.tga", std::vector<std::byte>(1));
+    }));
+    CHECK(throws_runtime_error([&] {
+        vpp::ArchiveWriter writer{invalid_path.c_str(), 2};
+        writer.add_file("a.tga", std::vector<std::byte>(1));
+        writer.finish();
+    }));
+
+    std::printf("vpp_archive_writer_test: OK\n");
+    return 0;
+}
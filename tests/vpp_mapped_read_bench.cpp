@@ -0,0 +1,82 @@
+// Compares reading all entries of a synthetic packfile through the stream path used by the game (rf::File opens the
+// packfile, seeks to the entry block and reads it) with views into a memory mapping. Cold runs drop the packfile from
+// the page cache first (Linux only).
+// Usage: vpp_mapped_read_bench [num_files] [max_file_size]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <vpp/ArchiveView.h>
+#include <vpp/MappedFile.h>
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+static std::vector<vpp::Entry> read_directory(const char* path)
+{
+    vpp::MappedFile mapped_file{path};
+    vpp::ArchiveView archive{mapped_file.bytes()};
+    std::vector<vpp::Entry> entries;
+    archive.for_each_entry([&](const vpp::Entry& entry) { entries.push_back(entry); });
+    return entries;
+}
+
+static unsigned read_through_stream(const char* path, const std::vector<vpp::Entry>& entries)
+{
+    unsigned checksum = 0;
+    std::vector<std::byte> buf;
+    for (const auto& entry : entries) {
+        std::FILE* file = std::fopen(path, "rb");
+        CHECK(file);
+        buf.resize(entry.size);
+        std::fseek(file, static_cast<long>(vpp::block_offset(entry.block)), SEEK_SET);
+        CHECK(std::fread(buf.data(), 1, buf.size(), file) == buf.size());
+        std::fclose(file);
+        for (std::size_t i = 0; i < buf.size(); i += 64) {
+            checksum += static_cast<unsigned>(buf[i]);
+        }
+    }
+    return checksum;
+}
+
+static unsigned read_through_mapping(const char* path)
+{
+    vpp::MappedFile mapped_file{path};
+    vpp::ArchiveView archive{mapped_file.bytes()};
+    unsigned checksum = 0;
+    archive.for_each_entry([&](const vpp::Entry& entry) {
+        auto view = archive.entry_data(entry);
+        for (std::size_t i = 0; i < view.size(); i += 64) {
+            checksum += static_cast<unsigned>(view[i]);
+        }
+    });
+    return checksum;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t num_files = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    std::size_t max_file_size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16384;
+
+    TempDir temp_dir;
+    auto path = temp_dir.file("bench.vpp");
+    write_synthetic_vpp(path, make_synthetic_files(num_files, max_file_size, 1));
+    auto entries = read_directory(path.c_str());
+    std::printf("%zu entries, %zu MB\n", entries.size(), std::filesystem::file_size(path) >> 20);
+
+    unsigned stream_checksum = 0;
+    unsigned mapped_checksum = 0;
+    for (bool cold : {true, false}) {
+        if (cold) {
+            drop_page_cache(path.c_str());
+        }
+        double stream_time = measure_seconds([&] { stream_checksum = read_through_stream(path.c_str(), entries); });
+        if (cold) {
+            drop_page_cache(path.c_str());
+        }
+        double mapped_time = measure_seconds([&] { mapped_checksum = read_through_mapping(path.c_str()); });
+        CHECK(stream_checksum == mapped_checksum);
+        std::printf("%s: stream %.1f ms (%.2f us per entry), mapped %.1f ms (%.2f us per entry)\n",
+            cold ? "cold" : "warm", stream_time * 1e3, stream_time * 1e6 / entries.size(), mapped_time * 1e3,
+            mapped_time * 1e6 / entries.size());
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Checks that entry views returned by the mapped packfile backend have the same contents as entries read through
+// the stream path used by the game (fseek to the entry block and fread)
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <vpp/ArchiveView.h>
+#include <vpp/MappedFile.h>
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+static std::vector<std::byte> read_entry_through_stream(const char* path, const vpp::Entry& entry)
+{
+    std::FILE* file = std::fopen(path, "rb");
+    CHECK(file);
+    std::vector<std::byte> buf(entry.size);
+    CHECK(std::fseek(file, static_cast<long>(vpp::block_offset(entry.block)), SEEK_SET) == 0);
+    CHECK(std::fread(buf.data(), 1, buf.size(), file) == buf.size());
+    std::fclose(file);
+    return buf;
+}
+
+int main()
+{
+    TempDir temp_dir;
+    auto path = temp_dir.file("test.vpp");
+    // Include empty files and files ending exactly at a block boundary
+    auto files = make_synthetic_files(2000, 3 * vpp::block_size, 1);
+    files[0].data.clear();
+    files[1].data.resize(vpp::block_size);
+    write_synthetic_vpp(path, files);
+
+    vpp::MappedFile mapped_file{path.c_str()};
+    vpp::ArchiveView archive{mapped_file.bytes()};
+    CHECK(archive.num_files() == files.size());
+
+    std::size_t idx = 0;
+    archive.for_each_entry([&](const vpp::Entry& entry) {
+        const auto& file = files[idx++];
+        CHECK(entry.name == file.name);
+        CHECK(entry.size == file.data.size());
+        auto view = archive.entry_data(entry);
+        CHECK(view.size() == file.data.size());
+        CHECK(std::memcmp(view.data(), file.data.data(), view.size()) == 0);
+        if (idx % 100 == 0) {
+            auto stream_data = read_entry_through_stream(path.c_str(), entry);
+            CHECK(std::memcmp(view.data(), stream_data.data(), view.size()) == 0);
+        }
+    });
+    CHECK(idx == files.size());
+
+    // Views of a truncated packfile must not point outside of the mapping
+    std::filesystem::resize_file(path, vpp::block_offset(vpp::first_data_block(files.size())) + vpp::block_size);
+    vpp::MappedFile truncated_file{path.c_str()};
+    vpp::ArchiveView truncated_archive{truncated_file.bytes()};
+    std::size_t num_valid_views = 0;
+    truncated_archive.for_each_entry([&](const vpp::Entry& entry) {
+        auto view = truncated_archive.entry_data(entry);
+        if (!view.empty()) {
+            CHECK(view.data() + view.size() <= truncated_file.data() + truncated_file.size());
+            ++num_valid_views;
+        }
+    });
+    CHECK(num_valid_views < files.size());
+    std::printf("vpp_mapped_read_test: OK\n");
+    return 0;
+}
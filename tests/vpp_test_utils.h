@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+#include <vpp/ArchiveWriter.h>
+
+struct SyntheticFile
+{
+    std::string name;
+    std::vector<std::byte> data;
+};
+
+// Generates files with names like the ones found in game packfiles and random contents
+inline std::vector<SyntheticFile> make_synthetic_files(std::size_t num_files, std::size_t max_size, unsigned seed,
+    const std::string& name_prefix = "")
+{
+    static const char* exts[] = {".tga", ".v3d", ".vfx", ".mvf", ".wav", ".tbl", ".rfl", ".vbm"};
+    std::mt19937 rng{seed};
+    std::vector<SyntheticFile> files(num_files);
+    for (std::size_t i = 0; i < num_files; ++i) {
+        files[i].name = name_prefix + "file_" + std::to_string(i) + exts[rng() % std::size(exts)];
+        files[i].data.resize(rng() % (max_size + 1));
+        for (auto& b : files[i].data) {
+            b = static_cast<std::byte>(rng());
+        }
+    }
+    return files;
+}
+
+inline void write_synthetic_vpp(const std::string& path, const std::vector<SyntheticFile>& files)
+{
+    vpp::ArchiveWriter writer{path.c_str(), files.size()};
+    for (const auto& file : files) {
+        writer.add_file(file.name, file.data);
+    }
+    writer.finish();
+}
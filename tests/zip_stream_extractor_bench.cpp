@@ -0,0 +1,147 @@
+// Measures how long after the last byte of a level archive is received its packfiles are ready, when they are
+// extracted while the archive is being downloaded compared to extracting the whole archive after the download.
+// The download is simulated by feeding the archive at a fixed rate.
+// Usage: zip_stream_extractor_bench [download_rate_mb_per_s] [num_packfiles] [packfile_size_mb]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+#include "../game_patch/multi/zip_stream_extractor.h"
+#include "test_utils.h"
+#include "vpp_test_utils.h"
+
+static void append_le(std::vector<char>& buf, std::uint32_t val, std::size_t num_bytes)
+{
+    for (std::size_t i = 0; i < num_bytes; ++i) {
+        buf.push_back(static_cast<char>((val >> (i * 8)) & 0xFF));
+    }
+}
+
+static std::vector<char> deflate_raw(const std::vector<char>& data)
+{
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error{"deflateInit2 failed"};
+    }
+    std::vector<char> out(deflateBound(&stream, static_cast<uLong>(data.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    int result = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        throw std::runtime_error{"deflate failed"};
+    }
+    out.resize(stream.total_out);
+    return out;
+}
+
+// Builds a zip archive with deflated entries. Only the parts read by ZipStreamExtractor are filled in properly: local
+// headers followed by the signature of the central directory.
+static std::vector<char> make_zip(const std::vector<std::pair<std::string, std::vector<char>>>& entries)
+{
+    std::vector<char> zip;
+    for (const auto& [name, data] : entries) {
+        auto compressed = deflate_raw(data);
+        auto crc = crc32(0, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size()));
+        append_le(zip, 0x04034B50, 4);
+        append_le(zip, 20, 2); // version needed
+        append_le(zip, 0, 2); // flags
+        append_le(zip, 8, 2); // method: deflate
+        append_le(zip, 0, 4); // time and date
+        append_le(zip, crc, 4);
+        append_le(zip, static_cast<std::uint32_t>(compressed.size()), 4);
+        append_le(zip, static_cast<std::uint32_t>(data.size()), 4);
+        append_le(zip, static_cast<std::uint32_t>(name.size()), 2);
+        append_le(zip, 0, 2); // extra field length
+        zip.insert(zip.end(), name.begin(), name.end());
+        zip.insert(zip.end(), compressed.begin(), compressed.end());
+    }
+    append_le(zip, 0x02014B50, 4);
+    return zip;
+}
+
+static std::vector<char> make_packfile_data(const TempDir& temp_dir, std::size_t size, unsigned seed)
+{
+    auto files = make_synthetic_files(size / 32768 + 1, 65536, seed);
+    // Lower entropy so the archive compresses about as well as level packfiles
+    for (auto& file : files) {
+        for (auto& b : file.data) {
+            b &= std::byte{0x0F};
+        }
+    }
+    auto path = temp_dir.file("source.vpp");
+    write_synthetic_vpp(path, files);
+    std::vector<char> data(std::filesystem::file_size(path));
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file || std::fread(data.data(), 1, data.size(), file) != data.size()) {
+        throw std::runtime_error{"cannot read packfile"};
+    }
+    std::fclose(file);
+    return data;
+}
+
+// Feeds the archive in chunks at the download rate and returns seconds from the time the last chunk should have
+// arrived until all files are extracted (extraction slower than the download delays later chunks)
+static double run(const std::vector<char>& zip, double rate_bytes_per_s, bool streaming, const std::string& dir)
+{
+    constexpr std::size_t chunk_size = 16 * 1024;
+    ZipStreamExtractor extractor{dir, [](const char*) { return true; }};
+    std::vector<char> received;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t offset = 0; offset < zip.size(); offset += chunk_size) {
+        std::size_t len = std::min(chunk_size, zip.size() - offset);
+        std::this_thread::sleep_until(start + std::chrono::duration<double>((offset + len) / rate_bytes_per_s));
+        if (streaming) {
+            extractor.feed(zip.data() + offset, len);
+        }
+        else {
+            received.insert(received.end(), zip.begin() + offset, zip.begin() + offset + len);
+        }
+    }
+    auto download_end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(zip.size() / rate_bytes_per_s));
+    if (!streaming) {
+        extractor.feed(received.data(), received.size());
+    }
+    if (!extractor.finished()) {
+        throw std::runtime_error{"archive not fully extracted"};
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - download_end).count();
+}
+
+int main(int argc, char* argv[])
+{
+    double rate_mb = argc > 1 ? std::atof(argv[1]) : 10.0;
+    std::size_t num_packfiles = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2;
+    std::size_t packfile_size_mb = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20;
+
+    TempDir temp_dir;
+    std::vector<std::pair<std::string, std::vector<char>>> entries;
+    std::size_t total_size = 0;
+    for (std::size_t i = 0; i < num_packfiles; ++i) {
+        entries.emplace_back("level" + std::to_string(i) + ".vpp",
+            make_packfile_data(temp_dir, packfile_size_mb * 1024 * 1024, static_cast<unsigned>(i)));
+        total_size += entries.back().second.size();
+    }
+    auto zip = make_zip(entries);
+    std::printf("Archive: %zu packfiles, %.1f MB extracted, %.1f MB compressed, download rate %.1f MB/s\n",
+        num_packfiles, total_size / 1048576.0, zip.size() / 1048576.0, rate_mb);
+
+    auto output_dir = temp_dir.file("");
+    double rate = rate_mb * 1048576.0;
+    double after_download = run(zip, rate, false, output_dir);
+    double streaming = run(zip, rate, true, output_dir);
+    std::printf("Ready after download: extract after download %.2f ms, extract while downloading %.2f ms\n",
+        after_download * 1000.0, streaming * 1000.0);
+    return 0;
+}
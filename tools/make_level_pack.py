@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""Creates a synthetic level pack archive for testing and benchmarking level downloads and extraction.
+
+The archive contains multiple packfiles with partially compressible content, similar to real map packs.
+
+Example:
+    tools/make_level_pack.py pack.zip --count 6 --size 40
+    tools/mock_factionfiles.py --map dm-pack1.rfl=pack.zip
+
+Extraction time is written to the Dash Faction log after every level download.
+"""
+
+import argparse
+import os
+import random
+import struct
+import zipfile
+
+
+def make_packfile_data(index, size, rng):
+    # VPP header block followed by a mix of random and repeated data so deflate has some work to do
+    header = struct.pack('<IIII', 0x51890ACE, 1, 1, size).ljust(2048, b'\0')
+    chunks = [header]
+    written = len(header)
+    while written < size:
+        chunk_len = min(64 * 1024, size - written)
+        if rng.random() < 0.5:
+            chunk = rng.randbytes(chunk_len)
+        else:
+            chunk = (f'level pack {index} '.encode() * (chunk_len // 10 + 1))[:chunk_len]
+        chunks.append(chunk)
+        written += chunk_len
+    return b''.join(chunks)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('output')
+    parser.add_argument('--count', type=int, default=4, help='number of packfiles')
+    parser.add_argument('--size', type=int, default=20, help='size of every packfile in MB')
+    parser.add_argument('--prefix', default='dm-pack', help='packfile name prefix')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    with zipfile.ZipFile(args.output, 'w', compression=zipfile.ZIP_DEFLATED, compresslevel=6) as archive:
+        for i in range(1, args.count + 1):
+            data = make_packfile_data(i, args.size * 1024 * 1024, rng)
+            archive.writestr(f'{args.prefix}{i}.vpp', data)
+    print(f'Created {args.output} ({os.path.getsize(args.output) / 1024 / 1024:.1f} MB, {args.count} packfiles)')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Local mock of autodl.factionfiles.com used for testing and benchmarking level downloads.
+
+Serves findmap.php and downloadmap.php for archives passed on the command line. Latency and bandwidth can be
+limited to simulate slow servers and connections can be dropped to test resuming of downloads.
+
+Example:
+    tools/mock_factionfiles.py --map dm-test.rfl=dm-test.zip --latency 200 --bandwidth 512 --drop-after 100000
+
+Point Dash Faction to it by setting DF_FACTIONFILES_URL=http://127.0.0.1:8080 environment variable.
+"""
+
+import argparse
+import os
+import re
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+
+class MockFactionFilesHandler(BaseHTTPRequestHandler):
+    # Note: HTTP/1.0 - every response ends by closing the connection like the real server does for Dash Faction
+    protocol_version = 'HTTP/1.0'
+
+    def log_message(self, fmt, *args):
+        if self.server.args.verbose:
+            super().log_message(fmt, *args)
+
+    def do_GET(self):
+        time.sleep(self.server.args.latency / 1000)
+        url = urlparse(self.path)
+        query = parse_qs(url.query)
+        if url.path == '/findmap.php':
+            self.find_map(query.get('rflName', [''])[0])
+        elif url.path == '/downloadmap.php':
+            self.download_map(query.get('ticketid', [''])[0])
+        else:
+            self.send_error(404)
+
+    def find_map(self, rfl_name):
+        ticket_id = self.server.tickets_by_name.get(rfl_name.lower())
+        if ticket_id is None:
+            body = b'notfound\n'
+        else:
+            path = self.server.archives[ticket_id]
+            size_mb = os.path.getsize(path) / 1024 / 1024
+            name = os.path.splitext(rfl_name)[0]
+            body = f'found\n{name}\nMock Author\nServed by mock_factionfiles.py\n{size_mb:.4f}\n{ticket_id}\n'.encode()
+        self.send_response(200)
+        self.send_header('Content-Type', 'text/plain')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def download_map(self, ticket_id):
+        if not ticket_id.isdigit() or int(ticket_id) not in self.server.archives:
+            self.send_error(404)
+            return
+        with open(self.server.archives[int(ticket_id)], 'rb') as file:
+            data = file.read()
+
+        begin, end = 0, len(data)
+        range_match = re.fullmatch(r'bytes=(\d+)-(\d*)', self.headers.get('Range', ''))
+        if range_match and not self.server.args.no_ranges:
+            begin = int(range_match.group(1))
+            if range_match.group(2):
+                end = min(int(range_match.group(2)) + 1, len(data))
+            if begin >= end:
+                self.send_error(416)
+                return
+            self.send_response(206)
+            self.send_header('Content-Range', f'bytes {begin}-{end - 1}/{len(data)}')
+        else:
+            self.send_response(200)
+        if not self.server.args.no_ranges:
+            self.send_header('Accept-Ranges', 'bytes')
+        self.send_header('Content-Type', 'application/octet-stream')
+        self.send_header('Content-Length', str(end - begin))
+        self.end_headers()
+        self.send_throttled(data[begin:end])
+
+    def send_throttled(self, data):
+        args = self.server.args
+        chunk_size = 16 * 1024
+        sent = 0
+        start = time.monotonic()
+        while sent < len(data):
+            if args.drop_after and self.server.consume_drop_budget(sent):
+                # Simulate an interrupted connection
+                return
+            chunk = data[sent:sent + chunk_size]
+            try:
+                self.wfile.write(chunk)
+            except (BrokenPipeError, ConnectionResetError):
+                # Client closed the connection, e.g. after reading the part of the resource it needed
+                return
+            sent += len(chunk)
+            if args.bandwidth:
+                # bandwidth is per connection like in case of a real server limiting every client
+                expected_time = sent / (args.bandwidth * 1024)
+                delay = expected_time - (time.monotonic() - start)
+                if delay > 0:
+                    time.sleep(delay)
+
+
+class MockFactionFilesServer(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def __init__(self, args):
+        super().__init__((args.host, args.port), MockFactionFilesHandler)
+        self.args = args
+        self.archives = {}
+        self.tickets_by_name = {}
+        for ticket_id, map_arg in enumerate(args.map, start=1):
+            rfl_name, path = map_arg.split('=', 1)
+            self.archives[ticket_id] = path
+            self.tickets_by_name[rfl_name.lower()] = ticket_id
+        self.drops_left = args.drop_count
+        self.lock = threading.Lock()
+
+    def consume_drop_budget(self, sent):
+        with self.lock:
+            if sent >= self.args.drop_after and self.drops_left > 0:
+                self.drops_left -= 1
+                return True
+        return False
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--map', action='append', default=[], metavar='RFL_NAME=ARCHIVE_PATH',
+                        help='level file name and path of the archive containing it (can be repeated)')
+    parser.add_argument('--latency', type=int, default=0, help='delay before every response in ms')
+    parser.add_argument('--bandwidth', type=int, default=0, help='download speed limit per connection in KB/s')
+    parser.add_argument('--no-ranges', action='store_true', help='ignore Range headers')
+    parser.add_argument('--drop-after', type=int, default=0,
+                        help='close download connections after sending this number of bytes')
+    parser.add_argument('--drop-count', type=int, default=1, help='number of connections to drop')
+    parser.add_argument('--verbose', action='store_true')
+    args = parser.parse_args()
+
+    server = MockFactionFilesServer(args)
+    # Port 0 selects a free port - print the real one so tests can connect to it
+    print(f'Serving {len(server.archives)} levels on http://{args.host}:{server.server_address[1]}', flush=True)
+    server.serve_forever()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,226 @@
+#include <vpp/ArchiveView.h>
+#include <vpp/ArchiveWriter.h>
+#include <vpp/MappedFile.h>
+#include <xxhash.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+static unsigned g_num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+static std::vector<vpp::Entry> get_entries(const vpp::ArchiveView& archive)
+{
+    std::vector<vpp::Entry> entries;
+    entries.reserve(archive.num_files());
+    archive.for_each_entry([&](const vpp::Entry& entry) {
+        entries.push_back(entry);
+    });
+    return entries;
+}
+
+// Calls fun for every index in [0, count) using all worker threads
+template<typename F>
+static void parallel_for(std::size_t count, F fun)
+{
+    std::atomic<std::size_t> next_idx{0};
+    auto worker = [&]() {
+        std::size_t idx;
+        while ((idx = next_idx++) < count) {
+            fun(idx);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < std::min<std::size_t>(g_num_threads, count); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+static int cmd_list(const char* archive_path)
+{
+    vpp::MappedFile mapped_file{archive_path};
+    vpp::ArchiveView archive{mapped_file.bytes()};
+    archive.for_each_entry([&](const vpp::Entry& entry) {
+        std::printf("%10u %10zu  %.*s\n", entry.size, vpp::block_offset(entry.block),
+            static_cast<int>(entry.name.size()), entry.name.data());
+    });
+    std::printf("%u files\n", archive.num_files());
+    return 0;
+}
+
+static int cmd_extract(const char* archive_path, const char* output_dir)
+{
+    vpp::MappedFile mapped_file{archive_path};
+    vpp::ArchiveView archive{mapped_file.bytes()};
+    std::vector<vpp::Entry> entries = get_entries(archive);
+    std::filesystem::create_directories(output_dir);
+
+    std::atomic<unsigned> num_errors{0};
+    parallel_for(entries.size(), [&](std::size_t idx) {
+        const vpp::Entry& entry = entries[idx];
+        auto data = archive.entry_data(entry);
+        // Do not allow writing outside of the output directory
+        if (entry.name.find_first_of("/\\:") != std::string_view::npos || entry.name == "..") {
+            std::fprintf(stderr, "Skipping entry with invalid name: %.*s\n",
+                static_cast<int>(entry.name.size()), entry.name.data());
+            ++num_errors;
+            return;
+        }
+        if (data.size() != entry.size) {
+            std::fprintf(stderr, "Entry is out of file bounds: %.*s\n",
+                static_cast<int>(entry.name.size()), entry.name.data());
+            ++num_errors;
+            return;
+        }
+        auto output_path = std::filesystem::path{output_dir} / std::string{entry.name};
+        std::ofstream file{output_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+        if (!file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()))) {
+            std::fprintf(stderr, "Failed to write %s\n", output_path.string().c_str());
+            ++num_errors;
+        }
+    });
+    std::printf("Extracted %zu files\n", entries.size() - num_errors);
+    return num_errors ? 1 : 0;
+}
+
+static int cmd_create(const char* archive_path, const std::vector<const char*>& input_paths)
+{
+    vpp::ArchiveWriter writer{archive_path, input_paths.size()};
+    for (const char* input_path : input_paths) {
+        vpp::MappedFile input_file{input_path};
+        auto name = std::filesystem::path{input_path}.filename().string();
+        writer.add_file(name, input_file.bytes());
+    }
+    writer.finish();
+    std::printf("Created %s with %zu files\n", archive_path, input_paths.size());
+    return 0;
+}
+
+static int cmd_verify(const char* archive_path)
+{
+    vpp::MappedFile mapped_file{archive_path};
+    vpp::ArchiveView archive{mapped_file.bytes()};
+    unsigned num_errors = 0;
+    auto report = [&](const char* msg, std::string_view name) {
+        std::printf("%s: %.*s\n", msg, static_cast<int>(name.size()), name.data());
+        ++num_errors;
+    };
+
+    std::unordered_set<std::string> names;
+    std::size_t end_offset = vpp::block_offset(vpp::first_data_block(archive.num_files()));
+    archive.for_each_entry([&](const vpp::Entry& entry) {
+        if (entry.name.empty() || entry.name.size() >= vpp::max_name_len) {
+            report("Invalid name", entry.name);
+        }
+        std::string name_lower{entry.name};
+        std::transform(name_lower.begin(), name_lower.end(), name_lower.begin(), [](unsigned char ch) {
+            return static_cast<char>(std::tolower(ch));
+        });
+        if (!names.insert(name_lower).second) {
+            report("Duplicated name", entry.name);
+        }
+        if (archive.entry_data(entry).size() != entry.size) {
+            report("Entry is out of file bounds", entry.name);
+        }
+        end_offset = vpp::block_offset(entry.block + vpp::num_blocks(entry.size));
+    });
+    if (archive.header().total_size != mapped_file.size()) {
+        std::printf("Warning: header size %u does not match file size %zu\n", archive.header().total_size,
+            mapped_file.size());
+    }
+    if (end_offset < mapped_file.size()) {
+        std::printf("Unexpected data after last entry\n");
+        ++num_errors;
+    }
+    std::printf("%u files, %u errors\n", archive.num_files(), num_errors);
+    return num_errors ? 1 : 0;
+}
+
+static int cmd_checksum(const char* archive_path)
+{
+    vpp::MappedFile mapped_file{archive_path};
+    vpp::ArchiveView archive{mapped_file.bytes()};
+    std::vector<vpp::Entry> entries = get_entries(archive);
+    std::vector<XXH32_hash_t> hashes(entries.size());
+    parallel_for(entries.size(), [&](std::size_t idx) {
+        auto data = archive.entry_data(entries[idx]);
+        hashes[idx] = XXH32(data.data(), data.size(), 0);
+    });
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        std::printf("%08X  %.*s\n", hashes[i], static_cast<int>(entries[i].name.size()), entries[i].name.data());
+    }
+    // Whole file checksum is compatible with checksums used by the game
+    std::printf("%08X  %s\n", XXH32(mapped_file.data(), mapped_file.size(), 0), archive_path);
+    return 0;
+}
+
+static void print_usage()
+{
+    std::printf(
+        "Usage: vpp_tool [options...] command args...\n\n"
+        "Available commands:\n"
+        "list archive                  lists files in the packfile\n"
+        "extract archive output_dir    extracts all files from the packfile\n"
+        "create archive files...       creates a new packfile\n"
+        "verify archive                checks packfile structure\n"
+        "checksum archive              prints XXH32 checksums of all files and the whole packfile\n\n"
+        "Available options:\n"
+        "-j threads                    number of worker threads\n"
+    );
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg_sv{argv[i]};
+        if (arg_sv == "-j" && i + 1 < argc) {
+            g_num_threads = std::max(std::atoi(argv[++i]), 1);
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() < 2) {
+        print_usage();
+        return 1;
+    }
+
+    std::string_view cmd{args[0]};
+    try {
+        if (cmd == "list" && args.size() == 2) {
+            return cmd_list(args[1]);
+        }
+        if (cmd == "extract" && args.size() == 3) {
+            return cmd_extract(args[1], args[2]);
+        }
+        if (cmd == "create" && args.size() >= 3) {
+            return cmd_create(args[1], {args.begin() + 2, args.end()});
+        }
+        if (cmd == "verify" && args.size() == 2) {
+            return cmd_verify(args[1]);
+        }
+        if (cmd == "checksum" && args.size() == 2) {
+            return cmd_checksum(args[1]);
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    print_usage();
+    return 1;
+}
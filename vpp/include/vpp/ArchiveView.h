@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vpp/format.h>
+
+namespace vpp
+{
+    struct Entry
+    {
+        std::string_view name;
+        std::uint32_t size;
+        std::uint32_t block;
+    };
+
+    // Zero-copy view of a packfile stored in memory, e.g. in MappedFile
+    // Viewed data must outlive this object
+    class ArchiveView
+    {
+    public:
+        // Throws std::runtime_error if header or directory is invalid
+        explicit ArchiveView(std::span<const std::byte> data);
+
+        [[nodiscard]] const Header& header() const
+        {
+            return *reinterpret_cast<const Header*>(data_.data());
+        }
+
+        [[nodiscard]] std::uint32_t num_files() const
+        {
+            return header().num_files;
+        }
+
+        // Raw directory records, there is exactly num_files() of them
+        [[nodiscard]] const FileInfo* file_infos() const
+        {
+            return reinterpret_cast<const FileInfo*>(data_.data() + block_offset(1));
+        }
+
+        template<typename F>
+        void for_each_entry(F fun) const
+        {
+            const FileInfo* infos = file_infos();
+            auto block = static_cast<std::uint32_t>(first_data_block(num_files()));
+            for (std::uint32_t i = 0; i < num_files(); ++i) {
+                Entry entry{entry_name(infos[i]), infos[i].size, block};
+                fun(entry);
+                block += static_cast<std::uint32_t>(num_blocks(entry.size));
+            }
+        }
+
+        // Returns an empty span if the entry does not fit in the viewed data (truncated packfile)
+        [[nodiscard]] std::span<const std::byte> entry_data(const Entry& entry) const;
+
+        static std::string_view entry_name(const FileInfo& info);
+
+    private:
+        std::span<const std::byte> data_;
+    };
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <vpp/format.h>
+
+namespace vpp
+{
+    // Writes packfile contents sequentially. Directory is written when finish() is called.
+    class ArchiveWriter
+    {
+    public:
+        // Throws std::runtime_error on I/O errors
+        ArchiveWriter(const char* path, std::size_t num_files);
+
+        void add_file(std::string_view name, std::span<const std::byte> data);
+        void finish();
+
+    private:
+        std::ofstream file_;
+        std::vector<FileInfo> file_infos_;
+        std::size_t num_files_;
+        std::uint64_t offset_ = 0;
+
+        void write_padding();
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <utility>
+
+namespace vpp
+{
+    // Read-only memory mapping of a whole file
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        // Throws std::runtime_error if file cannot be opened or mapped
+        explicit MappedFile(const char* path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept :
+            data_(std::exchange(other.data_, nullptr)),
+            size_(std::exchange(other.size_, 0))
+        {}
+
+        MappedFile& operator=(MappedFile&& other) noexcept
+        {
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            return *this;
+        }
+
+        [[nodiscard]] const std::byte* data() const
+        {
+            return data_;
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return size_;
+        }
+
+        [[nodiscard]] std::span<const std::byte> bytes() const
+        {
+            return {data_, size_};
+        }
+
+    private:
+        const std::byte* data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// On-disk layout of Volition packfiles (VPP) used by Red Faction
+// All data is aligned to 2048 byte blocks: header block, directory blocks and then file contents, each file
+// starting at a new block.
+
+namespace vpp
+{
+    constexpr std::uint32_t signature = 0x51890ACE;
+    constexpr std::uint32_t version = 1;
+    constexpr std::size_t block_size = 0x800;
+    constexpr std::size_t max_name_len = 60;
+
+    struct Header
+    {
+        std::uint32_t sig;
+        std::uint32_t version;
+        std::uint32_t num_files;
+        std::uint32_t total_size;
+    };
+    static_assert(sizeof(Header) == 0x10);
+
+    struct FileInfo
+    {
+        // zero terminated unless the name has exactly 60 characters
+        char name[max_name_len];
+        std::uint32_t size;
+    };
+    static_assert(sizeof(FileInfo) == 0x40);
+
+    constexpr std::size_t file_infos_per_block = block_size / sizeof(FileInfo);
+
+    constexpr std::size_t num_blocks(std::size_t num_bytes)
+    {
+        return (num_bytes + block_size - 1) / block_size;
+    }
+
+    constexpr std::size_t block_offset(std::size_t block)
+    {
+        return block * block_size;
+    }
+
+    constexpr std::size_t num_directory_blocks(std::size_t num_files)
+    {
+        return num_blocks(num_files * sizeof(FileInfo));
+    }
+
+    // Index of the block containing the first file contents
+    constexpr std::size_t first_data_block(std::size_t num_files)
+    {
+        return 1 + num_directory_blocks(num_files);
+    }
+}
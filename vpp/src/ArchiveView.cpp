@@ -0,0 +1,32 @@
+#include <vpp/ArchiveView.h>
+#include <cstring>
+#include <stdexcept>
+
+vpp::ArchiveView::ArchiveView(std::span<const std::byte> data) :
+    data_(data)
+{
+    if (data_.size() < block_size) {
+        throw std::runtime_error{"packfile header is truncated"};
+    }
+    if (header().sig != signature || header().version < version) {
+        throw std::runtime_error{"invalid packfile header"};
+    }
+    if (header().num_files > data_.size() / sizeof(FileInfo) ||
+        data_.size() < block_offset(first_data_block(header().num_files))) {
+        throw std::runtime_error{"packfile directory is truncated"};
+    }
+}
+
+std::span<const std::byte> vpp::ArchiveView::entry_data(const Entry& entry) const
+{
+    std::size_t offset = block_offset(entry.block);
+    if (offset > data_.size() || entry.size > data_.size() - offset) {
+        return {};
+    }
+    return data_.subspan(offset, entry.size);
+}
+
+std::string_view vpp::ArchiveView::entry_name(const FileInfo& info)
+{
+    return {info.name, strnlen(info.name, sizeof(info.name))};
+}
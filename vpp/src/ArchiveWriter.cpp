@@ -0,0 +1,70 @@
+#include <vpp/ArchiveWriter.h>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static const char zero_block[vpp::block_size] = {};
+
+vpp::ArchiveWriter::ArchiveWriter(const char* path, std::size_t num_files) :
+    file_(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc),
+    num_files_(num_files)
+{
+    if (!file_) {
+        throw std::runtime_error{std::string{"cannot open file "} + path};
+    }
+    file_.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    file_infos_.reserve(num_files);
+
+    // Reserve space for header and directory, they are written in finish()
+    for (std::size_t i = 0; i < first_data_block(num_files); ++i) {
+        file_.write(zero_block, block_size);
+    }
+    offset_ = block_offset(first_data_block(num_files));
+}
+
+void vpp::ArchiveWriter::add_file(std::string_view name, std::span<const std::byte> data)
+{
+    if (file_infos_.size() == num_files_) {
+        throw std::runtime_error{"too many files added to packfile"};
+    }
+    if (name.empty() || name.size() >= max_name_len) {
+        throw std::runtime_error{std::string{"invalid packfile entry name "} + std::string{name}};
+    }
+    if (data.size() > UINT32_MAX) {
+        throw std::runtime_error{std::string{"file is too big: "} + std::string{name}};
+    }
+
+    FileInfo info{};
+    name.copy(info.name, name.size());
+    info.size = static_cast<std::uint32_t>(data.size());
+    file_infos_.push_back(info);
+
+    file_.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    offset_ += data.size();
+    write_padding();
+}
+
+void vpp::ArchiveWriter::write_padding()
+{
+    std::size_t padding = static_cast<std::size_t>(block_offset(num_blocks(offset_)) - offset_);
+    file_.write(zero_block, static_cast<std::streamsize>(padding));
+    offset_ += padding;
+}
+
+void vpp::ArchiveWriter::finish()
+{
+    if (file_infos_.size() != num_files_) {
+        throw std::runtime_error{"not all files have been added to packfile"};
+    }
+    if (offset_ > UINT32_MAX) {
+        throw std::runtime_error{"packfile is too big"};
+    }
+
+    Header hdr{signature, version, static_cast<std::uint32_t>(num_files_), static_cast<std::uint32_t>(offset_)};
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    file_.seekp(static_cast<std::streamoff>(block_offset(1)));
+    file_.write(reinterpret_cast<const char*>(file_infos_.data()),
+        static_cast<std::streamsize>(file_infos_.size() * sizeof(FileInfo)));
+    file_.close();
+}
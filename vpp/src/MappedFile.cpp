@@ -0,0 +1,98 @@
+#include <vpp/MappedFile.h>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+vpp::MappedFile::MappedFile(const char* path)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error{std::string{"cannot open file "} + path};
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || static_cast<ULONGLONG>(file_size.QuadPart) > SIZE_MAX) {
+        CloseHandle(file);
+        throw std::runtime_error{std::string{"cannot get size of file "} + path};
+    }
+    if (file_size.QuadPart == 0) {
+        // Empty files cannot be mapped
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    // Note: mapping object keeps the file open so the handle can be closed right away
+    CloseHandle(file);
+    if (!mapping) {
+        throw std::runtime_error{std::string{"cannot create mapping of file "} + path};
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    // Note: view keeps the mapping object alive
+    CloseHandle(mapping);
+    if (!view) {
+        throw std::runtime_error{std::string{"cannot map view of file "} + path};
+    }
+
+    data_ = static_cast<const std::byte*>(view);
+    size_ = static_cast<std::size_t>(file_size.QuadPart);
+}
+
+vpp::MappedFile::~MappedFile()
+{
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+}
+
+#else // _WIN32
+
+vpp::MappedFile::MappedFile(const char* path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error{std::string{"cannot open file "} + path};
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error{std::string{"cannot get size of file "} + path};
+    }
+    if (st.st_size == 0) {
+        // Empty files cannot be mapped
+        close(fd);
+        return;
+    }
+
+    void* view = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // Note: mapping keeps the file open so the descriptor can be closed right away
+    close(fd);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error{std::string{"cannot map file "} + path};
+    }
+
+    data_ = static_cast<const std::byte*>(view);
+    size_ = static_cast<std::size_t>(st.st_size);
+}
+
+vpp::MappedFile::~MappedFile()
+{
+    if (data_) {
+        munmap(const_cast<std::byte*>(data_), size_);
+    }
+}
+
+#endif // _WIN32